@@ -26,6 +26,7 @@
 #include "drishti/rcpr/CPR.h"
 #include "drishti/rcpr/CPRIO.h"
 #include "drishti/core/Line.h"
+#include "drishti/core/Parallel.h"
 #include "drishti/core/string_utils.h"
 #include "drishti/core/drishti_string_hash.h"
 #include "drishti/core/boost_serialize_common.h"
@@ -280,11 +281,17 @@ int gauze_main(int argc, char** argv)
         EllipseSamples test(logger);
         test.load(sTest, targetWidth, sExtension, doIris);
 
+        // The cascade is reentrant, so test samples are evaluated in parallel:
+        std::vector<drishti::rcpr::CPR::CPRResult> results(test.samples.images.size());
+        drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
+            cpr.cprApplyTree(test.samples.images[i], *cpr.regModel, *(cpr.regModel->pStar), results[i]);
+        };
+        cv::parallel_for_({ 0, int(results.size()) }, harness);
+
         std::vector<double> errors(T, 0.0); // accumulate per stage errors
         for (int i = 0; i < test.samples.images.size(); i++)
         {
-            drishti::rcpr::CPR::CPRResult result;
-            cpr.cprApplyTree(test.samples.images[i], *cpr.regModel, *(cpr.regModel->pStar), result);
+            auto& result = results[i];
 
             // Measure error at each stage:
             for (int t = 0; t < T; t++)
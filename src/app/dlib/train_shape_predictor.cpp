@@ -82,6 +82,8 @@ int gauze_main(int argc, char* argv[])
     float lambda = 0.1;
     float nu = 0.1;
     float padding = 0;
+    float early_exit = 0.f;
+    float warm_start = 0.f;
     int cascades = 10;
     int depth = 5;
     int ellipse_count = 0;
@@ -122,6 +124,8 @@ int gauze_main(int argc, char* argv[])
         ( "lambda", "Lambda for feature separation", cxxopts::value<float>(lambda))
         ( "splits", "Number of test splits", cxxopts::value<int>(splits))
         ( "padding", "Feature pool region padding", cxxopts::value<float>(padding))
+        ( "warm-start", "Train a warm start tail w/ prior noise sigma (normalized)", cxxopts::value<float>(warm_start))
+        ( "early-exit", "Learn early exit threshold on test set w/ max relative error increase", cxxopts::value<float>(early_exit))
         ( "threads", "Use worker threads when possible", cxxopts::value<bool>(do_threads))
         ( "verbose", "Print verbose diagnostics", cxxopts::value<bool>(do_verbose))
         ( "silent", "Disable logging entirely", cxxopts::value<bool>(do_silent))
@@ -207,6 +211,7 @@ int gauze_main(int argc, char* argv[])
     trainer.set_lambda(lambda);                    // feature separation (not learning rate)
     trainer.set_num_test_splits(splits);
     trainer.set_feature_pool_region_padding(padding);
+    trainer.set_warm_start_noise(warm_start);
 
     if(do_verbose)
     {
@@ -267,6 +272,18 @@ int gauze_main(int argc, char* argv[])
         {
             logger->info() << "Mean testing error:  " << test_error;
         }
+
+        if(early_exit > 0.f)
+        {
+            double mean_stages = 0.0;
+            sp.m_early_exit_threshold = learn_early_exit_threshold(sp, images_test, faces_test, test_iod, early_exit, 1, &mean_stages);
+            save_pba_z(sModel, sp);
+
+            if(do_verbose)
+            {
+                logger->info() << "Early exit threshold: " << sp.m_early_exit_threshold << " mean stages: " << mean_stages;
+            }
+        }
     }
 
     return 0;
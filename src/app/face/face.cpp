@@ -255,15 +255,16 @@ int gauze_main(int argc, char** argv)
 
     auto video = drishti::videoio::VideoSourceCV::create(sInput);
 
+    // Shared factory: regression models are loaded once and shared across threads
+    auto factory = std::make_shared<drishti::face::FaceDetectorFactory>();
+    factory->sFaceDetector = sFaceDetector;
+    factory->sFaceRegressors = { sFaceRegressor };
+    factory->sEyeRegressor = sEyeRegressor;
+    factory->sFaceDetectorMean = sFaceDetectorMean;
+
     // Allocate resource manager:
     using FaceDetectorPtr = std::unique_ptr<drishti::face::FaceDetector>;
     drishti::core::LazyParallelResource<std::thread::id, FaceDetectorPtr> manager = [&]() {
-        auto factory = std::make_shared<drishti::face::FaceDetectorFactory>();
-        factory->sFaceDetector = sFaceDetector;
-        factory->sFaceRegressors = { sFaceRegressor };
-        factory->sEyeRegressor = sEyeRegressor;
-        factory->sFaceDetectorMean = sFaceDetectorMean;
-
         FaceDetectorPtr detector = drishti::core::make_unique<drishti::face::FaceDetector>(*factory);
         detector->setScaling(scale);
         if (detector)
@@ -0,0 +1,174 @@
+/*!
+  @file   conic_batch.cpp
+  @author David Hirvonen
+  @brief  Throughput of the scalar vs batched (structure of arrays) conic kernels.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Usage: drishti_benchmark_conic_batch [ellipses=4096] [points=64]
+
+*/
+
+#include "drishti/geometry/ConicBatch.h"
+#include "drishti/geometry/fitEllipse.h"
+#include "drishti/geometry/intersectConicLine.h"
+
+#include <opencv2/core.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using drishti::geometry::ConicSection_;
+
+template <typename Function>
+static double seconds(Function&& f)
+{
+    const auto tic = std::chrono::high_resolution_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tic).count();
+}
+
+static void report(const std::string& name, double scalar, double batch, int n)
+{
+    std::cout << std::setw(24) << std::left << name
+              << " scalar: " << std::setw(10) << (1e6 * scalar / n) << " us"
+              << " batch: " << std::setw(10) << (1e6 * batch / n) << " us"
+              << " speedup: " << (scalar / batch) << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    const int count = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    const int points = (argc > 2) ? std::atoi(argv[2]) : 64;
+
+    cv::RNG rng(0);
+    std::vector<cv::RotatedRect> ellipses;
+    std::vector<std::vector<cv::Point2d>> sets;
+    drishti::geometry::PointSets batch;
+    for (int i = 0; i < count; i++)
+    {
+        const cv::RotatedRect e({ rng.uniform(0.f, 640.f), rng.uniform(0.f, 480.f) }, { rng.uniform(20.f, 80.f), rng.uniform(20.f, 80.f) }, rng.uniform(0.f, 180.f));
+        const double theta = e.angle * M_PI / 180.0;
+
+        std::vector<cv::Point2d> set;
+        for (int j = 0; j < points; j++)
+        {
+            const double t = 2.0 * M_PI * j / points;
+            const double x = 0.5 * e.size.width * std::cos(t) + rng.gaussian(0.5);
+            const double y = 0.5 * e.size.height * std::sin(t) + rng.gaussian(0.5);
+            set.emplace_back(e.center.x + x * std::cos(theta) - y * std::sin(theta), e.center.y + x * std::sin(theta) + y * std::cos(theta));
+        }
+
+        ellipses.push_back(e);
+        sets.push_back(set);
+        batch.add(set);
+    }
+
+    double checksum = 0.0;
+
+    std::cout << count << " ellipses, " << points << " points per ellipse, per ellipse times:" << std::endl;
+
+    { // ### fitting ###
+        std::vector<cv::RotatedRect> fits(count);
+        drishti::geometry::EllipseArray fitsBatch;
+        const double scalar = seconds([&]() {
+            for (int i = 0; i < count; i++)
+            {
+                fits[i] = drishti::geometry::fitEllipse(sets[i]);
+            }
+        });
+        const double batched = seconds([&]() { drishti::geometry::fitEllipses(batch, fitsBatch); });
+        report("fitEllipse", scalar, batched, count);
+        checksum += fits.back().center.x + fitsBatch.cx.back();
+    }
+
+    { // ### conversions ###
+        const drishti::geometry::EllipseArray cen(ellipses);
+        drishti::geometry::ConicArray par;
+        drishti::geometry::EllipseArray cen2;
+        std::vector<cv::RotatedRect> cen1(count);
+        const double scalar = seconds([&]() {
+            for (int i = 0; i < count; i++)
+            {
+                const ConicSection_<double> C(ellipses[i]);
+                cen1[i] = drishti::geometry::conicPar2Cen({ C.A, C.B, C.C, C.D, C.E, C.F });
+            }
+        });
+        const double batched = seconds([&]() {
+            drishti::geometry::conicsCen2Par(cen, par);
+            drishti::geometry::conicsPar2Cen(par, cen2);
+        });
+        report("cen2par + par2cen", scalar, batched, count);
+        checksum += cen1.back().angle + cen2.angle.back();
+    }
+
+    { // ### ray intersections (one conic, `points` rays per ellipse) ###
+        std::vector<float> ox, oy, dx, dy, t0(points), t1(points);
+        for (int j = 0; j < points; j++)
+        {
+            const float t = float(2.0 * M_PI * j / points);
+            ox.push_back(0.f);
+            oy.push_back(0.f);
+            dx.push_back(std::cos(t));
+            dy.push_back(std::sin(t));
+        }
+
+        const double scalar = seconds([&]() {
+            for (int i = 0; i < count; i++)
+            {
+                cv::RotatedRect e = ellipses[i];
+                e.center = { 0.f, 0.f };
+                const cv::Matx33f M = ConicSection_<float>(e).getMatrix();
+                for (int j = 0; j < points; j++)
+                {
+                    cv::Vec3f P[2];
+                    const cv::Vec3f l(dy[j], -dx[j], 0.f); // line through the origin along (dx, dy)
+                    checksum += drishti::geometry::intersectConicLine(M, l, P);
+                }
+            }
+        });
+        const double batched = seconds([&]() {
+            for (int i = 0; i < count; i++)
+            {
+                cv::RotatedRect e = ellipses[i];
+                e.center = { 0.f, 0.f };
+                const ConicSection_<float> C(e);
+                checksum += drishti::geometry::intersectConicRays(C, ox.data(), oy.data(), dx.data(), dy.data(), points, t0.data(), t1.data());
+            }
+        });
+        report("intersect rays", scalar, batched, count);
+    }
+
+    { // ### algebraic distance (`points` points per ellipse) ###
+        std::vector<float> x(batch.x.begin(), batch.x.end()), y(batch.y.begin(), batch.y.end()), d(x.size());
+        const double scalar = seconds([&]() {
+            for (int i = 0; i < count; i++)
+            {
+                ConicSection_<float> C(ellipses[i]);
+                for (int j = batch.offsets[i]; j < batch.offsets[i + 1]; j++)
+                {
+                    d[j] = C.algebraicDistance({ x[j], y[j] });
+                }
+            }
+        });
+        checksum += d.back();
+        const double batched = seconds([&]() {
+            for (int i = 0; i < count; i++)
+            {
+                const ConicSection_<float> C(ellipses[i]);
+                const int j = batch.offsets[i];
+                drishti::geometry::algebraicDistance(C, x.data() + j, y.data() + j, batch.offsets[i + 1] - j, d.data() + j);
+            }
+        });
+        report("algebraic distance", scalar, batched, count);
+        checksum += d.back();
+    }
+
+    std::cout << "checksum: " << checksum << std::endl;
+    return 0;
+}
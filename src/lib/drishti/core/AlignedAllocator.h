@@ -0,0 +1,85 @@
+/*!
+  @file   AlignedAllocator.h
+  @author David Hirvonen
+  @brief  Minimal STL allocator for SIMD aligned storage.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_core_AlignedAllocator_h__
+#define __drishti_core_AlignedAllocator_h__
+
+#include "drishti/core/drishti_core.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+DRISHTI_CORE_NAMESPACE_BEGIN
+
+// Over allocate and store the original pointer just before the aligned block (C++11 portable):
+template <typename T, std::size_t Alignment = 32>
+struct AlignedAllocator
+{
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        void* raw = ::operator new((n * sizeof(T)) + Alignment + sizeof(void*));
+        std::uintptr_t base = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+        std::uintptr_t aligned = (base + (Alignment - 1)) & ~std::uintptr_t(Alignment - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T* ptr, std::size_t)
+    {
+        if (ptr)
+        {
+            ::operator delete(reinterpret_cast<void**>(ptr)[-1]);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const
+    {
+        return false;
+    }
+};
+
+template <typename T, std::size_t Alignment = 32>
+using AlignedVector = std::vector<T, AlignedAllocator<T, Alignment>>;
+
+// Round a length up to a multiple of the alignment (in elements) for padded rows:
+template <typename T, std::size_t Alignment = 32>
+inline std::size_t alignedLength(std::size_t n)
+{
+    const std::size_t step = Alignment / sizeof(T);
+    return ((n + step - 1) / step) * step;
+}
+
+DRISHTI_CORE_NAMESPACE_END
+
+#endif // __drishti_core_AlignedAllocator_h__
@@ -18,6 +18,13 @@
 #endif
 // clang-format on
 
+// clang-format off
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#  include <xmmintrin.h>
+#  define DO_SSE 1
+#endif
+// clang-format on
+
 DRISHTI_CORE_NAMESPACE_BEGIN
 
 template <>
@@ -64,6 +71,59 @@ void add32f(const float* pa, const float* pb, float* pc, int n)
 #endif
 }
 
+// ################# AXPY 32F ######################
+void axpy32f_c(float alpha, const float* px, float* py, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        py[i] += alpha * px[i];
+    }
+}
+
+#if DO_ARM_NEON
+void axpy32f_neon(float alpha, const float* px, float* py, int n)
+{
+    int i = 0;
+    float32x4_t a = vdupq_n_f32(alpha);
+    for (; i <= (n - 4); i += 4, px += 4, py += 4)
+    {
+        vst1q_f32(py, vmlaq_f32(vld1q_f32(py), a, vld1q_f32(px)));
+    }
+    for (; i < n; i++, px++, py++)
+    {
+        py[0] += alpha * px[0];
+    }
+}
+#endif
+
+#if DO_SSE
+void axpy32f_sse(float alpha, const float* px, float* py, int n)
+{
+    int i = 0;
+    __m128 a = _mm_set1_ps(alpha);
+    for (; i <= (n - 8); i += 8, px += 8, py += 8)
+    {
+        _mm_storeu_ps(py + 0, _mm_add_ps(_mm_loadu_ps(py + 0), _mm_mul_ps(a, _mm_loadu_ps(px + 0))));
+        _mm_storeu_ps(py + 4, _mm_add_ps(_mm_loadu_ps(py + 4), _mm_mul_ps(a, _mm_loadu_ps(px + 4))));
+    }
+    for (; i < n; i++, px++, py++)
+    {
+        py[0] += alpha * px[0];
+    }
+}
+#endif
+
+void axpy32f(float alpha, const float* px, float* py, int n)
+{
+#if DO_ARM_NEON
+    axpy32f_neon(alpha, px, py, n);
+#elif DO_SSE
+    axpy32f_sse(alpha, px, py, n);
+#else
+    axpy32f_c(alpha, px, py, n);
+#endif
+}
+
 // ################# ADD 16S AND 32S ######################
 
 void add16sAnd32s_c(const int32_t* pa, const int16_t* pb, int32_t* pc, int n)
@@ -23,6 +23,7 @@ T round(T x);
 void add16sAnd16s(const int16_t* pa, const int16_t* pb, int16_t* pc, int n);
 void add16sAnd32s(const int32_t* pa, const int16_t* pb, int32_t* pc, int n);
 void add32f(const float* pa, const float* pb, float* pc, int n);
+void axpy32f(float alpha, const float* px, float* py, int n); // py += alpha * px
 void convertFixedPoint(const float* pa, int16_t* pb, int n, int fraction);
 
 DRISHTI_CORE_NAMESPACE_END
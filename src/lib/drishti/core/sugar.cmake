@@ -23,6 +23,7 @@ sugar_files(DRISHTI_CORE_SRCS
 
 # For now make them all public
 sugar_files(DRISHTI_CORE_HDRS_PUBLIC
+  AlignedAllocator.h
   Field.h
   FixedField.h
   IndentingOStreamBuffer.h
@@ -0,0 +1,67 @@
+/*!
+  @file   test-arithmetic.cpp
+  @author David Hirvonen
+  @brief  Google test for the optimized vector arithmetic.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "drishti/core/arithmetic.h"
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+// clang-format off
+#define BEGIN_EMPTY_NAMESPACE namespace {
+#define END_EMPTY_NAMESPACE }
+// clang-format on
+
+BEGIN_EMPTY_NAMESPACE
+
+// Compare axpy32f with a scalar loop for a length n and a pointer offset (unaligned
+// loads), the element following the output must not be written:
+static void axpy_test(int n, int offset)
+{
+    cv::RNG rng(n);
+    std::vector<float> x(n + offset + 1), y(n + offset + 1);
+    for (int i = 0; i < x.size(); i++)
+    {
+        x[i] = rng.uniform(-1.f, 1.f);
+        y[i] = rng.uniform(-1.f, 1.f);
+    }
+
+    const float alpha = 0.75f;
+    std::vector<float> expected = y;
+    for (int i = offset; i < (n + offset); i++)
+    {
+        expected[i] += alpha * x[i];
+    }
+
+    drishti::core::axpy32f(alpha, x.data() + offset, y.data() + offset, n);
+    for (int i = 0; i < y.size(); i++)
+    {
+        EXPECT_NEAR(y[i], expected[i], 1e-6f) << "n = " << n << " i = " << i;
+    }
+}
+
+TEST(Arithmetic, axpy32f_mul_8)
+{
+    axpy_test(16, 0);
+    axpy_test(32, 1);
+}
+
+TEST(Arithmetic, axpy32f_rem_8)
+{
+    for (int n : { 0, 1, 3, 5, 19, 37 })
+    {
+        axpy_test(n, 0);
+        axpy_test(n, 3);
+    }
+}
+
+END_EMPTY_NAMESPACE
@@ -81,6 +81,11 @@ int EyeSegmenter::operator()(const Image3b& image, Eye& eye, bool isRight)
     return status;
 }
 
+int EyeSegmenter::operator()(const Image3b* images, const bool* isRight, Eye* eyes, std::size_t count, int* status)
+{
+    return (*m_impl)(images, isRight, eyes, count, status);
+}
+
 Eye EyeSegmenter::getMeanEye(int width) const
 {
     return m_impl->getMeanEye(width);
@@ -182,4 +187,15 @@ int drishti_eye_segmenter_segment(
 {
     return segmenter ? (*segmenter)(image, eye, isRight) : -1;
 }
+
+int drishti_eye_segmenter_segment_batch(
+    drishti::sdk::EyeSegmenter* segmenter,
+    const drishti::sdk::Image3b* images,
+    const bool* isRight,
+    drishti::sdk::Eye* eyes,
+    std::size_t count,
+    int* status)
+{
+    return segmenter ? (*segmenter)(images, isRight, eyes, count, status) : -1;
+}
 DRISHTI_EXTERN_C_END
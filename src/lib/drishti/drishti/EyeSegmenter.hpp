@@ -54,6 +54,19 @@ public:
     explicit operator bool() const;
 
     int operator()(const Image3b& image, Eye& eye, bool isRight);
+
+    /**
+     * Segment a batch of images in parallel with the shared model:
+     * eyes[i] is estimated from images[i] (a right eye if isRight[i]).
+     * @param images input images
+     * @param isRight right/left eye flag per image
+     * @param eyes preallocated output array of count eyes
+     * @param count number of images
+     * @param status optional output array of count per image status codes
+     * @return number of images that could not be segmented
+     */
+    int operator()(const Image3b* images, const bool* isRight, Eye* eyes, std::size_t count, int* status = nullptr);
+
     Eye getMeanEye(int width) const;
 
     void setEyelidInits(int count);
@@ -97,6 +110,15 @@ drishti_eye_segmenter_segment(
     const drishti::sdk::Image3b& image,
     drishti::sdk::Eye& eye, bool isRight);
 
+DRISHTI_EXPORT int
+drishti_eye_segmenter_segment_batch(
+    drishti::sdk::EyeSegmenter* segmenter,
+    const drishti::sdk::Image3b* images,
+    const bool* isRight,
+    drishti::sdk::Eye* eyes,
+    std::size_t count,
+    int* status);
+
 DRISHTI_EXTERN_C_END
 
 #endif /* defined(__drishti_drishti_EyeSegmenter_hpp__) */
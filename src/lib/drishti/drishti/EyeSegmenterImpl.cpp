@@ -16,6 +16,7 @@
 #include "drishti/eye/EyeModelEstimator.h"
 #include "drishti/core/Logger.h"
 #include "drishti/core/make_unique.h"
+#include "drishti/core/Parallel.h"
 
 // OpenCV inlucdes must come before drishti_cv.hpp
 #include <opencv2/core/core.hpp>
@@ -26,15 +27,22 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 // TODO: Store this somewhere in the file
 #define EYE_ASPECT_RATIO (4.0 / 3.0)
 
 #define MINIMUM_EYE_WIDTH 32
 
+// Maximum number of images per batch pass (bounds the working set of large jobs)
+#define EYE_BATCH_SIZE 1024
+
 _DRISHTI_SDK_BEGIN
 
 static std::string kindToHint(ArchiveKind kind);
+static bool hasMinSize(const Image3b& image);
+static cv::Mat3b toRightEye(const Image3b& image, bool isRight);
+static Eye toEye(DRISHTI_EYE::EyeModel& model, const cv::Size& size, bool isRight);
 
 EyeSegmenter::Impl::Impl(bool doLoad)
 {
@@ -72,52 +80,132 @@ int EyeSegmenter::Impl::operator()(const Image3b& image, Eye& eye, bool isRight)
 {
     DRISHTI_STREAM_LOG_FUNC(1, 1, m_streamLogger);
 
-    int status = 0;
-
-    const int minWidth = getMinWidth();
-    const int minHeight = int(float(getMinWidth()) / getRequiredAspectRatio() + 0.5f);
-    if (image.getCols() < minWidth || image.getRows() < minHeight)
+    if (!hasMinSize(image))
     {
         return 1;
     }
 
     //const float aspectRatio  = float(image.cols) / image.rows;
 
+    const int status = segment(image, eye, isRight);
+
+    core::Logger::increment();
+
+    return status;
+}
+
+int EyeSegmenter::Impl::segment(const Image3b& image, Eye& eye, bool isRight)
+{
+    int status = 0;
     try
     {
-        // Create shallow copy of input image
-        cv::Mat3b I = drishtiToCv<Vec3b, cv::Vec3b>(image), If;
+        cv::Mat3b If = toRightEye(image, isRight);
+
+        DRISHTI_EYE::EyeModel model;
+        status = (*m_eme)(If, model);
+        eye = toEye(model, If.size(), isRight);
+    }
+    catch (...)
+    {
+        std::cerr << "exception: EyeSegmenter::Impl::operator()" << std::endl;
+        status = 1;
+    }
+    return status;
+}
+
+int EyeSegmenter::Impl::operator()(const Image3b* images, const bool* isRight, Eye* eyes, std::size_t count, int* status)
+{
+    DRISHTI_STREAM_LOG_FUNC(1, 2, m_streamLogger);
 
-        // If input is left eye, we flop and must allocate a new image:
-        if (!isRight)
+    int failures = 0;
+    auto setStatus = [&](std::size_t i, int code) {
+        failures += (code != 0);
+        if (status)
         {
-            cv::flip(I, If, 1);
+            status[i] = code;
         }
-        else
+    };
+
+    // Large jobs are split into chunks to bound the working set:
+    std::vector<std::size_t> indices;
+    std::vector<cv::Mat> crops;
+    std::vector<DRISHTI_EYE::EyeModel> models;
+    for (std::size_t begin = 0; begin < count; begin += EYE_BATCH_SIZE)
+    {
+        const std::size_t end = std::min(count, begin + EYE_BATCH_SIZE);
+
+        indices.clear();
+        for (std::size_t i = begin; i < end; i++)
         {
-            If = I;
+            if (hasMinSize(images[i]))
+            {
+                indices.push_back(i);
+            }
+            else
+            {
+                setStatus(i, 1);
+            }
         }
 
-        DRISHTI_EYE::EyeModel model;
-        status = (*m_eme)(If, model);
+        // Invalid images are rejected individually:
+        crops.resize(indices.size());
+        drishti::core::ParallelHomogeneousLambda prepare = [&](int k) {
+            try
+            {
+                crops[k] = toRightEye(images[indices[k]], isRight[indices[k]]);
+            }
+            catch (...)
+            {
+                crops[k].release();
+            }
+        };
+        cv::parallel_for_({ 0, int(indices.size()) }, prepare);
+
+        std::size_t valid = 0;
+        for (std::size_t k = 0; k < indices.size(); k++)
+        {
+            if (crops[k].empty())
+            {
+                std::cerr << "exception: EyeSegmenter::Impl::operator()" << std::endl;
+                setStatus(indices[k], 1);
+            }
+            else
+            {
+                indices[valid] = indices[k];
+                crops[valid++] = crops[k];
+            }
+        }
+        indices.resize(valid);
+        crops.resize(valid);
 
-        if (!isRight)
+        try
         {
-            model.flop(If.cols);
+            // All crops share one estimator, which runs each stage over the whole batch:
+            (*m_eme)(crops, models);
+
+            drishti::core::ParallelHomogeneousLambda finish = [&](int k) {
+                eyes[indices[k]] = toEye(models[k], crops[k].size(), isRight[indices[k]]);
+            };
+            cv::parallel_for_({ 0, int(indices.size()) }, finish);
+
+            for (const auto& i : indices)
+            {
+                setStatus(i, 0);
+            }
+        }
+        catch (...)
+        {
+            // Rerun the chunk one image at a time, so a failure doesn't fail its neighbors:
+            for (const auto& i : indices)
+            {
+                setStatus(i, segment(images[i], eyes[i], isRight[i]));
+            }
         }
-        model.refine();
-        model.roi = cv::Rect({ 0, 0 }, If.size()); // default roi
-        eye = convert(model);
-    }
-    catch (...)
-    {
-        std::cerr << "exception: EyeSegmenter::Impl::operator()" << std::endl;
-        status = 1;
     }
 
     core::Logger::increment();
 
-    return status;
+    return failures;
 }
 
 Eye EyeSegmenter::Impl::getMeanEye(int width) const
@@ -169,6 +257,43 @@ float EyeSegmenter::Impl::getRequiredAspectRatio()
 
 // ### utility ###
 
+static bool hasMinSize(const Image3b& image)
+{
+    const int minWidth = EyeSegmenter::Impl::getMinWidth();
+    const int minHeight = int(float(minWidth) / EyeSegmenter::Impl::getRequiredAspectRatio() + 0.5f);
+    return (image.getCols() >= minWidth) && (image.getRows() >= minHeight);
+}
+
+static cv::Mat3b toRightEye(const Image3b& image, bool isRight)
+{
+    CV_Assert(image.ptr<Vec3b>() && (image.getStride() >= (image.getCols() * sizeof(Vec3b))));
+
+    // Create shallow copy of input image
+    cv::Mat3b I = drishtiToCv<Vec3b, cv::Vec3b>(image), If;
+
+    // If input is left eye, we flop and must allocate a new image:
+    if (!isRight)
+    {
+        cv::flip(I, If, 1);
+    }
+    else
+    {
+        If = I;
+    }
+    return If;
+}
+
+static Eye toEye(DRISHTI_EYE::EyeModel& model, const cv::Size& size, bool isRight)
+{
+    if (!isRight)
+    {
+        model.flop(size.width);
+    }
+    model.refine();
+    model.roi = cv::Rect({ 0, 0 }, size); // default roi
+    return convert(model);
+}
+
 static std::string kindToHint(ArchiveKind kind)
 {
     switch (kind)
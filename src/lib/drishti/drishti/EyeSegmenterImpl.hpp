@@ -34,6 +34,7 @@ public:
     Impl(std::istream& is, ArchiveKind kind);
     ~Impl();
     int operator()(const Image3b& image, Eye& eye, bool isRight);
+    int operator()(const Image3b* images, const bool* isRight, Eye* eyes, std::size_t count, int* status);
 
     Eye getMeanEye(int width) const;
 
@@ -52,6 +53,9 @@ public:
 protected:
     void init(std::istream& is, ArchiveKind);
 
+    // Single image segmentation (exceptions are reported as a failure):
+    int segment(const Image3b& image, Eye& eye, bool isRight);
+
     std::unique_ptr<eye::EyeModelEstimator> m_eme;
 
     std::shared_ptr<spdlog::logger> m_streamLogger;
@@ -433,6 +433,86 @@ TEST_F(EyeSegmenterTest, ImageIsWhite)
     }
 }
 
+// Batch results must match the single image results (with mixed left and right eyes):
+TEST_F(EyeSegmenterTest, ImageBatch)
+{
+    if (m_eyeSegmenter)
+    {
+        const int minWidth = m_eyeSegmenter->getMinWidth();
+        ASSERT_GT(m_images.size(), minWidth);
+
+        std::vector<drishti::sdk::Image3b> images;
+        std::unique_ptr<bool[]> isRight(new bool[m_images.size()]);
+        for (int i = 0; i < m_images.size(); i++)
+        {
+            images.push_back(m_images[i].image);
+            isRight[i] = (i % 2) == 0;
+        }
+
+        std::vector<drishti::sdk::Eye> eyes(images.size());
+        std::vector<int> status(images.size(), -1);
+        int failures = (*m_eyeSegmenter)(images.data(), isRight.get(), eyes.data(), images.size(), status.data());
+        EXPECT_EQ(failures, minWidth);
+
+        for (int i = 0; i < m_images.size(); i++)
+        {
+            if (i < minWidth)
+            {
+                EXPECT_EQ(status[i], 1);
+                continue;
+            }
+
+            EXPECT_EQ(status[i], 0);
+            checkValid(eyes[i], m_images[i].storage.size());
+
+            drishti::sdk::Eye eye;
+            (*m_eyeSegmenter)(m_images[i].image, eye, isRight[i]);
+            ASSERT_GT(detectionScore(eyes[i], eye), 0.99f);
+        }
+    }
+}
+
+// An invalid image (no pixel data) fails on its own without failing its neighbors:
+TEST_F(EyeSegmenterTest, ImageBatchInvalid)
+{
+    if (m_eyeSegmenter)
+    {
+        const int minWidth = m_eyeSegmenter->getMinWidth();
+        ASSERT_GT(m_images.size(), minWidth + 2);
+
+        const int bad = 1;
+        std::vector<drishti::sdk::Image3b> images;
+        std::unique_ptr<bool[]> isRight(new bool[3]);
+        for (int i = 0; i < 3; i++)
+        {
+            const auto& image = m_images[minWidth + i].image;
+            images.push_back((i == bad) ? drishti::sdk::Image3b(image.getRows(), image.getCols(), nullptr, image.getStride()) : image);
+            isRight[i] = m_images[minWidth + i].isRight;
+        }
+
+        std::vector<drishti::sdk::Eye> eyes(images.size());
+        std::vector<int> status(images.size(), -1);
+        int failures = (*m_eyeSegmenter)(images.data(), isRight.get(), eyes.data(), images.size(), status.data());
+        EXPECT_EQ(failures, 1);
+
+        for (int i = 0; i < images.size(); i++)
+        {
+            if (i == bad)
+            {
+                EXPECT_EQ(status[i], 1);
+                continue;
+            }
+
+            EXPECT_EQ(status[i], 0);
+            checkValid(eyes[i], m_images[minWidth + i].storage.size());
+
+            drishti::sdk::Eye eye;
+            (*m_eyeSegmenter)(images[i], eye, isRight[i]);
+            ASSERT_GT(detectionScore(eyes[i], eye), 0.99f);
+        }
+    }
+}
+
 #ifdef DRISHTI_BUILD_C_INTERFACE
 TEST_F(EyeSegmenterTest, ExternCInterface)
 {
@@ -464,6 +544,34 @@ TEST_F(EyeSegmenterTest, ExternCInterface)
         }
     }
 }
+
+TEST_F(EyeSegmenterTest, ExternCInterfaceBatch)
+{
+    auto segmenter = createC(modelFilename);
+
+    if (segmenter)
+    {
+        const int minWidth = m_eyeSegmenter->getMinWidth();
+        ASSERT_GT(m_images.size(), minWidth);
+
+        std::vector<drishti::sdk::Image3b> images;
+        std::unique_ptr<bool[]> isRight(new bool[m_images.size()]);
+        for (int i = minWidth; i < m_images.size(); i++)
+        {
+            images.push_back(m_images[i].image);
+            isRight[images.size() - 1] = m_images[i].isRight;
+        }
+
+        std::vector<drishti::sdk::Eye> eyes(images.size());
+        int failures = drishti_eye_segmenter_segment_batch(segmenter.get(), images.data(), isRight.get(), eyes.data(), images.size(), nullptr);
+        EXPECT_EQ(failures, 0);
+
+        for (int i = 0; i < images.size(); i++)
+        {
+            checkValid(eyes[i], m_images[i + minWidth].storage.size());
+        }
+    }
+}
 #endif // DRISHTI_BUILD_C_INTERFACE
 
 // #######
@@ -14,6 +14,7 @@
 #include "drishti/eye/Eye.h"
 #include "drishti/core/drishti_stdlib_string.h" // FIRST
 #include "drishti/core/Shape.h"
+#include "drishti/eye/EyeRasterizer.h"
 #include "drishti/geometry/Ellipse.h"
 
 // clang-format off
@@ -40,7 +41,6 @@ DRISHTI_EYE_NAMESPACE_BEGIN
 
 typedef std::vector<cv::Point2f> PointVec;
 static std::vector<PointVec> ellipseToContours(const cv::RotatedRect& ellipse, const PointVec& eyelids = {});
-static void fillPolly(cv::Mat& image, const PointVec& polly, const cv::Scalar& value);
 
 std::vector<cv::Point2f> EyeModel::getUpperEyelid() const
 {
@@ -218,19 +218,9 @@ void EyeModel::estimateIrisLandmarks(cv::Point2f& irisCenter, cv::Point2f& irisI
 
 cv::Mat EyeModel::irisMask(const cv::Size& size, bool removeEyelids) const
 {
-    cv::Mat1b mask(size, 0);
-    try
-    {
-        cv::ellipse(mask, irisEllipse, 255, -1, 4);
-    }
-    catch (...)
-    {
-    }
-    if (removeEyelids)
-    {
-        mask &= this->mask(size, false);
-    }
-    return mask;
+    EyeMasks masks;
+    rasterize(*this, size, masks, EyeMasks::kIris, 1.f, removeEyelids);
+    return masks.iris;
 }
 
 cv::Mat EyeModel::labels(const cv::Size& size) const
@@ -240,51 +230,22 @@ cv::Mat EyeModel::labels(const cv::Size& size) const
         return cv::Mat1b();
     }
 
-    const auto& curve = eyelidsSpline.size() ? eyelidsSpline : eyelids;
-
-    // Eye mask:
-    cv::Mat1b eyeMask = cv::Mat1b::zeros(size);
-    fillPolly(eyeMask, curve, 255);
-
-    // Iris mask:
-    cv::Mat1b irisMask = cv::Mat1b::zeros(size);
-    cv::ellipse(irisMask, irisEllipse, 255, -1);
-
-    eyeMask.setTo(127, (eyeMask & irisMask));
-
-    return eyeMask;
+    EyeMasks masks;
+    rasterize(*this, size, masks, EyeMasks::kLabels);
+    return masks.labels;
 }
 
 cv::Mat EyeModel::mask(const cv::Size& size, bool sclera, float irisScale) const
 {
-    cv::Mat1b mask;
-
-    if (size.area() == 0)
-    {
-        return mask;
-    }
-
     const auto& curve = eyelidsSpline.size() ? eyelidsSpline : eyelids;
-    if (curve.size())
+    if ((size.area() == 0) || curve.empty())
     {
-        mask = cv::Mat1b::zeros(size);
-        fillPolly(mask, curve, 255);
-
-        if (sclera && irisEllipse.size.width)
-        {
-            cv::RotatedRect ellipse = irisEllipse;
-            ellipse.size = ellipse.size * irisScale;
-            try
-            {
-                cv::ellipse(mask, ellipse, 0, -1);
-            }
-            catch (...)
-            {
-            }
-        }
+        return cv::Mat1b();
     }
 
-    return mask;
+    EyeMasks masks;
+    rasterize(*this, size, masks, sclera ? EyeMasks::kSclera : EyeMasks::kEye, irisScale);
+    return sclera ? masks.sclera : masks.eye;
 }
 
 std::vector<std::vector<cv::Point2f>> EyeModel::getContours(bool doPupil) const
@@ -622,14 +583,6 @@ void read(const cv::FileNode& node, DRISHTI_EYE::EyeModel& x, const DRISHTI_EYE:
 
 // ==========
 
-static void fillPolly(cv::Mat& image, const PointVec& polly, const cv::Scalar& value)
-{
-    std::vector<std::vector<cv::Point>> contours(1);
-    contours[0].resize(polly.size());
-    std::copy(polly.begin(), polly.end(), contours[0].begin());
-    cv::fillPoly(image, contours, 255, 4);
-}
-
 // http://stackoverflow.com/a/23214219
 static int mod(int k, int n)
 {
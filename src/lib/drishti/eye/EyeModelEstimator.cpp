@@ -36,7 +36,7 @@ DRISHTI_EYE_NAMESPACE_BEGIN
 #if DRISHTI_EYE_USE_DARK_CHANNEL
 static cv::Mat getDarkChannel(const cv::Mat& I);
 #endif
-static float resizeEye(const cv::Mat& src, cv::Mat& dst, float width);
+static cv::Rect getApertureRoi(const EyeModel& eye);
 
 // TODO: support for stream input
 EyeModelEstimator::Impl::Impl(const std::string& eyeRegressor, const std::string& irisRegressor, const std::string& pupilRegressor)
@@ -110,29 +110,31 @@ int EyeModelEstimator::Impl::operator()(const cv::Mat& crop, EyeModel& eye) cons
 {
     DRISHTI_STREAM_LOG_FUNC(2, 4, m_streamLogger);
 
-    cv::Mat I;
-    float scale = resizeEye(crop, I, m_targetWidth), scaleInv = (1.0 / scale);
+    EyeChannels coarse, fine;
 
-    cv::Mat Ic[3]{ I }, dark, blue, red;
-    if (I.channels() == 3)
     {
-        cv::split(I, Ic);
+        drishti::core::ScopeTimeLogger coarseTimer = [this](double elapsed) {
+            if (m_coarseTimeLogger)
+            {
+                m_coarseTimeLogger(elapsed);
+            }
+        };
 
-#if DRISHTI_EYE_USE_DARK_CHANNEL
-        // Dark channel:
-        dark = getDarkChannel(I);
-#endif
-        blue = Ic[0];
-        red = Ic[2];
-    }
-    else
-    {
-        //dark = I;
-        blue = red = I;
+        createEyeChannels(crop, getEyeScale(crop, getEyelidTargetWidth()), coarse);
+
+        // ######## Find the eyelids #########
+        segmentEyelids(coarse.blue, eye);
     }
 
-    // ######## Find the eyelids #########
-    segmentEyelids(blue, eye);
+    drishti::core::ScopeTimeLogger fineTimer = [this](double elapsed) {
+        if (m_fineTimeLogger)
+        {
+            m_fineTimeLogger(elapsed);
+        }
+    };
+
+    const EyeChannels& level = createFineLevel(crop, coarse, eye, fine);
+    const cv::Mat& red = level.red;
 
     if (m_doIndependentIrisAndPupil)
     {
@@ -143,19 +145,7 @@ int EyeModelEstimator::Impl::operator()(const cv::Mat& crop, EyeModel& eye) cons
             if (m_irisEstimator)
             {
                 segmentIris(red, eye);
-
-                {
-                    // If point-wise estimates match the iris regressor, then update our landmarks
-                    cv::Point2f irisCenter, innerLimbus, outerLimbus;
-                    eye.estimateIrisLandmarks(irisCenter, innerLimbus, outerLimbus);
-                    eye.irisCenter = irisCenter;
-                    eye.irisInner = innerLimbus;
-                    eye.irisOuter = outerLimbus;
-                }
-
-                eye.iris = 0.f; // drop the circular initial estimate
-                eye.pupil = 0.f;
-                eye.pupilEllipse.center = eye.irisEllipse.center;
+                updateIrisLandmarks(eye);
 
                 if (m_pupilEstimator && m_doPupil && eye.irisEllipse.size.area() > 0.f)
                 {
@@ -172,14 +162,173 @@ int EyeModelEstimator::Impl::operator()(const cv::Mat& crop, EyeModel& eye) cons
     }
 
     // Scale up the model
-    if (scaleInv != 1.0f)
+    eye = toCrop(eye, level);
+
+    return 0;
+}
+
+int EyeModelEstimator::Impl::operator()(const std::vector<cv::Mat>& crops, std::vector<EyeModel>& eyes) const
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 36, m_streamLogger);
+
+    const int n = static_cast<int>(crops.size());
+    eyes.resize(n);
+
+    std::vector<EyeChannels> coarse(n), fine(n);
+
     {
-        eye = eye * scaleInv;
+        drishti::core::ScopeTimeLogger coarseTimer = [this](double elapsed) {
+            if (m_coarseTimeLogger)
+            {
+                m_coarseTimeLogger(elapsed);
+            }
+        };
+
+        const float width = getEyelidTargetWidth();
+        drishti::core::ParallelHomogeneousLambda prepare = [&](int i) {
+            createEyeChannels(crops[i], getEyeScale(crops[i], width), coarse[i]);
+        };
+        cv::parallel_for_({ 0, n }, prepare);
+
+        // ######## Find the eyelids #########
+        // One work item per (crop, init), the first init of each crop starts at offsets[i]:
+        std::vector<std::pair<int, cv::Rect>> eyelidInits;
+        std::vector<int> offsets(n);
+        for (int i = 0; i < n; i++)
+        {
+            offsets[i] = static_cast<int>(eyelidInits.size());
+            for (const auto& roi : createEyelidInits(coarse[i].blue.size()))
+            {
+                eyelidInits.emplace_back(i, roi);
+            }
+        }
+
+        std::vector<PointVec> poses(eyelidInits.size());
+        drishti::core::ParallelHomogeneousLambda eyelids = [&](int j) {
+            const auto& init = eyelidInits[j];
+            estimateEyelids(coarse[init.first].blue, init.second, poses[j]);
+        };
+        cv::parallel_for_({ 0, int(eyelidInits.size()) }, eyelids);
+
+        for (int i = 0; i < n; i++)
+        {
+            eyes[i] = shapeToEye(poses[offsets[i]], m_eyeSpec);
+        }
+    }
+
+    drishti::core::ScopeTimeLogger fineTimer = [this](double elapsed) {
+        if (m_fineTimeLogger)
+        {
+            m_fineTimeLogger(elapsed);
+        }
+    };
+
+    std::vector<const EyeChannels*> levels(n);
+    drishti::core::ParallelHomogeneousLambda refine = [&](int i) {
+        levels[i] = &createFineLevel(crops[i], coarse[i], eyes[i], fine[i]);
+    };
+    cv::parallel_for_({ 0, n }, refine);
+
+    if (m_doIndependentIrisAndPupil)
+    {
+        // ((((( Do iris estimate )))))
+        // One work item per (crop, restart) over all open eyes:
+        std::vector<cv::Mat1b> masks(n);
+        std::vector<std::pair<int, cv::RotatedRect>> irisInits;
+        std::vector<int> open;
+        for (int i = 0; i < n; i++)
+        {
+            if (eyes[i].openness() > m_opennessThrehsold)
+            {
+                if (m_irisEstimator)
+                {
+                    EllipseVec irises;
+                    createIrisInits(levels[i]->red, eyes[i], masks[i], irises);
+                    for (const auto& iris : irises)
+                    {
+                        irisInits.emplace_back(i, iris);
+                    }
+                    open.push_back(i);
+                }
+            }
+            else
+            {
+                // for squinting eyes defer to limbus point estimate:
+                eyes[i].irisEllipse = estimateIrisFromLimbusPoints(eyes[i]);
+                eyes[i].pupilEllipse.center = eyes[i].irisEllipse.center;
+            }
+        }
+
+        EllipseVec estimates(irisInits.size());
+        drishti::core::ParallelHomogeneousLambda irises = [&](int j) {
+            const int i = irisInits[j].first;
+            estimates[j] = estimateIris(levels[i]->red, masks[i], irisInits[j].second);
+        };
+        cv::parallel_for_({ 0, int(irisInits.size()) }, irises);
+
+        std::vector<EllipseVec> estimatesPerEye(n);
+        for (int j = 0; j < irisInits.size(); j++)
+        {
+            estimatesPerEye[irisInits[j].first].push_back(estimates[j]);
+        }
+
+        std::vector<int> pupils;
+        for (auto i : open)
+        {
+            if (!estimatesPerEye[i].empty())
+            {
+                setIris(eyes[i], estimatesPerEye[i]);
+            }
+            updateIrisLandmarks(eyes[i]);
+
+            if (m_pupilEstimator && m_doPupil && eyes[i].irisEllipse.size.area() > 0.f)
+            {
+                pupils.push_back(i);
+            }
+        }
+
+        // Each pupil is already a single batched cascade pass, so run one per eye:
+        drishti::core::ParallelHomogeneousLambda pupil = [&](int k) {
+            segmentPupil(levels[pupils[k]]->red, eyes[pupils[k]]);
+        };
+        cv::parallel_for_({ 0, int(pupils.size()) }, pupil);
+    }
+
+    // Scale up the models
+    for (int i = 0; i < n; i++)
+    {
+        eyes[i] = toCrop(eyes[i], *levels[i]);
     }
 
     return 0;
 }
 
+// Coarse-to-fine: the eyelid estimate is mapped from the coarse level to the
+// fine level, which covers the predicted aperture at the target width scale.
+// Without a coarse level the eyelid level is reused for the refinement.
+const EyeChannels& EyeModelEstimator::Impl::createFineLevel(const cv::Mat& crop, const EyeChannels& coarse, EyeModel& eye, EyeChannels& fine) const
+{
+    if (!isCoarseToFine())
+    {
+        return coarse;
+    }
+
+    eye = toCrop(eye, coarse);
+
+    const cv::Rect bounds({ 0, 0 }, crop.size());
+    cv::Rect roi = getApertureRoi(eye) & bounds;
+    if (roi.area() == 0)
+    {
+        roi = bounds;
+    }
+
+    createEyeChannels(crop(roi), getEyeScale(crop, m_targetWidth), fine);
+    fine.tl = roi.tl();
+
+    eye = toLevel(eye, fine);
+    return fine;
+}
+
 //====
 
 EyeModelEstimator::EyeModelEstimator(std::istream& is, const std::string& hint)
@@ -276,12 +425,42 @@ int EyeModelEstimator::operator()(const cv::Mat& crop, EyeModel& eye) const
     return (*m_impl)(crop, eye);
 }
 
+int EyeModelEstimator::operator()(const std::vector<cv::Mat>& crops, std::vector<EyeModel>& eyes) const
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 37, m_streamLogger);
+    return (*m_impl)(crops, eyes);
+}
+
+int EyeModelEstimator::operator()(const cv::Mat& crop, const EyeModel& previous, const cv::Matx33f& H, EyeModel& eye, bool* isTracked) const
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 42, m_streamLogger);
+    return (*m_impl)(crop, previous, H, eye, isTracked);
+}
+
 void EyeModelEstimator::normalize(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, int padding) const
 {
     DRISHTI_STREAM_LOG_FUNC(2, 10, m_streamLogger);
     return m_impl->normalize(crop, eye, size, code, padding);
 }
 
+bool EyeModelEstimator::normalize(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, IrisQuality& quality, int padding) const
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 48, m_streamLogger);
+    return m_impl->normalize(crop, eye, size, code, quality, padding);
+}
+
+IrisQuality EyeModelEstimator::getIrisQuality(const cv::Mat& crop, const EyeModel& eye) const
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 49, m_streamLogger);
+    return m_impl->getIrisQuality(crop, eye);
+}
+
+void EyeModelEstimator::setIrisQualityRecipe(const IrisQualityEstimator::Recipe& recipe)
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 50, m_streamLogger);
+    m_impl->setIrisQualityRecipe(recipe);
+}
+
 void EyeModelEstimator::setEyelidInits(int n)
 {
     DRISHTI_STREAM_LOG_FUNC(2, 12, m_streamLogger);
@@ -318,6 +497,51 @@ void EyeModelEstimator::setTargetWidth(int width)
     m_impl->setTargetWidth(width);
 }
 
+void EyeModelEstimator::setCoarseTargetWidth(int width)
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 38, m_streamLogger);
+    m_impl->setCoarseTargetWidth(width);
+}
+int EyeModelEstimator::getCoarseTargetWidth() const
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 39, m_streamLogger);
+    return m_impl->getCoarseTargetWidth();
+}
+
+void EyeModelEstimator::setTrackingIrisStages(int stages)
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 43, m_streamLogger);
+    m_impl->setTrackingIrisStages(stages);
+}
+int EyeModelEstimator::getTrackingIrisStages() const
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 44, m_streamLogger);
+    return m_impl->getTrackingIrisStages();
+}
+
+void EyeModelEstimator::setTrackingMaxResidual(float value)
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 45, m_streamLogger);
+    m_impl->setTrackingMaxResidual(value);
+}
+float EyeModelEstimator::getTrackingMaxResidual() const
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 46, m_streamLogger);
+    return m_impl->getTrackingMaxResidual();
+}
+
+void EyeModelEstimator::setCoarseTimeLogger(TimeLoggerType logger)
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 40, m_streamLogger);
+    m_impl->setCoarseTimeLogger(logger);
+}
+
+void EyeModelEstimator::setFineTimeLogger(TimeLoggerType logger)
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 41, m_streamLogger);
+    m_impl->setFineTimeLogger(logger);
+}
+
 void EyeModelEstimator::setOpennessThreshold(float threshold)
 {
     DRISHTI_STREAM_LOG_FUNC(2, 18, m_streamLogger);
@@ -419,19 +643,85 @@ int EyeModelEstimator::getIrisStagesRepetitionFactor() const
     return m_impl->getIrisStagesRepetitionFactor();
 }
 
-static float resizeEye(const cv::Mat& src, cv::Mat& dst, float width)
+float getEyeScale(const cv::Mat& crop, float width)
+{
+    return (crop.cols < width) ? 1.f : (float(width) / float(crop.cols));
+}
+
+void createEyeChannels(const cv::Mat& image, float scale, EyeChannels& channels)
 {
-    float scale = 1.f;
-    if (src.cols < width)
+    cv::Mat I;
+    if (scale != 1.f)
+    {
+        cv::resize(image, I, {}, scale, scale, cv::INTER_CUBIC);
+    }
+    else
     {
-        dst = src;
+        I = image;
+    }
+    channels.scale = scale;
+
+    cv::Mat Ic[3]{ I }, dark;
+    if (I.channels() == 3)
+    {
+        cv::split(I, Ic);
+
+#if DRISHTI_EYE_USE_DARK_CHANNEL
+        // Dark channel:
+        dark = getDarkChannel(I);
+#endif
+        channels.blue = Ic[0];
+        channels.red = Ic[2];
     }
     else
     {
-        scale = float(width) / float(src.cols);
-        cv::resize(src, dst, {}, scale, scale, cv::INTER_CUBIC);
+        //dark = I;
+        channels.blue = channels.red = I;
+    }
+}
+
+// Eyelid aperture with a margin, extended vertically to contain an iris
+// that is partially occluded by the eyelids:
+static cv::Rect getApertureRoi(const EyeModel& eye)
+{
+    const cv::Rect box = cv::boundingRect(eye.eyelids);
+    const cv::Point2f center(box.x + box.width * 0.5f, box.y + box.height * 0.5f);
+    const cv::Point2f diag(box.width * 0.6f, std::max(float(box.height), box.width * 0.5f) * 0.6f);
+    return cv::Rect(center - diag, center + diag);
+}
+
+EyeModel toCrop(const EyeModel& eye, const EyeChannels& level)
+{
+    EyeModel result = (level.scale != 1.f) ? (eye * (1.0f / level.scale)) : eye;
+    if (level.tl != cv::Point2f())
+    {
+        result += level.tl;
     }
-    return scale;
+    return result;
+}
+
+EyeModel toLevel(const EyeModel& eye, const EyeChannels& level)
+{
+    EyeModel result = eye;
+    if (level.tl != cv::Point2f())
+    {
+        result -= level.tl;
+    }
+    return (level.scale != 1.f) ? (result * level.scale) : result;
+}
+
+// If point-wise estimates match the iris regressor, then update our landmarks
+void updateIrisLandmarks(EyeModel& eye)
+{
+    cv::Point2f irisCenter, innerLimbus, outerLimbus;
+    eye.estimateIrisLandmarks(irisCenter, innerLimbus, outerLimbus);
+    eye.irisCenter = irisCenter;
+    eye.irisInner = innerLimbus;
+    eye.irisOuter = outerLimbus;
+
+    eye.iris = 0.f; // drop the circular initial estimate
+    eye.pupil = 0.f;
+    eye.pupilEllipse.center = eye.irisEllipse.center;
 }
 
 #if DRISHTI_EYE_USE_DARK_CHANNEL
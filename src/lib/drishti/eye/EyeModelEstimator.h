@@ -20,6 +20,7 @@
 #include "drishti/eye/drishti_eye.h"
 #include "drishti/eye/Eye.h"
 #include "drishti/eye/NormalizedIris.h"
+#include "drishti/eye/IrisQuality.h"
 
 #include "drishti/core/Logger.h"
 
@@ -29,7 +30,9 @@
 #endif
 // clang-format on
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 DRISHTI_EYE_NAMESPACE_BEGIN
 
@@ -38,6 +41,8 @@ class EyeModelEstimator
 public:
     class Impl;
 
+    typedef std::function<void(double seconds)> TimeLoggerType;
+
     struct RegressorConfig
     {
         std::string eyeRegressor;
@@ -58,6 +63,27 @@ public:
 
     virtual int operator()(const cv::Mat& crop, EyeModel& eye) const;
 
+    // Batch estimation for many crops (i.e., both eyes of all faces in a frame):
+    // each stage runs across all crops at once, with the eyelid inits and iris
+    // restarts of every eye expanded into one flat list on the thread pool.
+    virtual int operator()(const std::vector<cv::Mat>& crops, std::vector<EyeModel>& eyes) const;
+
+    // Tracking: the previous frame's fit (crop coordinates) warped by the frame to
+    // frame eye motion H initializes the eyelid and iris regressors, which run
+    // shortened cascades.  A full fit is run instead when the track is lost (i.e.,
+    // blinks and occlusions), isTracked (optional) reports which one was used.  Only
+    // the iris cascade is shortened: without a warm start tail (none of the shipped
+    // eyelid models has one) the eyelids run the full cascade plus a residual check.
+    virtual int operator()(const cv::Mat& crop, const EyeModel& previous, const cv::Matx33f& H, EyeModel& eye, bool* isTracked = nullptr) const;
+
+    // Number of trailing iris cascade stages applied to a tracked iris:
+    void setTrackingIrisStages(int stages);
+    int getTrackingIrisStages() const;
+
+    // Max displacement of a tracked fit from its prior (relative to the eye width):
+    void setTrackingMaxResidual(float value);
+    float getTrackingMaxResidual() const;
+
     void setOpennessThreshold(float threshold);
     float getOpennessThreshold() const;
 
@@ -65,9 +91,26 @@ public:
 
     void normalize(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, int padding = 0) const;
 
+    // Normalization gated by a fast quality assessment: unusable irises (quality.isGood() == false)
+    // are not normalized, which lets callers skip the encoding of frames that will never match.
+    bool normalize(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, IrisQuality& quality, int padding = 0) const;
+
+    IrisQuality getIrisQuality(const cv::Mat& crop, const EyeModel& eye) const;
+    void setIrisQualityRecipe(const IrisQualityEstimator::Recipe& recipe);
+
     void setDoIndependentIrisAndPupil(bool flag);
 
     void setTargetWidth(int width);
+
+    // Coarse-to-fine estimation: eyelids are estimated at the coarse width, then
+    // iris and pupil refinement runs at the target width within the predicted
+    // eyelid aperture only (0: eyelids and iris at the target width).
+    void setCoarseTargetWidth(int width);
+    int getCoarseTargetWidth() const;
+
+    // Per level timings (coarse: eyelids, fine: iris and pupil refinement):
+    void setCoarseTimeLogger(TimeLoggerType logger);
+    void setFineTimeLogger(TimeLoggerType logger);
     void setDoPupil(bool flag);
     bool getDoPupil() const;
 
@@ -13,6 +13,7 @@
 
 #include "drishti/eye/EyeModelEstimator.h"
 #include "drishti/eye/IrisNormalizer.h"
+#include "drishti/eye/IrisQuality.h"
 #include "drishti/eye/EyeIO.h"
 #include "drishti/ml/ShapeEstimator.h"
 #include "drishti/ml/RegressionTreeEnsembleShapeEstimator.h"
@@ -32,6 +33,8 @@ DRISHTI_EYE_NAMESPACE_BEGIN
 using EllipseVec = std::vector<cv::RotatedRect>;
 
 #define EYE_OPENNESS_IRIS_THRESHOLD 0.10
+#define EYE_TRACKING_IRIS_STAGES 8
+#define EYE_TRACKING_MAX_RESIDUAL 0.10
 
 template <typename T>
 T median(std::vector<T>& params)
@@ -43,6 +46,26 @@ T median(std::vector<T>& params)
 
 using DRISHTI_EYE::operator*;
 
+// Regression level of an eye crop: resized channels for eyelid (blue) and
+// iris (red) regression, crop coordinates are (p / scale) + tl:
+struct EyeChannels
+{
+    cv::Mat blue, red;
+    float scale = 1.f;
+    cv::Point2f tl;
+};
+
+// Scale of the regression level for an eye crop (crops are never upsampled):
+float getEyeScale(const cv::Mat& crop, float width);
+void createEyeChannels(const cv::Mat& image, float scale, EyeChannels& channels);
+
+// Map eye models between crop and level coordinates:
+EyeModel toCrop(const EyeModel& eye, const EyeChannels& level);
+EyeModel toLevel(const EyeModel& eye, const EyeChannels& level);
+
+// Update the iris landmarks from the refined iris ellipse:
+void updateIrisLandmarks(EyeModel& eye);
+
 class EyeModelEstimator::Impl
 {
 public:
@@ -74,6 +97,16 @@ public:
         return m_irisEstimator->getStagesHint();
     }
 
+    // Regressors (i.e., for validation of the model internals):
+    const ml::ShapeEstimator* getIrisEstimator() const
+    {
+        return m_irisEstimator.get();
+    }
+    const ml::ShapeEstimator* getPupilEstimator() const
+    {
+        return m_pupilEstimator.get();
+    }
+
     void setIrisStagesRepetitionFactor(int x)
     {
         m_irisEstimator->setStagesRepetitionFactor(x);
@@ -106,6 +139,51 @@ public:
         m_targetWidth = width;
     }
 
+    void setCoarseTargetWidth(int width)
+    {
+        m_coarseTargetWidth = width;
+    }
+    int getCoarseTargetWidth() const
+    {
+        return m_coarseTargetWidth;
+    }
+
+    bool isCoarseToFine() const
+    {
+        return (m_coarseTargetWidth > 0) && (m_coarseTargetWidth < m_targetWidth);
+    }
+    int getEyelidTargetWidth() const
+    {
+        return isCoarseToFine() ? m_coarseTargetWidth : m_targetWidth;
+    }
+
+    void setTrackingIrisStages(int stages)
+    {
+        m_trackingIrisStages = stages;
+    }
+    int getTrackingIrisStages() const
+    {
+        return m_trackingIrisStages;
+    }
+
+    void setTrackingMaxResidual(float value)
+    {
+        m_trackingMaxResidual = value;
+    }
+    float getTrackingMaxResidual() const
+    {
+        return m_trackingMaxResidual;
+    }
+
+    void setCoarseTimeLogger(TimeLoggerType logger)
+    {
+        m_coarseTimeLogger = logger;
+    }
+    void setFineTimeLogger(TimeLoggerType logger)
+    {
+        m_fineTimeLogger = logger;
+    }
+
     void setDoPupil(bool flag)
     {
         m_doPupil = flag;
@@ -128,9 +206,29 @@ public:
     // Red channel is closest to NIR for iris
     // TODO: Need a lazy image conversion type
     int operator()(const cv::Mat& crop, EyeModel& eye) const;
+    int operator()(const std::vector<cv::Mat>& crops, std::vector<EyeModel>& eyes) const;
+    int operator()(const cv::Mat& crop, const EyeModel& previous, const cv::Matx33f& H, EyeModel& eye, bool* isTracked) const;
     void normalize(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, int padding = 0) const
     {
-        IrisNormalizer()(crop, eye, size, code, padding);
+        m_irisNormalizer(crop, eye, size, code, padding); // reuses maps across calls
+    }
+    bool normalize(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, IrisQuality& quality, int padding = 0) const
+    {
+        quality = m_irisQualityEstimator(crop, eye);
+        if (quality.isGood())
+        {
+            normalize(crop, eye, size, code, padding);
+        }
+        return quality.isGood();
+    }
+
+    IrisQuality getIrisQuality(const cv::Mat& crop, const EyeModel& eye) const
+    {
+        return m_irisQualityEstimator(crop, eye);
+    }
+    void setIrisQualityRecipe(const IrisQualityEstimator::Recipe& recipe)
+    {
+        m_irisQualityEstimator = IrisQualityEstimator(recipe);
     }
 
     cv::Mat drawMeanShape(const cv::Size& size) const
@@ -208,7 +306,19 @@ public:
     }
 
 private:
-    cv::RotatedRect estimateCentralIris(const cv::Mat& I, const cv::Mat& M, const EllipseVec& irses) const;
+    const EyeChannels& createFineLevel(const cv::Mat& crop, const EyeChannels& coarse, EyeModel& eye, EyeChannels& fine) const;
+
+    EllipseVec estimateIrises(const cv::Mat& I, const cv::Mat& M, const EllipseVec& irises) const;
+
+    // Per init stages shared by the single and batch estimators:
+    std::vector<cv::Rect> createEyelidInits(const cv::Size& size) const;
+    void estimateEyelids(const cv::Mat& I, const cv::Rect& roi, PointVec& pose) const;
+    void createIrisInits(const cv::Mat& I, const EyeModel& eye, cv::Mat1b& M, EllipseVec& irises) const;
+    cv::RotatedRect estimateIris(const cv::Mat& I, const cv::Mat& M, const cv::RotatedRect& iris) const;
+    void setIris(EyeModel& eye, const EllipseVec& estimates) const;
+
+    bool trackEyelids(const cv::Mat& I, const EyeModel& prior, EyeModel& eye) const;
+    bool trackIris(const cv::Mat& I, const EyeModel& prior, EyeModel& eye) const;
 
     void segmentPupil(const cv::Mat& I, EyeModel& eye, int targetWidth = 128) const;
     void segmentIris(const cv::Mat& I, EyeModel& eye) const;
@@ -224,12 +334,16 @@ protected:
 
     int m_optimizationLevel = 10;
     int m_targetWidth = 256;
+    int m_coarseTargetWidth = 0; // eyelid level width (0: single level)
     bool m_doVerbose = false;
     int m_eyelidInits = 1;
     int m_irisInits = 1;
 
     float m_opennessThrehsold = EYE_OPENNESS_IRIS_THRESHOLD;
 
+    int m_trackingIrisStages = EYE_TRACKING_IRIS_STAGES;
+    float m_trackingMaxResidual = EYE_TRACKING_MAX_RESIDUAL;
+
     bool m_doMask = false;
     bool m_useHierarchy = true;
     bool m_doPupil = true;
@@ -238,6 +352,12 @@ protected:
     std::shared_ptr<ml::ShapeEstimator> m_irisEstimator;
     std::shared_ptr<ml::ShapeEstimator> m_pupilEstimator;
 
+    IrisNormalizer m_irisNormalizer;
+    IrisQualityEstimator m_irisQualityEstimator;
+
+    TimeLoggerType m_coarseTimeLogger;
+    TimeLoggerType m_fineTimeLogger;
+
     std::shared_ptr<spdlog::logger> m_streamLogger;
 };
 
@@ -42,27 +42,13 @@ void EyeModelEstimator::Impl::segmentEyelids(const cv::Mat& I, EyeModel& eye) co
 {
     DRISHTI_STREAM_LOG_FUNC(3, 1, m_streamLogger);
 
-    PointVec mu = m_eyeEstimator->getMeanShape();
-
-    cv::Rect roi({ 0, 0 }, I.size());
-    std::vector<cv::Rect> rois = { roi };
-    if (m_eyelidInits > 1)
-    {
-        jitter(roi, m_jitterEyelidParams, rois, m_eyelidInits - 1);
-    }
-
-    std::vector<PointVec> poses(rois.size(), mu);
+    std::vector<cv::Rect> rois = createEyelidInits(I.size());
+    std::vector<PointVec> poses(rois.size());
 
     // Get the basic shape:
-    std::vector<bool> mask; // occlusion mask
     for (int i = 0; i < rois.size(); i++)
     {
-        (*m_eyeEstimator)(I(rois[i]), poses[i], mask);
-        cv::Point2f shift = rois[i].tl();
-        for (auto& p : poses[i])
-        {
-            p += shift;
-        }
+        estimateEyelids(I, rois[i], poses[i]);
     }
 
     // Get median of poses:
@@ -74,6 +60,32 @@ void EyeModelEstimator::Impl::segmentEyelids(const cv::Mat& I, EyeModel& eye) co
 #endif
 }
 
+// The full crop followed by jittered crops (uses the calling thread's RNG):
+std::vector<cv::Rect> EyeModelEstimator::Impl::createEyelidInits(const cv::Size& size) const
+{
+    cv::Rect roi({ 0, 0 }, size);
+    std::vector<cv::Rect> rois = { roi };
+    if (m_eyelidInits > 1)
+    {
+        jitter(roi, m_jitterEyelidParams, rois, m_eyelidInits - 1);
+    }
+    return rois;
+}
+
+// Regress the eyelid shape from the mean shape in one crop (reentrant):
+void EyeModelEstimator::Impl::estimateEyelids(const cv::Mat& I, const cv::Rect& roi, PointVec& pose) const
+{
+    std::vector<bool> mask; // occlusion mask
+    pose = m_eyeEstimator->getMeanShape();
+    (*m_eyeEstimator)(I(roi), pose, mask);
+
+    const cv::Point2f shift = roi.tl();
+    for (auto& p : pose)
+    {
+        p += shift;
+    }
+}
+
 void EyeModelEstimator::Impl::segmentEyelids_(const cv::Mat& I, EyeModel& eye) const
 {
     DRISHTI_STREAM_LOG_FUNC(3, 2, m_streamLogger);
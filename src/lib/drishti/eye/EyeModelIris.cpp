@@ -38,18 +38,33 @@ void EyeModelEstimator::Impl::segmentIris(const cv::Mat& I, EyeModel& eye) const
 {
     DRISHTI_STREAM_LOG_FUNC(4, 1, m_streamLogger);
 
+    cv::Mat1b M;
+    EllipseVec irises;
+    createIrisInits(I, eye, M, irises);
+    if (irises.empty())
+    {
+        return;
+    }
+
+#if DRISHTI_CPR_DEBUG_PHI_ESTIMATE
+    drawIrisEstimates(I, irises, "iris-in");
+#endif
+
+    setIris(eye, estimateIrises(I, M, irises));
+}
+
+void EyeModelEstimator::Impl::createIrisInits(const cv::Mat& I, const EyeModel& eye, cv::Mat1b& M, EllipseVec& irises) const
+{
     // Find transformation mapping mean iris to our image:
     auto cpr = dynamic_cast<drishti::rcpr::CPR*>(m_irisEstimator.get());
     CV_Assert(cpr != 0);
 
-    cv::Mat1b M;
     if (cpr && cpr->usesMask())
     {
         M = eye.mask(I.size(), false);
     }
 
     // Initial iris estimates:
-    EllipseVec irises;
     createIrisEstimates(eye, cpr->getPStar(), irises);
 
     cv::RNG rng;
@@ -58,71 +73,72 @@ void EyeModelEstimator::Impl::segmentIris(const cv::Mat& I, EyeModel& eye) const
         jitter(rng, eye, m_jitterIrisParams, irises, m_irisInits - 1);
     }
 
-#if DRISHTI_CPR_DEBUG_PHI_ESTIMATE
-    drawIrisEstimates(I, irises, "iris-in");
-#endif
-
-    if (m_useHierarchy && irises.size() > 1)
-    {
-        eye.irisEllipse = estimateCentralIris(I, M, irises);
-    }
-    else
+    // Without the hierarchy only the first estimate is refined:
+    if (!m_useHierarchy && (irises.size() > 1))
     {
-        std::vector<bool> mask;
-        std::vector<cv::Point2f> points = geometry::ellipseToPoints(irises[0]);
-        (*m_irisEstimator)(I, M, points, mask);
-        eye.iris = 0;
-        eye.irisEllipse = geometry::pointsToEllipse(points);
+        irises.resize(1);
     }
-
-#if DRISHTI_CPR_TRANSPOSE
-    eye.irisEllipse = tranpose(eye.irisEllipse);
-#endif
 }
 
-cv::RotatedRect
-EyeModelEstimator::Impl::estimateCentralIris(const cv::Mat& I, const cv::Mat& M, const EllipseVec& irises) const
+// Refine one initial iris estimate (reentrant):
+cv::RotatedRect EyeModelEstimator::Impl::estimateIris(const cv::Mat& I, const cv::Mat& M, const cv::RotatedRect& iris) const
 {
-#if DRISHTI_CPR_DEBUG_PHI_ESTIMATE
-    EllipseVec estimates;
-#endif
+    std::vector<bool> mask;
+    std::vector<cv::Point2f> points = geometry::ellipseToPoints(iris);
+    (*m_irisEstimator)(I, M, points, mask);
+    return geometry::pointsToEllipse(points);
+}
 
-    std::vector<rcpr::Vector1d> params(5, rcpr::Vector1d(irises.size()));
+EllipseVec EyeModelEstimator::Impl::estimateIrises(const cv::Mat& I, const cv::Mat& M, const EllipseVec& irises) const
+{
+    EllipseVec estimates(irises.size());
 
     drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
-        // Find iris:
-        std::vector<bool> mask;
-        std::vector<cv::Point2f> points = geometry::ellipseToPoints(irises[i]);
-        (*m_irisEstimator)(I, M, points, mask);
-
-        rcpr::Vector1d phi = drishti::rcpr::ellipseToPhi(geometry::pointsToEllipse(points));
-        for (int j = 0; j < 5; j++)
-        {
-            params[j][i] = phi[j];
-        }
-
-#if DRISHTI_CPR_DEBUG_PHI_ESTIMATE
-        estimates.push_back(drishti::rcpr::phiToEllipse(phi));
-#endif
+        estimates[i] = estimateIris(I, M, irises[i]);
     };
 
-    m_irisEstimator->setDoPreview(true);
-
-    // XGBoost is not reentrant:
-    harness({ 0, int(irises.size()) });
-//cv::parallel_for_({0, int(irises.size())}, harness, 2);
-
 #if DRISHTI_CPR_DEBUG_PHI_ESTIMATE
+    harness({ 0, int(irises.size()) });
     drawIrisEstimates(I, estimates, "iris-out");
+#else
+    // Boosted trees are evaluated through the reentrant compiled ensemble:
+    cv::parallel_for_({ 0, int(irises.size()) }, harness);
 #endif
 
-    // Find Mean
-    rcpr::Vector1d model(5);
-    for (int i = 0; i < 5; i++)
+    return estimates;
+}
+
+// Combine refined estimates (median of each ellipse parameter):
+void EyeModelEstimator::Impl::setIris(EyeModel& eye, const EllipseVec& estimates) const
+{
+    if (estimates.size() > 1)
+    {
+        std::vector<rcpr::Vector1d> params(5, rcpr::Vector1d(estimates.size()));
+        for (int i = 0; i < estimates.size(); i++)
+        {
+            rcpr::Vector1d phi = drishti::rcpr::ellipseToPhi(estimates[i]);
+            for (int j = 0; j < 5; j++)
+            {
+                params[j][i] = phi[j];
+            }
+        }
+
+        rcpr::Vector1d model(5);
+        for (int i = 0; i < 5; i++)
+        {
+            model[i] = geometry::median(params[i]);
+        }
+        eye.irisEllipse = rcpr::phiToEllipse(model);
+    }
+    else
     {
-        model[i] = geometry::median(params[i]);
+        eye.iris = 0;
+        eye.irisEllipse = estimates[0];
     }
-    return rcpr::phiToEllipse(model);
+
+#if DRISHTI_CPR_TRANSPOSE
+    eye.irisEllipse = tranpose(eye.irisEllipse);
+#endif
 }
 
 // ### utility functions ###
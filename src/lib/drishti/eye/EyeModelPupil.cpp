@@ -47,45 +47,39 @@ void EyeModelEstimator::Impl::segmentPupil(const cv::Mat& I, EyeModel& eye, int
         crop = I(roi);
     }
 
+    // Bilinear is sufficient for the sparse pixel comparisons of the cascade:
     const float scale = float(targetWidth) / crop.cols;
-    cv::resize(crop, crop, {}, scale, scale, cv::INTER_CUBIC);
+    cv::resize(crop, crop, {}, scale, scale, cv::INTER_LINEAR);
 
     // =====================
     // Coarse iris estimate:
     cv::RotatedRect pupil((center - tl) * scale, { radius * scale / 3.f, radius * scale / 3.f }, 0.f);
-    std::vector<cv::RotatedRect> pupils;
     const float minScale = radius * 1.f / 4.f;
     const float maxScale = radius * 1.f / 2.f;
+
+    // TODO: currently override 2d point interface
+    std::vector<std::vector<cv::Point2f>> hypotheses;
     for (float s = minScale; s <= maxScale; s *= 1.05f)
     {
-        pupils.emplace_back(pupil.center, cv::Size2f(s, s) * scale, pupil.angle);
+        const cv::Size2f size = cv::Size2f(s, s) * scale;
+        hypotheses.push_back({ pupil.center, { size.width, size.height } });
     }
 
-    std::vector<rcpr::Vector1d> params(5, rcpr::Vector1d(pupils.size()));
-
-    drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
-        // Find pupil:
-        const auto& e = pupils[i];
-
-        // TODO: currently override 2d point interface
-        std::vector<bool> mask;
-        std::vector<cv::Point2f> points = { e.center, { e.size.width, e.size.height } };
-        (*m_pupilEstimator)(crop, points, mask);
+    // All hypotheses are evaluated as one batch (one cascade pass per stage):
+#if DEBUG_PUPIL
+    m_pupilEstimator->setDoPreview(true);
+#endif
+    (*m_pupilEstimator)(crop, hypotheses);
 
-        rcpr::Vector1d phi = drishti::rcpr::ellipseToPhi(geometry::pointsToEllipse(points));
+    std::vector<rcpr::Vector1d> params(5, rcpr::Vector1d(hypotheses.size()));
+    for (int i = 0; i < hypotheses.size(); i++)
+    {
+        rcpr::Vector1d phi = drishti::rcpr::ellipseToPhi(geometry::pointsToEllipse(hypotheses[i]));
         for (int j = 0; j < 5; j++)
         {
             params[j][i] = phi[j];
         }
-    };
-
-#if DEBUG_PUPIL
-    m_pupilEstimator->setDoPreview(true);
-    harness({ 0, int(pupils.size()) });
-#else
-    m_pupilEstimator->setDoPreview(false);
-    cv::parallel_for_({ 0, int(pupils.size()) }, harness);
-#endif
+    }
 
     // Find Mean
     rcpr::Vector1d model(5);
@@ -0,0 +1,168 @@
+/*!
+  @file   EyeModelTracking.cpp
+  @author David Hirvonen
+  @brief  Implementation of eye model tracking from the previous frame's fit.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  This file contains the implementation of temporal eye model estimation: the
+  previous eye model (warped by the frame to frame eye motion) replaces the
+  mean shape and the eyelid based iris estimates as the regressor initialization,
+  and shortened cascades refine it.  Blinks and occlusions fall back to a full fit.
+
+  Note: only the iris cascade is shortened.  None of the shipped eyelid models has a
+  warm start tail, so trackEyelids() runs the full eyelid cascade from the prior and
+  adds a residual check, which costs slightly more than a plain eyelid fit.  The gain
+  is the tracked iris (and the stability of the prior), not the eyelid time.
+
+*/
+
+#include "drishti/eye/EyeModelEstimatorImpl.h"
+
+#include "drishti/core/drishti_stdlib_string.h" // FIRST
+
+#include <limits>
+
+DRISHTI_EYE_NAMESPACE_BEGIN
+
+static float getMaxDisplacement(const std::vector<cv::Point2f>& a, const std::vector<cv::Point2f>& b);
+
+int EyeModelEstimator::Impl::operator()(const cv::Mat& crop, const EyeModel& previous, const cv::Matx33f& H, EyeModel& eye, bool* isTracked) const
+{
+    DRISHTI_STREAM_LOG_FUNC(2, 47, m_streamLogger);
+
+    if (isTracked)
+    {
+        *isTracked = false;
+    }
+
+    if (previous.eyelids.empty())
+    {
+        return (*this)(crop, eye);
+    }
+
+    // The prior is mapped to each level, as in the full fit the eyelids are tracked
+    // at the coarse level and the iris at the fine level (see createFineLevel()):
+    const EyeModel warped = H * previous;
+
+    EyeChannels coarse, fine;
+    createEyeChannels(crop, getEyeScale(crop, getEyelidTargetWidth()), coarse);
+
+    // ######## Track the eyelids #########
+    if (!trackEyelids(coarse.blue, toLevel(warped, coarse), eye))
+    {
+        return (*this)(crop, eye); // lost track: full fit
+    }
+
+    const EyeChannels& level = createFineLevel(crop, coarse, eye, fine);
+
+    if (m_doIndependentIrisAndPupil)
+    {
+        if (eye.openness() > m_opennessThrehsold)
+        {
+            if (m_irisEstimator)
+            {
+                // ((((( Track the iris )))))
+                if (!trackIris(level.red, toLevel(warped, level), eye))
+                {
+                    segmentIris(level.red, eye);
+                }
+                updateIrisLandmarks(eye);
+
+                if (m_pupilEstimator && m_doPupil && eye.irisEllipse.size.area() > 0.f)
+                {
+                    segmentPupil(level.red, eye);
+                }
+            }
+        }
+        else
+        {
+            // for squinting eyes defer to limbus point estimate:
+            eye.irisEllipse = estimateIrisFromLimbusPoints(eye);
+            eye.pupilEllipse.center = eye.irisEllipse.center;
+        }
+    }
+
+    // Scale up the model
+    eye = toCrop(eye, level);
+
+    if (isTracked)
+    {
+        *isTracked = true;
+    }
+
+    return 0;
+}
+
+// Eyelids are regressed from the prior shape (warm start), the track is lost for
+// blinks (closed aperture) and for large eyelid motion (occlusion or drift).  This
+// is the full eyelid cascade, since the eyelid models have no warm start tail:
+bool EyeModelEstimator::Impl::trackEyelids(const cv::Mat& I, const EyeModel& prior, EyeModel& eye) const
+{
+    DRISHTI_STREAM_LOG_FUNC(3, 3, m_streamLogger);
+
+    PointVec pose;
+    std::vector<bool> mask;
+    (*m_eyeEstimator)(I, eyeToShape(prior, m_eyeSpec), pose, mask);
+    eye = shapeToEye(pose, m_eyeSpec);
+
+    if (eye.openness() <= m_opennessThrehsold)
+    {
+        return false;
+    }
+
+    const float width = cv::norm(prior.getInnerCorner() - prior.getOuterCorner());
+    return getMaxDisplacement(eye.eyelids, prior.eyelids) <= (m_trackingMaxResidual * width);
+}
+
+// The prior iris is refined by the trailing stages of the iris cascade, the track
+// is lost if the ellipse moves or changes size by more than the max residual:
+bool EyeModelEstimator::Impl::trackIris(const cv::Mat& I, const EyeModel& prior, EyeModel& eye) const
+{
+    DRISHTI_STREAM_LOG_FUNC(4, 2, m_streamLogger);
+
+    auto cpr = dynamic_cast<drishti::rcpr::CPR*>(m_irisEstimator.get());
+    if (!cpr || (prior.irisEllipse.size.area() <= 0.f))
+    {
+        return false;
+    }
+
+    cv::Mat1b M;
+    if (cpr->usesMask())
+    {
+        M = eye.mask(I.size(), false);
+    }
+
+    std::vector<cv::Point2f> points = geometry::ellipseToPoints(prior.irisEllipse);
+    cpr->refine(I, M, points, m_trackingIrisStages);
+    const cv::RotatedRect iris = geometry::pointsToEllipse(points);
+
+    const float width = cv::norm(eye.getInnerCorner() - eye.getOuterCorner());
+    const float shift = cv::norm(iris.center - prior.irisEllipse.center);
+    const float growth = std::abs(std::max(iris.size.width, iris.size.height) - std::max(prior.irisEllipse.size.width, prior.irisEllipse.size.height));
+    if (std::max(shift, growth) > (m_trackingMaxResidual * width))
+    {
+        return false;
+    }
+
+    setIris(eye, { iris });
+    return true;
+}
+
+static float getMaxDisplacement(const std::vector<cv::Point2f>& a, const std::vector<cv::Point2f>& b)
+{
+    if (a.size() != b.size())
+    {
+        return std::numeric_limits<float>::max();
+    }
+
+    float displacement = 0.f;
+    for (int i = 0; i < a.size(); i++)
+    {
+        displacement = std::max(displacement, float(cv::norm(a[i] - b[i])));
+    }
+    return displacement;
+}
+
+DRISHTI_EYE_NAMESPACE_END
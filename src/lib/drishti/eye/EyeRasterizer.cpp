@@ -0,0 +1,243 @@
+/*!
+  @file   EyeRasterizer.cpp
+  @author David Hirvonen
+  @brief  Implementation of a scanline rasterizer for eye model region masks.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+  Pixel (x,y) is inside a region if its center (integer coordinates, as in
+  OpenCV) is inside the polygon or conic.  Polygon spans are half open at
+  the right edge (top-left rule), so adjacent polygons don't overlap.
+
+*/
+
+#include "drishti/eye/EyeRasterizer.h"
+#include "drishti/geometry/ConicSection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+DRISHTI_EYE_NAMESPACE_BEGIN
+
+using Span = std::pair<int, int>; // [first, second)
+
+static inline Span intersect(const Span& a, const Span& b)
+{
+    return { std::max(a.first, b.first), std::min(a.second, b.second) };
+}
+
+static inline void fill(uint8_t* row, const Span& span, uint8_t value)
+{
+    if (span.first < span.second)
+    {
+        std::memset(row + span.first, value, span.second - span.first);
+    }
+}
+
+// Even-odd polygon scan conversion with an active edge list, edge crossings
+// are stepped from row to row in 16.16 fixed point.
+class PolygonScanner
+{
+public:
+    static const int kShift = 16;
+
+    PolygonScanner(const std::vector<cv::Point2f>& polygon)
+    {
+        for (int i = 0; i < polygon.size(); i++)
+        {
+            cv::Point2f p0 = polygon[i], p1 = polygon[(i + 1) % polygon.size()];
+            if (p0.y > p1.y)
+            {
+                std::swap(p0, p1);
+            }
+
+            // Rows with a pixel center in [p0.y, p1.y):
+            const int y0 = static_cast<int>(std::ceil(p0.y));
+            const int y1 = static_cast<int>(std::ceil(p1.y));
+            if (y0 < y1)
+            {
+                const float slope = (p1.x - p0.x) / (p1.y - p0.y);
+                m_edges.push_back({ y0, y1, toFixed(p0.x + (float(y0) - p0.y) * slope), toFixed(slope) });
+            }
+        }
+        std::sort(m_edges.begin(), m_edges.end(), [](const Edge& a, const Edge& b) { return a.y0 < b.y0; });
+    }
+
+    // Spans of row y, rows must be visited in ascending order:
+    void operator()(int y, int width, std::vector<Span>& spans)
+    {
+        m_active.erase(std::remove_if(m_active.begin(), m_active.end(), [&](const Edge& e) { return e.y1 <= y; }), m_active.end());
+        for (; (m_next < m_edges.size()) && (m_edges[m_next].y0 <= y); m_next++)
+        {
+            Edge edge = m_edges[m_next];
+            if (edge.y1 > y)
+            {
+                edge.x += int64_t(y - edge.y0) * edge.dx; // skipped rows (i.e., above the image)
+                m_active.push_back(edge);
+            }
+        }
+
+        m_crossings.clear();
+        for (auto& edge : m_active)
+        {
+            m_crossings.push_back(edge.x);
+            edge.x += edge.dx;
+        }
+        std::sort(m_crossings.begin(), m_crossings.end());
+
+        for (int i = 0; (i + 1) < m_crossings.size(); i += 2)
+        {
+            const int x0 = std::max(ceilFixed(m_crossings[i]), 0);
+            const int x1 = std::min(ceilFixed(m_crossings[i + 1]), width);
+            if (x0 < x1)
+            {
+                spans.emplace_back(x0, x1);
+            }
+        }
+    }
+
+protected:
+    struct Edge
+    {
+        int y0, y1; // rows [y0, y1)
+        int64_t x;  // crossing at the current row (fixed point)
+        int64_t dx; // crossing increment per row (fixed point)
+    };
+
+    static int64_t toFixed(float x)
+    {
+        return static_cast<int64_t>(std::llround(double(x) * double(1 << kShift)));
+    }
+
+    static int ceilFixed(int64_t x)
+    {
+        return static_cast<int>((x + ((int64_t(1) << kShift) - 1)) >> kShift);
+    }
+
+    std::vector<Edge> m_edges;
+    std::vector<Edge> m_active;
+    std::vector<int64_t> m_crossings;
+    int m_next = 0;
+};
+
+// Ellipse interior spans from the implicit conic: for row y the boundary
+// crossings are the roots of A*x^2 + (B*y + D)*x + (C*y^2 + E*y + F) = 0.
+class ConicScanner
+{
+public:
+    ConicScanner(const cv::RotatedRect& ellipse)
+        : m_conic(ellipse)
+        , m_valid((ellipse.size.width > 0.f) && (ellipse.size.height > 0.f))
+    {
+    }
+
+    Span operator()(int y, int width) const
+    {
+        if (m_valid)
+        {
+            const double b = (m_conic.B * y) + m_conic.D;
+            const double c = (((m_conic.C * y) + m_conic.E) * y) + m_conic.F;
+            const double discriminant = (b * b) - (4.0 * m_conic.A * c);
+            if (discriminant >= 0.0)
+            {
+                const double root = std::sqrt(discriminant);
+                const double x0 = (-b - root) / (2.0 * m_conic.A);
+                const double x1 = (-b + root) / (2.0 * m_conic.A);
+                const int first = std::max(static_cast<int>(std::ceil(x0)), 0);
+                const int last = std::min(static_cast<int>(std::floor(x1)) + 1, width);
+                if (first < last)
+                {
+                    return { first, last };
+                }
+            }
+        }
+        return { 0, 0 };
+    }
+
+protected:
+    drishti::geometry::ConicSection_<double> m_conic;
+    bool m_valid = false;
+};
+
+void rasterize(const EyeModel& eye, const cv::Size& size, EyeMasks& masks, int which, float irisScale, bool clipToEyelids)
+{
+    cv::Mat1b* outputs[] = { &masks.eye, &masks.sclera, &masks.iris, &masks.pupil, &masks.labels };
+    for (int i = 0; i < 5; i++)
+    {
+        if (which & (1 << i))
+        {
+            *outputs[i] = cv::Mat1b::zeros(size);
+        }
+    }
+
+    const auto& curve = eye.eyelidsSpline.size() ? eye.eyelidsSpline : eye.eyelids;
+    const bool hasEyelids = (curve.size() > 2);
+    const bool doClip = clipToEyelids && hasEyelids;
+
+    cv::RotatedRect scaled = eye.irisEllipse;
+    scaled.size = scaled.size * irisScale;
+
+    PolygonScanner eyelids(hasEyelids ? curve : std::vector<cv::Point2f>());
+    const ConicScanner iris(eye.irisEllipse), sclera(scaled), pupil(eye.pupilEllipse);
+
+    std::vector<Span> spans;
+    for (int y = 0; y < size.height; y++)
+    {
+        spans.clear();
+        eyelids(y, size.width, spans);
+
+        const Span irisSpan = iris(y, size.width);
+        if (which & EyeMasks::kEye)
+        {
+            for (const auto& span : spans)
+            {
+                fill(masks.eye[y], span, 255);
+            }
+        }
+        if (which & EyeMasks::kSclera)
+        {
+            const Span scleraSpan = sclera(y, size.width);
+            for (const auto& span : spans)
+            {
+                fill(masks.sclera[y], span, 255);
+                fill(masks.sclera[y], intersect(span, scleraSpan), 0);
+            }
+        }
+        if (which & EyeMasks::kLabels)
+        {
+            for (const auto& span : spans)
+            {
+                fill(masks.labels[y], span, 255);
+                fill(masks.labels[y], intersect(span, irisSpan), 127);
+            }
+        }
+
+        // Iris and pupil within the eyelid aperture:
+        const Span pupilSpan = (which & EyeMasks::kPupil) ? pupil(y, size.width) : Span(0, 0);
+        std::pair<Span, uint8_t*> regions[] = {
+            { irisSpan, (which & EyeMasks::kIris) ? masks.iris[y] : nullptr },
+            { pupilSpan, (which & EyeMasks::kPupil) ? masks.pupil[y] : nullptr }
+        };
+        for (const auto& region : regions)
+        {
+            if (region.second)
+            {
+                if (doClip)
+                {
+                    for (const auto& span : spans)
+                    {
+                        fill(region.second, intersect(span, region.first), 255);
+                    }
+                }
+                else
+                {
+                    fill(region.second, region.first, 255);
+                }
+            }
+        }
+    }
+}
+
+DRISHTI_EYE_NAMESPACE_END
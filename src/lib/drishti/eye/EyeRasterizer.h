@@ -0,0 +1,50 @@
+/*!
+  @file   EyeRasterizer.h
+  @author David Hirvonen
+  @brief  Declaration of a scanline rasterizer for eye model region masks.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_eye_EyeRasterizer_h__
+#define __drishti_eye_EyeRasterizer_h__
+
+#include "drishti/eye/drishti_eye.h"
+#include "drishti/eye/Eye.h"
+
+#include <opencv2/core.hpp>
+
+DRISHTI_EYE_NAMESPACE_BEGIN
+
+// Region masks of an eye model (0 or 255, labels: 0, 127 or 255):
+struct EyeMasks
+{
+    enum
+    {
+        kEye = 1,     // eyelid aperture, i.e., EyeModel::mask(size, false)
+        kSclera = 2,  // aperture minus the (scaled) iris, i.e., EyeModel::mask(size, true, irisScale)
+        kIris = 4,    // iris (pupil included) within the aperture, i.e., EyeModel::irisMask(size)
+        kPupil = 8,   // pupil within the aperture
+        kLabels = 16, // aperture (255) with the iris (127), i.e., EyeModel::labels(size)
+        kAll = 31
+    };
+
+    cv::Mat1b eye;
+    cv::Mat1b sclera;
+    cv::Mat1b iris;
+    cv::Mat1b pupil;
+    cv::Mat1b labels;
+};
+
+// All requested masks are written in a single pass over the rows.  Each row
+// intersects the eyelid polygon (fixed point edge stepping) and the iris and
+// pupil conics (closed form roots) with the scanline, and the resulting spans
+// are filled with memset.  The iris and pupil masks are clipped to the eyelid
+// aperture if clipToEyelids is set and the model has eyelids.
+void rasterize(const EyeModel& eye, const cv::Size& size, EyeMasks& masks, int which = EyeMasks::kAll, float irisScale = 1.f, bool clipToEyelids = true);
+
+DRISHTI_EYE_NAMESPACE_END
+
+#endif /* defined(__drishti_eye_EyeRasterizer_h__) */
@@ -0,0 +1,165 @@
+/*!
+  @file   IrisCode.cpp
+  @author David Hirvonen
+  @brief  Implementation of binary iris templates and a log-Gabor iris encoder.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/eye/IrisCode.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <cmath>
+
+DRISHTI_EYE_NAMESPACE_BEGIN
+
+static inline bool getBit(const std::vector<uint64_t>& bits, int i)
+{
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void setBit(std::vector<uint64_t>& bits, int i)
+{
+    bits[i >> 6] |= (uint64_t(1) << (i & 63));
+}
+
+// Circular shift of an n bit string: dst[(i + shift) % n] = src[i]
+static void rotateBits(const std::vector<uint64_t>& src, std::vector<uint64_t>& dst, int n, int shift)
+{
+    dst.assign(src.size(), 0);
+    for (int i = 0, j = shift; i < n; i++, j++)
+    {
+        if (j == n)
+        {
+            j = 0;
+        }
+        if (getBit(src, i))
+        {
+            setBit(dst, j);
+        }
+    }
+}
+
+IrisCode IrisCode::rotate(int x) const
+{
+    IrisCode result;
+    result.columns = columns;
+    result.bitsPerColumn = bitsPerColumn;
+    if (columns > 0)
+    {
+        const int shift = (((x % columns) + columns) % columns) * bitsPerColumn;
+        rotateBits(code, result.code, bits(), shift);
+        rotateBits(mask, result.mask, bits(), shift);
+    }
+    return result;
+}
+
+// ########## IrisEncoder ##########
+
+IrisEncoder::IrisEncoder()
+    : IrisEncoder(Recipe())
+{
+}
+
+IrisEncoder::IrisEncoder(const Recipe& recipe)
+    : m_recipe(recipe)
+{
+    // Log-Gabor filters have no DC component, and zeroing the negative
+    // frequencies makes the filtered row an analytic (complex) signal:
+    const int n = m_recipe.size.width;
+    const double logSigma = std::log(m_recipe.sigmaOnf);
+    float wavelength = m_recipe.wavelength;
+    for (int s = 0; s < m_recipe.scales; s++, wavelength *= m_recipe.multiplier)
+    {
+        cv::Mat1f filter(1, n, 0.f);
+        const double f0 = 1.0 / wavelength;
+        for (int k = 1; k <= (n / 2); k++)
+        {
+            const double r = std::log((double(k) / n) / f0);
+            filter(k) = static_cast<float>(std::exp(-(r * r) / (2.0 * logSigma * logSigma)));
+        }
+        m_filters.push_back(filter);
+    }
+}
+
+void IrisEncoder::operator()(const NormalizedIris& iris, IrisCode& code) const
+{
+    (*this)(iris.getImage(), iris.getMask(), code);
+}
+
+void IrisEncoder::operator()(const cv::Mat& image, const cv::Mat& mask, IrisCode& code) const
+{
+    const cv::Size& size = m_recipe.size;
+
+    cv::Mat gray = image;
+    if (gray.channels() > 1)
+    {
+        cv::cvtColor(image, gray, (image.channels() == 4) ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    }
+
+    cv::Mat resized;
+    cv::Mat1f rows;
+    cv::resize(gray, resized, size, 0, 0, cv::INTER_AREA);
+    resized.convertTo(rows, CV_32F, (gray.depth() == CV_8U) ? (1.0 / 255.0) : 1.0);
+
+    cv::Mat1b valid(size, 255);
+    if (!mask.empty())
+    {
+        cv::resize(mask, valid, size, 0, 0, cv::INTER_NEAREST);
+    }
+
+    const int scales = static_cast<int>(m_filters.size());
+    code.columns = size.width;
+    code.bitsPerColumn = size.height * scales * 2;
+    code.code.assign(code.words(), 0);
+    code.mask.assign(code.words(), 0);
+
+    // All rows are transformed in one call:
+    cv::Mat spectrum, filtered, response;
+    cv::dft(rows, spectrum, cv::DFT_ROWS | cv::DFT_COMPLEX_OUTPUT);
+
+    const float minMagnitude2 = m_recipe.minMagnitude * m_recipe.minMagnitude;
+    for (int s = 0; s < scales; s++)
+    {
+        filtered.create(spectrum.size(), spectrum.type());
+        for (int y = 0; y < spectrum.rows; y++)
+        {
+            const cv::Vec2f* pSrc = spectrum.ptr<cv::Vec2f>(y);
+            cv::Vec2f* pDst = filtered.ptr<cv::Vec2f>(y);
+            for (int x = 0; x < spectrum.cols; x++)
+            {
+                pDst[x] = pSrc[x] * m_filters[s](x);
+            }
+        }
+        cv::idft(filtered, response, cv::DFT_ROWS | cv::DFT_SCALE | cv::DFT_COMPLEX_OUTPUT);
+
+        for (int y = 0; y < response.rows; y++)
+        {
+            const cv::Vec2f* pResponse = response.ptr<cv::Vec2f>(y);
+            const uint8_t* pValid = valid.ptr<uint8_t>(y);
+            for (int x = 0; x < response.cols; x++)
+            {
+                const cv::Vec2f& z = pResponse[x];
+                const int i = (x * code.bitsPerColumn) + (((y * scales) + s) * 2);
+                if (z[0] >= 0.f)
+                {
+                    setBit(code.code, i);
+                }
+                if (z[1] >= 0.f)
+                {
+                    setBit(code.code, i + 1);
+                }
+                if (pValid[x] && (((z[0] * z[0]) + (z[1] * z[1])) >= minMagnitude2))
+                {
+                    setBit(code.mask, i);
+                    setBit(code.mask, i + 1);
+                }
+            }
+        }
+    }
+}
+
+DRISHTI_EYE_NAMESPACE_END
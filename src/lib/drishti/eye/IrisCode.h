@@ -0,0 +1,99 @@
+/*!
+  @file   IrisCode.h
+  @author David Hirvonen
+  @brief  Declaration of binary iris templates and a log-Gabor iris encoder.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_eye_IrisCode_h__
+#define __drishti_eye_IrisCode_h__
+
+#include "drishti/eye/drishti_eye.h"
+#include "drishti/eye/NormalizedIris.h"
+
+#include <opencv2/core.hpp>
+
+#include <cstdint>
+#include <vector>
+
+DRISHTI_EYE_NAMESPACE_BEGIN
+
+// Binary iris template: quantized filter phase bits and a validity mask.
+// Bits are stored column major (one angular sample after another), so a
+// circular shift of the normalized iris by one column is a circular shift
+// of the template by bitsPerColumn bits.
+struct IrisCode
+{
+    int columns = 0;       // angular samples
+    int bitsPerColumn = 0; // radial samples x filters x 2 phase bits
+    std::vector<uint64_t> code;
+    std::vector<uint64_t> mask; // 1 for valid bits
+
+    bool empty() const
+    {
+        return code.empty();
+    }
+
+    int bits() const
+    {
+        return columns * bitsPerColumn;
+    }
+
+    // Storage size (bits are zero padded to whole words):
+    int words() const
+    {
+        return (bits() + 63) / 64;
+    }
+
+    // Circular shift by x columns (same convention as NormalizedIris::rotate):
+    IrisCode rotate(int x) const;
+
+    template <class Archive>
+    void serialize(Archive& ar, const unsigned int version)
+    {
+        ar& columns;
+        ar& bitsPerColumn;
+        ar& code;
+        ar& mask;
+    }
+};
+
+// Masek style encoder: each radial row of the normalized iris is filtered
+// with 1D log-Gabor filters along the angular direction (one FFT per row),
+// and the quadrant of the complex response is quantized to 2 bits.  Bits
+// are masked where the normalized iris is occluded or the response is weak.
+class IrisEncoder
+{
+public:
+    struct Recipe
+    {
+        cv::Size size = { 256, 8 };  // angular x radial samples
+        float wavelength = 18.f;     // center wavelength of the first filter (in angular samples)
+        int scales = 1;              // number of filters
+        float multiplier = 2.f;      // wavelength ratio between filters
+        float sigmaOnf = 0.5f;       // bandwidth (sigma / center frequency)
+        float minMagnitude = 1e-4f;  // responses below this (intensity in [0,1]) are masked
+    };
+
+    IrisEncoder();
+    IrisEncoder(const Recipe& recipe);
+
+    void operator()(const NormalizedIris& iris, IrisCode& code) const;
+    void operator()(const cv::Mat& image, const cv::Mat& mask, IrisCode& code) const;
+
+    const Recipe& getRecipe() const
+    {
+        return m_recipe;
+    }
+
+protected:
+    Recipe m_recipe;
+    std::vector<cv::Mat1f> m_filters; // frequency response of each scale (1 x columns)
+};
+
+DRISHTI_EYE_NAMESPACE_END
+
+#endif /* defined(__drishti_eye_IrisCode_h__) */
@@ -0,0 +1,214 @@
+/*!
+  @file   IrisMatcher.cpp
+  @author David Hirvonen
+  @brief  Implementation of masked Hamming distance iris template matching (1:1 and 1:N).
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/eye/IrisMatcher.h"
+#include "drishti/core/Parallel.h"
+
+// clang-format off
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define DO_AVX2 1
+#endif
+// clang-format on
+
+// clang-format off
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define DO_ARM_NEON 1
+#endif
+// clang-format on
+
+#include <algorithm>
+
+DRISHTI_EYE_NAMESPACE_BEGIN
+
+static inline int popcount64(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return static_cast<int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+#if DO_AVX2
+// Per byte popcount by nibble table lookup (pshufb):
+static inline __m256i popcount8(__m256i v)
+{
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    const __m256i lo = _mm256_and_si256(v, low);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+}
+
+static inline int sum64(__m256i v)
+{
+    const __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return static_cast<int>(_mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1));
+}
+#endif
+
+// Counts of the differing valid bits and of the jointly valid bits over n words:
+static inline void countBits(const uint64_t* a, const uint64_t* ma, const uint64_t* b, const uint64_t* mb, int n, int& diff, int& valid)
+{
+    int i = 0;
+    diff = valid = 0;
+#if DO_AVX2
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i accDiff = zero, accValid = zero;
+    for (; i <= n - 4; i += 4)
+    {
+        const __m256i m = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ma + i)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mb + i)));
+        const __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        accDiff = _mm256_add_epi64(accDiff, _mm256_sad_epu8(popcount8(_mm256_and_si256(x, m)), zero));
+        accValid = _mm256_add_epi64(accValid, _mm256_sad_epu8(popcount8(m), zero));
+    }
+    diff = sum64(accDiff);
+    valid = sum64(accValid);
+#elif DO_ARM_NEON
+    uint64x2_t accDiff = vdupq_n_u64(0), accValid = vdupq_n_u64(0);
+    for (; i <= n - 2; i += 2)
+    {
+        const uint8x16_t m = vandq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(ma + i)), vld1q_u8(reinterpret_cast<const uint8_t*>(mb + i)));
+        const uint8x16_t x = veorq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(a + i)), vld1q_u8(reinterpret_cast<const uint8_t*>(b + i)));
+        accDiff = vpadalq_u32(accDiff, vpaddlq_u16(vpaddlq_u8(vcntq_u8(vandq_u8(x, m)))));
+        accValid = vpadalq_u32(accValid, vpaddlq_u16(vpaddlq_u8(vcntq_u8(m))));
+    }
+    diff = static_cast<int>(vgetq_lane_u64(accDiff, 0) + vgetq_lane_u64(accDiff, 1));
+    valid = static_cast<int>(vgetq_lane_u64(accValid, 0) + vgetq_lane_u64(accValid, 1));
+#endif
+    for (; i < n; i++)
+    {
+        const uint64_t m = ma[i] & mb[i];
+        diff += popcount64((a[i] ^ b[i]) & m);
+        valid += popcount64(m);
+    }
+}
+
+// ########## IrisGallery ##########
+
+void IrisGallery::add(const IrisCode& code)
+{
+    if (m_size == 0)
+    {
+        m_columns = code.columns;
+        m_bitsPerColumn = code.bitsPerColumn;
+        m_words = code.words();
+    }
+    CV_Assert((code.columns == m_columns) && (code.bitsPerColumn == m_bitsPerColumn));
+
+    m_data.insert(m_data.end(), code.code.begin(), code.code.end());
+    m_data.insert(m_data.end(), code.mask.begin(), code.mask.end());
+    m_size++;
+}
+
+// ########## IrisMatcher ##########
+
+IrisMatcher::IrisMatcher(int maxRotation, int minBits)
+    : m_maxRotation(maxRotation)
+    , m_minBits(minBits)
+{
+}
+
+std::vector<IrisCode> IrisMatcher::getRotations(const IrisCode& probe) const
+{
+    std::vector<IrisCode> rotations;
+    for (int r = -m_maxRotation; r <= m_maxRotation; r++)
+    {
+        rotations.push_back(probe.rotate(r));
+    }
+    return rotations;
+}
+
+IrisMatch IrisMatcher::match(const std::vector<IrisCode>& rotations, const uint64_t* code, const uint64_t* mask) const
+{
+    IrisMatch best;
+    for (int r = 0; r < rotations.size(); r++)
+    {
+        const auto& probe = rotations[r];
+
+        int diff = 0, valid = 0;
+        countBits(probe.code.data(), probe.mask.data(), code, mask, probe.words(), diff, valid);
+        if (valid >= std::max(m_minBits, 1))
+        {
+            const float distance = float(diff) / float(valid);
+            if (distance < best.distance)
+            {
+                best = { distance, r - m_maxRotation, valid };
+            }
+        }
+    }
+    return best;
+}
+
+IrisMatch IrisMatcher::operator()(const IrisCode& probe, const IrisCode& reference) const
+{
+    CV_Assert((probe.columns == reference.columns) && (probe.bitsPerColumn == reference.bitsPerColumn));
+    return match(getRotations(probe), reference.code.data(), reference.mask.data());
+}
+
+std::vector<IrisSearchResult> IrisMatcher::search(const IrisCode& probe, const IrisGallery& gallery, int k, int shards) const
+{
+    if ((gallery.size() == 0) || (k <= 0))
+    {
+        return {};
+    }
+    CV_Assert(probe.words() == gallery.getWords());
+
+    const std::vector<IrisCode> rotations = getRotations(probe);
+
+    auto isBetter = [](const IrisSearchResult& a, const IrisSearchResult& b) {
+        return (a.match.distance < b.match.distance) || ((a.match.distance == b.match.distance) && (a.index < b.index));
+    };
+
+    // Each shard keeps its own k best results, which are merged at the end:
+    if (shards <= 0)
+    {
+        shards = std::max(cv::getNumThreads(), 1) * 4;
+    }
+    shards = std::min(shards, gallery.size());
+
+    std::vector<std::vector<IrisSearchResult>> results(shards);
+    core::ParallelHomogeneousLambda harness = [&](int s) {
+        const int begin = int((int64_t(s) * gallery.size()) / shards);
+        const int end = int((int64_t(s + 1) * gallery.size()) / shards);
+
+        auto& best = results[s];
+        best.reserve(k + 1);
+        for (int i = begin; i < end; i++)
+        {
+            const IrisSearchResult result{ i, match(rotations, gallery.getCode(i), gallery.getMask(i)) };
+            if ((best.size() < k) || isBetter(result, best.back()))
+            {
+                best.insert(std::upper_bound(best.begin(), best.end(), result, isBetter), result);
+                if (best.size() > k)
+                {
+                    best.pop_back();
+                }
+            }
+        }
+    };
+    cv::parallel_for_({ 0, shards }, harness);
+
+    std::vector<IrisSearchResult> merged;
+    for (const auto& shard : results)
+    {
+        merged.insert(merged.end(), shard.begin(), shard.end());
+    }
+    std::sort(merged.begin(), merged.end(), isBetter);
+    merged.resize(std::min(int(merged.size()), k));
+    return merged;
+}
+
+DRISHTI_EYE_NAMESPACE_END
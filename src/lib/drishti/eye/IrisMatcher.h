@@ -0,0 +1,104 @@
+/*!
+  @file   IrisMatcher.h
+  @author David Hirvonen
+  @brief  Declaration of masked Hamming distance iris template matching (1:1 and 1:N).
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_eye_IrisMatcher_h__
+#define __drishti_eye_IrisMatcher_h__
+
+#include "drishti/eye/drishti_eye.h"
+#include "drishti/eye/IrisCode.h"
+
+#include <cstdint>
+#include <vector>
+
+DRISHTI_EYE_NAMESPACE_BEGIN
+
+// Templates of one layout packed in a single array (code and mask words of
+// each template are adjacent), so a 1:N search streams through memory.
+class IrisGallery
+{
+public:
+    IrisGallery() {}
+
+    // The first template defines the layout for all others:
+    void add(const IrisCode& code);
+
+    void clear()
+    {
+        m_data.clear();
+        m_size = 0;
+    }
+
+    int size() const
+    {
+        return m_size;
+    }
+
+    int getWords() const
+    {
+        return m_words;
+    }
+
+    const uint64_t* getCode(int i) const
+    {
+        return &m_data[std::size_t(i) * (2 * m_words)];
+    }
+
+    const uint64_t* getMask(int i) const
+    {
+        return getCode(i) + m_words;
+    }
+
+protected:
+    int m_columns = 0;
+    int m_bitsPerColumn = 0;
+    int m_words = 0;
+    int m_size = 0;
+    std::vector<uint64_t> m_data;
+};
+
+struct IrisMatch
+{
+    float distance = 1.f; // fractional Hamming distance over the jointly valid bits
+    int rotation = 0;     // reference ~ probe.rotate(rotation)
+    int bits = 0;         // number of jointly valid bits
+};
+
+struct IrisSearchResult
+{
+    int index = -1; // gallery index
+    IrisMatch match;
+};
+
+// Masked fractional Hamming distance, minimized over a window of circular
+// shifts.  The probe is rotated in the bit domain once per search (no
+// re-encoding), and every comparison is an xor/and/popcount kernel
+// (AVX2 or NEON where available).
+class IrisMatcher
+{
+public:
+    IrisMatcher(int maxRotation = 8, int minBits = 256);
+
+    IrisMatch operator()(const IrisCode& probe, const IrisCode& reference) const;
+
+    // 1:N search: the best k matches (ascending distance), the gallery is
+    // split into shards that are searched in parallel (0: default count).
+    std::vector<IrisSearchResult> search(const IrisCode& probe, const IrisGallery& gallery, int k = 1, int shards = 0) const;
+
+protected:
+    std::vector<IrisCode> getRotations(const IrisCode& probe) const;
+    IrisMatch match(const std::vector<IrisCode>& rotations, const uint64_t* code, const uint64_t* mask) const;
+
+    int m_maxRotation = 8;
+    int m_minBits = 256; // matches with fewer valid bits are rejected (distance 1)
+};
+
+DRISHTI_EYE_NAMESPACE_END
+
+#endif /* defined(__drishti_eye_IrisMatcher_h__) */
@@ -9,83 +9,221 @@
 */
 
 #include "drishti/eye/IrisNormalizer.h"
-#include "drishti/geometry/Ellipse.h"
-#include "drishti/geometry/intersectConicLine.h"
 
 #include <opencv2/imgproc.hpp>
 
-#include <iostream>
+// clang-format off
+#if defined(__arm__) || defined(__arm64__) || defined(__aarch64__)
+#  include <arm_neon.h>
+#  define DO_ARM_NEON 1
+#endif
+// clang-format on
+
+// clang-format off
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define DO_SSE 1
+#endif
+// clang-format on
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 
 DRISHTI_EYE_NAMESPACE_BEGIN
 
-IrisNormalizer::IrisNormalizer()
+// Angular samples for one output size:
+struct IrisNormalizer::Table
+{
+    cv::Size size;
+    int padding = 0;
+    std::vector<float> cosTheta, sinTheta; // one per padded column
+};
+
+struct IrisNormalizer::Cache
+{
+    std::mutex mutex;
+    std::shared_ptr<const Table> table;
+
+    // Last unwrapping maps:
+    bool valid = false;
+    cv::Size size;
+    int padding = 0;
+    bool fastMode = false;
+    cv::RotatedRect iris, pupil;
+    cv::Mat map1, map2;
+};
+
+// Ray intersection with an ellipse boundary, solved in the ellipse frame:
+// |R'(o + t * v - c)|^2 (in units of the semi axes) = 1
+struct EllipseRay
+{
+    EllipseRay(const cv::RotatedRect& ellipse, const cv::Point2f& origin)
+        : origin(origin)
+    {
+        const float phi = ellipse.angle * float(M_PI / 180.0);
+        c = std::cos(phi);
+        s = std::sin(phi);
+        ia = 4.f / (ellipse.size.width * ellipse.size.width);
+        ib = 4.f / (ellipse.size.height * ellipse.size.height);
+
+        const cv::Point2f d = origin - ellipse.center;
+        dx = (d.x * c) + (d.y * s);
+        dy = (d.y * c) - (d.x * s);
+        C = (dx * dx * ia) + (dy * dy * ib) - 1.f;
+    }
+
+    // Farthest intersection along v (the only one with t > 0 for an origin inside the ellipse):
+    cv::Point2f operator()(float vx, float vy) const
+    {
+        const float ux = (vx * c) + (vy * s), uy = (vy * c) - (vx * s);
+        const float A = (ux * ux * ia) + (uy * uy * ib);
+        const float B = 2.f * ((dx * ux * ia) + (dy * uy * ib));
+        const float t = (-B + std::sqrt(std::max((B * B) - (4.f * A * C), 0.f))) / (2.f * A);
+        return { origin.x + (t * vx), origin.y + (t * vy) };
+    }
+
+    cv::Point2f origin;
+    float c, s, ia, ib, dx, dy, C;
+};
+
+// Rays from the pupil boundary to the iris boundary for each padded column:
+static void createPixelRays(const EyeModel& eye, const std::vector<float>& cosTheta, const std::vector<float>& sinTheta, IrisNormalizer::Rays& rayPixels)
 {
+    const cv::Point2f& center = eye.pupilEllipse.center;
+    const EllipseRay iris(eye.irisEllipse, center), pupil(eye.pupilEllipse, center);
+
+    rayPixels.resize(cosTheta.size());
+    for (int i = 0; i < cosTheta.size(); i++)
+    {
+        // Rays are cast at theta + pi (the orientation of the conic-line intersection
+        // based normalization, which is preserved for existing templates):
+        const float vx = -cosTheta[i], vy = -sinTheta[i];
+        rayPixels[i] = { { pupil(vx, vy), iris(vx, vy) } };
+    }
 }
 
-void IrisNormalizer::warpIris(const cv::Mat& crop, const cv::Mat1b& mask, const cv::Size& paddedSize, Rays& rayPixels, Rays& rayTexels, NormalizedIris& code, int padding) const
+// dst[i] = p[i] + alpha * d[i]
+static void interpolate(const float* p, const float* d, float alpha, float* dst, int n)
+{
+    int i = 0;
+#if DO_SSE
+    const __m128 a = _mm_set1_ps(alpha);
+    for (; i <= n - 4; i += 4)
+    {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(p + i), _mm_mul_ps(a, _mm_loadu_ps(d + i))));
+    }
+#elif DO_ARM_NEON
+    for (; i <= n - 4; i += 4)
+    {
+        vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(p + i), vld1q_f32(d + i), alpha));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[i] = p[i] + (alpha * d[i]);
+    }
+}
+
+// Row y samples the rays at pupil * alpha + iris * (1 - alpha), alpha = (y + 1) / height,
+// i.e., the first row is next to the iris boundary and the last row is on the pupil:
+static void createMaps(const IrisNormalizer::Rays& rayPixels, const cv::Size& paddedSize, cv::Mat1f& mapX, cv::Mat1f& mapY)
+{
+    const int n = paddedSize.width;
+    cv::Mat1f rays(4, n); // iris x, iris y, (pupil - iris) x, (pupil - iris) y
+    for (int x = 0; x < n; x++)
+    {
+        const auto& pp = rayPixels[x][0];
+        const auto& pi = rayPixels[x][1];
+        rays(0, x) = pi.x;
+        rays(1, x) = pi.y;
+        rays(2, x) = pp.x - pi.x;
+        rays(3, x) = pp.y - pi.y;
+    }
+
+    mapX.create(paddedSize);
+    mapY.create(paddedSize);
+    for (int y = 0; y < paddedSize.height; y++)
+    {
+        const float alpha = (y + 1) / float(paddedSize.height);
+        interpolate(rays[0], rays[2], alpha, mapX[y], n);
+        interpolate(rays[1], rays[3], alpha, mapY[y], n);
+    }
+}
+
+static void remapIris(const cv::Mat& crop, const cv::Mat& mask, const cv::Size& paddedSize, const cv::Mat& map1, const cv::Mat& map2, bool fastMode, int padding, NormalizedIris& code)
 {
     code.getRoi() = cv::Rect({ padding, 0 }, paddedSize - cv::Size(2 * padding, 0));
     code.getPaddedMask().create(paddedSize, CV_8UC1);
     code.getPaddedImage().create(paddedSize, crop.type());
     code.getPaddedImage() = cv::Scalar::all(0);
 
-    cv::Mat1f mapX(paddedSize), mapY(paddedSize);
+    cv::remap(crop, code.getPaddedImage(), map1, map2, fastMode ? cv::INTER_LINEAR : cv::INTER_CUBIC);
+    cv::remap(mask, code.getPaddedMask(), map1, map2, cv::INTER_NEAREST);
+}
 
-    for (int x = 0; x < paddedSize.width; x++)
+// Largest boundary displacement (approximately) between two ellipses:
+static float getDistance(const cv::RotatedRect& a, const cv::RotatedRect& b)
+{
+    const float radius = 0.5f * std::max({ a.size.width, a.size.height, b.size.width, b.size.height });
+    const float angle = std::abs(std::remainder(a.angle - b.angle, 180.f)) * float(M_PI / 180.0);
+    return std::max({ float(cv::norm(a.center - b.center)),
+        0.5f * std::abs(a.size.width - b.size.width),
+        0.5f * std::abs(a.size.height - b.size.height),
+        angle * radius });
+}
+
+IrisNormalizer::IrisNormalizer()
+    : m_cache(std::make_shared<Cache>())
+{
+}
+
+std::shared_ptr<const IrisNormalizer::Table> IrisNormalizer::getTable(const cv::Size& size, int padding) const
+{
+    std::lock_guard<std::mutex> lock(m_cache->mutex);
+    auto& table = m_cache->table;
+    if (!table || (table->size != size) || (table->padding != padding))
     {
-        for (int y = 0; y < paddedSize.height; y++)
+        auto result = std::make_shared<Table>();
+        result->size = size;
+        result->padding = padding;
+        for (int x = -padding; x < (size.width + padding); x++)
         {
-            const float alpha = (y + 1) / float(paddedSize.height), beta = (1.0 - alpha);
-            const auto& pi = rayPixels[x][0];
-            const auto& pp = rayPixels[x][1];
-            const cv::Point2f u = (pi * alpha) + (pp * beta);
-            mapX(y, x + padding) = u.x;
-            mapY(y, x + padding) = u.y;
+            const float theta = float((x + size.width) % size.width) / size.width * float(2.0 * M_PI);
+            result->cosTheta.push_back(std::cos(theta));
+            result->sinTheta.push_back(std::sin(theta));
         }
+        table = result;
     }
+    return table;
+}
+
+void IrisNormalizer::warpIris(const cv::Mat& crop, const cv::Mat1b& mask, const cv::Size& paddedSize, Rays& rayPixels, Rays& rayTexels, NormalizedIris& code, int padding) const
+{
+    cv::Mat1f mapX, mapY;
+    createMaps(rayPixels, paddedSize, mapX, mapY);
 
-    cv::remap(crop, code.getPaddedImage(), mapX, mapY, cv::INTER_CUBIC);
-    cv::remap(mask, code.getPaddedMask(), mapX, mapY, cv::INTER_NEAREST);
+    cv::Mat map1 = mapX, map2 = mapY;
+    if (m_fastMode)
+    {
+        cv::convertMaps(mapX, mapY, map1, map2, CV_16SC2);
+    }
+    remapIris(crop, mask, paddedSize, map1, map2, m_fastMode, padding, code);
 }
 
 cv::Size IrisNormalizer::createRays(const EyeModel& eye, const cv::Size& size, Rays& rayPixels, Rays& rayTexels, int padding) const
 {
-    cv::Matx33f iris = drishti::geometry::ConicSection_<float>(eye.irisEllipse).getMatrix();
-    cv::Matx33f pupil = drishti::geometry::ConicSection_<float>(eye.pupilEllipse).getMatrix();
-    cv::Size paddedSize = size + cv::Size(2 * padding, 0);
+    const auto table = getTable(size, padding);
+    const cv::Size paddedSize = size + cv::Size(2 * padding, 0);
 
-    rayPixels.reserve(paddedSize.width);
-    rayTexels.reserve(paddedSize.width);
+    createPixelRays(eye, table->cosTheta, table->sinTheta, rayPixels);
 
-    /* int n = 0; */
-    cv::Vec3f P[2];
-    cv::Point2f p[2], pi, pp;
-    for (int x = -padding; x < (size.width + padding); x++)
+    // Add corresponding rays in normalized coordinates:
+    rayTexels.resize(rayPixels.size());
+    for (int x = 0; x < paddedSize.width; x++)
     {
-        const float theta = float((x + size.width) % size.width) / size.width * float(2.0 * M_PI);
-        cv::Point3f v(std::cos(theta), std::sin(theta), 0);
-        cv::Point3f c(eye.pupilEllipse.center.x, eye.pupilEllipse.center.y, 1.f);
-        const cv::Point3f L = c.cross(c + v);
-
-        // TODO: should be able to avoid need for the dot product
-        /* n = */ drishti::geometry::intersectConicLine(iris, L, P);
-        p[0] = { P[0][0] / P[0][2], P[0][1] / P[0][2] };
-        p[1] = { P[1][0] / P[1][2], P[1][1] / P[1][2] };
-        pi = p[cv::Point2f(v.x, v.y).dot(p[0] - cv::Point2f(c.x, c.y)) > 0];
-
-        /* n = */ drishti::geometry::intersectConicLine(pupil, L, P);
-        p[0] = { P[0][0] / P[0][2], P[0][1] / P[0][2] };
-        p[1] = { P[1][0] / P[1][2], P[1][1] / P[1][2] };
-        pp = p[cv::Point2f(v.x, v.y).dot(p[0] - cv::Point2f(c.x, c.y)) > 0];
-        Ray rayPixel = { { pp, pi } };
-
-        // Add corresponding ray in normalized coordinates:
-        cv::Point2f tp(float(x + padding) / paddedSize.width, 0.0);
-        cv::Point2f ti(tp.x, 1.0);
-        Ray rayTexel = { { tp, ti } };
-
-        rayPixels.emplace_back(rayPixel);
-        rayTexels.emplace_back(rayTexel);
+        const cv::Point2f tp(float(x) / paddedSize.width, 0.0);
+        rayTexels[x] = { { tp, { tp.x, 1.f } } };
     }
 
     return paddedSize;
@@ -94,10 +232,50 @@ cv::Size IrisNormalizer::createRays(const EyeModel& eye, const cv::Size& size, R
 void IrisNormalizer::operator()(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, int padding) const
 {
     cv::Mat mask = eye.irisMask(crop.size());
+    const cv::Size paddedSize = size + cv::Size(2 * padding, 0);
+
+    cv::Mat map1, map2;
+    {
+        std::lock_guard<std::mutex> lock(m_cache->mutex);
+        const Cache& cache = *m_cache;
+        if (cache.valid && (cache.size == size) && (cache.padding == padding) && (cache.fastMode == m_fastMode) &&
+            (getDistance(cache.iris, eye.irisEllipse) <= m_tolerance) && (getDistance(cache.pupil, eye.pupilEllipse) <= m_tolerance))
+        {
+            map1 = cache.map1;
+            map2 = cache.map2;
+        }
+    }
+
+    if (map1.empty())
+    {
+        Rays rayPixels, rayTexels;
+        createRays(eye, size, rayPixels, rayTexels, padding);
+
+        cv::Mat1f mapX, mapY;
+        createMaps(rayPixels, paddedSize, mapX, mapY);
+        if (m_fastMode)
+        {
+            cv::convertMaps(mapX, mapY, map1, map2, CV_16SC2);
+        }
+        else
+        {
+            map1 = mapX;
+            map2 = mapY;
+        }
+
+        std::lock_guard<std::mutex> lock(m_cache->mutex);
+        Cache& cache = *m_cache;
+        cache.valid = true;
+        cache.size = size;
+        cache.padding = padding;
+        cache.fastMode = m_fastMode;
+        cache.iris = eye.irisEllipse;
+        cache.pupil = eye.pupilEllipse;
+        cache.map1 = map1;
+        cache.map2 = map2;
+    }
 
-    Rays rayPixels, rayTexels;
-    cv::Size paddedSize = createRays(eye, size, rayPixels, rayTexels, padding);
-    warpIris(crop, mask, paddedSize, rayPixels, rayTexels, code, padding);
+    remapIris(crop, mask, paddedSize, map1, map2, m_fastMode, padding, code);
 }
 
 DRISHTI_EYE_NAMESPACE_END
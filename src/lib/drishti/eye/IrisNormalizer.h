@@ -18,9 +18,13 @@
 #include "drishti/eye/NormalizedIris.h"
 
 #include <array>
+#include <memory>
 
 DRISHTI_EYE_NAMESPACE_BEGIN
 
+// Angular sin/cos tables are computed once per output size, and the last
+// unwrapping maps are reused while the iris and pupil ellipses stay within
+// a tolerance (e.g., video).  Copies share the cache, which is thread safe.
 class IrisNormalizer
 {
 public:
@@ -29,11 +33,39 @@ public:
 
     IrisNormalizer();
 
+    // Fast mode: bilinear interpolation with fixed point (CV_16SC2) maps (default: cubic with float maps)
+    void setFastMode(bool flag)
+    {
+        m_fastMode = flag;
+    }
+    bool getFastMode() const
+    {
+        return m_fastMode;
+    }
+
+    // Maps are reused while the ellipses change by less than this many pixels (default: 0, identical ellipses)
+    void setTolerance(float pixels)
+    {
+        m_tolerance = pixels;
+    }
+    float getTolerance() const
+    {
+        return m_tolerance;
+    }
+
     cv::Size createRays(const EyeModel& eye, const cv::Size& size, Rays& rayPixels, Rays& rayTexels, int padding = 0) const;
     void warpIris(const cv::Mat& crop, const cv::Mat1b& mask, const cv::Size& paddedSize, Rays& rayPixels, Rays& rayTexels, NormalizedIris& code, int padding = 0) const;
     void operator()(const cv::Mat& crop, const EyeModel& eye, const cv::Size& size, NormalizedIris& code, int padding = 0) const;
 
 protected:
+    struct Table;
+    struct Cache;
+
+    std::shared_ptr<const Table> getTable(const cv::Size& size, int padding) const;
+
+    bool m_fastMode = false;
+    float m_tolerance = 0.f;
+    std::shared_ptr<Cache> m_cache;
 };
 
 DRISHTI_EYE_NAMESPACE_END
@@ -0,0 +1,117 @@
+/*!
+  @file   IrisQuality.cpp
+  @author David Hirvonen
+  @brief  Implementation of a fast iris quality assessment (before normalization).
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/eye/IrisQuality.h"
+#include "drishti/eye/EyeRasterizer.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+DRISHTI_EYE_NAMESPACE_BEGIN
+
+IrisQualityEstimator::IrisQualityEstimator()
+    : IrisQualityEstimator(Recipe())
+{
+}
+
+IrisQualityEstimator::IrisQualityEstimator(const Recipe& recipe)
+    : m_recipe(recipe)
+{
+}
+
+IrisQuality IrisQualityEstimator::operator()(const cv::Mat& crop, const EyeModel& eye) const
+{
+    IrisQuality quality;
+
+    const cv::RotatedRect& iris = eye.irisEllipse;
+    const cv::RotatedRect& pupil = eye.pupilEllipse;
+    const float a = 0.5f * std::max(iris.size.width, iris.size.height);
+    const float b = 0.5f * std::min(iris.size.width, iris.size.height);
+    if (crop.empty() || (b <= 0.f))
+    {
+        return quality;
+    }
+
+    CV_Assert(crop.depth() == CV_8U);
+    quality.failures = 0;
+
+    // ######## Geometry (no pixels) #########
+    quality.eccentricity = std::sqrt(1.f - ((b * b) / (a * a)));
+    if (quality.eccentricity > m_recipe.maxEccentricity)
+    {
+        quality.failures |= IrisQuality::kOffAxis;
+    }
+
+    const bool hasPupil = (pupil.size.area() > 0.f);
+    if (hasPupil)
+    {
+        quality.dilation = (pupil.size.width + pupil.size.height) / (iris.size.width + iris.size.height);
+        if ((quality.dilation < m_recipe.minDilation) || (quality.dilation > m_recipe.maxDilation))
+        {
+            quality.failures |= IrisQuality::kDilation;
+        }
+    }
+
+    // ######## Visible annulus #########
+    const cv::Rect roi = iris.boundingRect() & cv::Rect({ 0, 0 }, crop.size());
+    if (roi.area() == 0)
+    {
+        quality.failures |= IrisQuality::kNoIris;
+        return quality;
+    }
+
+    // Iris and pupil within the eyelids in one rasterizer pass:
+    EyeMasks masks;
+    rasterize(eye - roi.tl(), roi.size(), masks, EyeMasks::kIris | EyeMasks::kPupil);
+    cv::Mat1b annulus = masks.iris;
+    annulus.setTo(0, masks.pupil);
+
+    // The annulus area is analytic, so the part outside of the crop counts as occluded:
+    const float area = float(CV_PI) * ((a * b) - (hasPupil ? (0.25f * pupil.size.area()) : 0.f));
+    quality.usableArea = std::min(float(cv::countNonZero(annulus)) / std::max(area, 1.f), 1.f);
+    if (quality.usableArea <= 0.f)
+    {
+        quality.failures |= IrisQuality::kNoIris;
+        return quality;
+    }
+    if (quality.usableArea < m_recipe.minUsableArea)
+    {
+        quality.failures |= IrisQuality::kOccluded;
+    }
+
+    // ######## Focus #########
+    // Red channel is closest to NIR for iris.  The 4 neighbor Laplacian and the
+    // masked moments are both vectorized in OpenCV.  The mask is eroded so that
+    // the pupil and eyelid boundaries don't contribute edges to the measure.
+    cv::Mat gray = crop(roi), laplacian;
+    if (gray.channels() > 1)
+    {
+        cv::extractChannel(crop(roi), gray, std::min(2, crop.channels() - 1));
+    }
+    cv::Laplacian(gray, laplacian, CV_16S, 1);
+    cv::erode(annulus, annulus, cv::Mat());
+
+    if (cv::countNonZero(annulus))
+    {
+        cv::Scalar mu, sigma;
+        cv::meanStdDev(laplacian, mu, sigma, annulus);
+        quality.focus = static_cast<float>(sigma[0] * sigma[0]);
+    }
+    if (quality.focus < m_recipe.minFocus)
+    {
+        quality.failures |= IrisQuality::kBlurred;
+    }
+
+    return quality;
+}
+
+DRISHTI_EYE_NAMESPACE_END
@@ -0,0 +1,78 @@
+/*!
+  @file   IrisQuality.h
+  @author David Hirvonen
+  @brief  Declaration of a fast iris quality assessment (before normalization).
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_eye_IrisQuality_h__
+#define __drishti_eye_IrisQuality_h__
+
+#include "drishti/eye/drishti_eye.h"
+#include "drishti/eye/Eye.h"
+
+#include <opencv2/core.hpp>
+
+DRISHTI_EYE_NAMESPACE_BEGIN
+
+struct IrisQuality
+{
+    // Failed checks (bit mask):
+    enum
+    {
+        kNoIris = 1,     // no iris ellipse (or no visible annulus pixels)
+        kOccluded = 2,   // too little of the annulus is visible between the eyelids
+        kBlurred = 4,    // low Laplacian variance in the visible annulus
+        kDilation = 8,   // pupil to iris ratio outside the usable range
+        kOffAxis = 16    // eccentric iris ellipse (off axis gaze)
+    };
+
+    float usableArea = 0.f;   // visible fraction of the iris annulus
+    float focus = 0.f;        // Laplacian variance in the visible annulus (8 bit intensity)
+    float dilation = 0.f;     // pupil to iris radius ratio (0: no pupil)
+    float eccentricity = 0.f; // iris ellipse eccentricity (0: circle)
+    int failures = kNoIris;
+
+    bool isGood() const
+    {
+        return (failures == 0);
+    }
+};
+
+// Cheap checks on the eye model and the iris pixels, used to skip the
+// normalization and encoding of irises that will never match (blurred,
+// occluded, off axis or extremely dilated/constricted).  Only the iris
+// bounding box of the crop is touched.
+class IrisQualityEstimator
+{
+public:
+    struct Recipe
+    {
+        float minUsableArea = 0.5f;   // min visible fraction of the annulus
+        float minFocus = 20.f;        // min Laplacian variance (8 bit intensity)
+        float minDilation = 0.15f;    // min pupil to iris radius ratio (if a pupil is present)
+        float maxDilation = 0.75f;    // max pupil to iris radius ratio
+        float maxEccentricity = 0.7f; // max iris ellipse eccentricity
+    };
+
+    IrisQualityEstimator();
+    IrisQualityEstimator(const Recipe& recipe);
+
+    // The crop (grayscale or BGR, red channel) must be in the eye model coordinates:
+    IrisQuality operator()(const cv::Mat& crop, const EyeModel& eye) const;
+
+    const Recipe& getRecipe() const
+    {
+        return m_recipe;
+    }
+
+protected:
+    Recipe m_recipe;
+};
+
+DRISHTI_EYE_NAMESPACE_END
+
+#endif /* defined(__drishti_eye_IrisQuality_h__) */
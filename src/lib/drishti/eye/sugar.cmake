@@ -14,12 +14,17 @@ include(sugar_files)
 sugar_files(DRISHTI_EYE_SRCS
   Eye.cpp
   EyeIO.cpp
+  EyeRasterizer.cpp
   EyeModelEstimator.cpp
   EyeModelIris.cpp
   EyeModelEyelids.cpp
   EyeModelPupil.cpp
+  EyeModelTracking.cpp
   NormalizedIris.cpp
   IrisNormalizer.cpp
+  IrisCode.cpp
+  IrisMatcher.cpp
+  IrisQuality.cpp
   )
 
 if(DRISHTI_SERIALIZE_WITH_BOOST)
@@ -45,10 +50,14 @@ sugar_files(DRISHTI_EYE_HDRS_PUBLIC
   Eye.h
   EyeImpl.h
   EyeIO.h
+  EyeRasterizer.h
   EyeModelEstimator.h
   EyeModelEstimatorImpl.h
   NormalizedIris.h
   IrisNormalizer.h
+  IrisCode.h
+  IrisMatcher.h
+  IrisQuality.h
   drishti_eye.h
   )
 
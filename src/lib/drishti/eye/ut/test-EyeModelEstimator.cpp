@@ -9,6 +9,9 @@
 */
 
 #include "drishti/eye/EyeModelEstimator.h"
+#include "drishti/eye/EyeModelEstimatorImpl.h" // shipped regressors
+#include "drishti/ml/XGBooster.h"
+#include "drishti/ml/TreeEnsemble.h"
 
 #if DRISHTI_SERIALIZE_WITH_BOOST
 #include "drishti/core/boost_serialize_common.h"
@@ -38,6 +41,8 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
 
@@ -324,6 +329,282 @@ TEST_F(EyeModelEstimatorTest, IsRepeatable)
     }
 }
 
+TEST_F(EyeModelEstimatorTest, CoarseToFine)
+{
+    if (!m_eye || !m_eyeSegmenter)
+    {
+        return;
+    }
+
+    double coarseTime = 0.0, fineTime = 0.0;
+    m_eyeSegmenter->setCoarseTargetWidth(64);
+    m_eyeSegmenter->setCoarseTimeLogger([&](double seconds) { coarseTime += seconds; });
+    m_eyeSegmenter->setFineTimeLogger([&](double seconds) { fineTime += seconds; });
+
+    for (int i = 128; i < m_images.size(); i++)
+    {
+        assert(m_images[i].isRight);
+        drishti::eye::EyeModel eye;
+        int code = (*m_eyeSegmenter)(m_images[i].image, eye);
+        EXPECT_EQ(code, 0);
+
+        eye.refine();
+        checkValid(eye, m_images[i].image.size());
+
+        const float scaleGroundTruthToCurrent = float(m_images[i].image.cols) / float(m_targetWidth);
+        const float score = detectionScore(*m_eye, eye, m_images[i].image.size(), scaleGroundTruthToCurrent);
+        ASSERT_GT(score, m_scoreThreshold);
+    }
+
+    EXPECT_GT(coarseTime, 0.0);
+    EXPECT_GT(fineTime, 0.0);
+}
+
+// The batch estimate of each crop must match the single crop estimate:
+TEST_F(EyeModelEstimatorTest, ImageBatch)
+{
+    if (!m_eye || !m_eyeSegmenter)
+    {
+        return;
+    }
+
+    std::vector<cv::Mat> crops;
+    for (int i = 64; i < m_images.size(); i += 8)
+    {
+        crops.push_back(m_images[i].image);
+    }
+
+    std::vector<drishti::eye::EyeModel> eyes;
+    int code = (*m_eyeSegmenter)(crops, eyes);
+    EXPECT_EQ(code, 0);
+    ASSERT_EQ(eyes.size(), crops.size());
+
+    for (int i = 0; i < crops.size(); i++)
+    {
+        drishti::eye::EyeModel eye;
+        (*m_eyeSegmenter)(crops[i], eye);
+        EXPECT_EQ(isEqual(eyes[i], eye), true);
+    }
+}
+
+// Batches of mixed crop sizes (and flipped left eyes) match the single crop
+// estimates for single and multiple eyelid and iris inits:
+TEST_F(EyeModelEstimatorTest, ImageBatchInits)
+{
+    if (!m_eyeSegmenter)
+    {
+        return;
+    }
+
+    std::vector<cv::Mat> crops;
+    for (int i = 96; i < m_images.size(); i += 16)
+    {
+        cv::Mat flipped;
+        cv::flip(m_images[i].image, flipped, 1);
+        crops.push_back(m_images[i].image);
+        crops.push_back(flipped);
+    }
+
+    for (int inits : { 1, 4 })
+    {
+        m_eyeSegmenter->setEyelidInits(inits);
+        m_eyeSegmenter->setIrisInits(inits);
+
+        std::vector<drishti::eye::EyeModel> eyes;
+        int code = (*m_eyeSegmenter)(crops, eyes);
+        EXPECT_EQ(code, 0);
+        ASSERT_EQ(eyes.size(), crops.size());
+
+        for (int i = 0; i < crops.size(); i++)
+        {
+            drishti::eye::EyeModel eye;
+            (*m_eyeSegmenter)(crops[i], eye);
+            EXPECT_EQ(isEqual(eyes[i], eye), true);
+        }
+    }
+}
+
+// Tracking a static eye from its own fit must stay on the ground truth:
+TEST_F(EyeModelEstimatorTest, Tracking)
+{
+    if (!m_eye || !m_eyeSegmenter)
+    {
+        return;
+    }
+
+    for (int i = 128; i < m_images.size(); i += 8)
+    {
+        assert(m_images[i].isRight);
+        drishti::eye::EyeModel previous, eye;
+        int code = (*m_eyeSegmenter)(m_images[i].image, previous);
+        EXPECT_EQ(code, 0);
+
+        // The shortened cascade is used only with a warm start model, otherwise this is a full fit:
+        bool isTracked = false;
+        code = (*m_eyeSegmenter)(m_images[i].image, previous, cv::Matx33f::eye(), eye, &isTracked);
+        EXPECT_EQ(code, 0);
+        EXPECT_TRUE(isTracked);
+
+        eye.refine();
+        checkValid(eye, m_images[i].image.size());
+
+        const float scaleGroundTruthToCurrent = float(m_images[i].image.cols) / float(m_targetWidth);
+        const float score = detectionScore(*m_eye, eye, m_images[i].image.size(), scaleGroundTruthToCurrent);
+        ASSERT_GT(score, m_scoreThreshold);
+    }
+}
+
+// A small frame to frame motion (given by H) is tracked:
+TEST_F(EyeModelEstimatorTest, TrackingMotion)
+{
+    if (!m_eye || !m_eyeSegmenter)
+    {
+        return;
+    }
+
+    for (int i = 128; i < m_images.size(); i += 8)
+    {
+        const cv::Mat& image = m_images[i].image;
+        drishti::eye::EyeModel previous, eye;
+        int code = (*m_eyeSegmenter)(image, previous);
+        EXPECT_EQ(code, 0);
+
+        // Shift the eye by ~2% of the crop width:
+        const cv::Point2f shift(float(image.cols) * 0.02f, float(image.cols) * 0.01f);
+        const cv::Matx23f T(1, 0, shift.x, 0, 1, shift.y);
+        const cv::Matx33f H(1, 0, shift.x, 0, 1, shift.y, 0, 0, 1);
+        cv::Mat shifted;
+        cv::warpAffine(image, shifted, T, image.size(), cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+
+        bool isTracked = false;
+        code = (*m_eyeSegmenter)(shifted, previous, H, eye, &isTracked);
+        EXPECT_EQ(code, 0);
+        EXPECT_TRUE(isTracked);
+
+        eye.refine();
+        checkValid(eye, image.size());
+
+        const float scaleGroundTruthToCurrent = float(image.cols) / float(m_targetWidth);
+        const float score = detectionScore(*m_eye, eye - shift, image.size(), scaleGroundTruthToCurrent);
+        ASSERT_GT(score, m_scoreThreshold);
+    }
+}
+
+// Blinks and occlusions lose the track, the result is then the full fit:
+TEST_F(EyeModelEstimatorTest, TrackingFallback)
+{
+    if (!m_eyeSegmenter)
+    {
+        return;
+    }
+
+    for (int i = 128; i < m_images.size(); i += 8)
+    {
+        const cv::Mat& image = m_images[i].image;
+        drishti::eye::EyeModel previous;
+        int code = (*m_eyeSegmenter)(image, previous);
+        EXPECT_EQ(code, 0);
+
+        // Blink: the aperture is filled with the surrounding skin:
+        const cv::Mat1b aperture = previous.mask(image.size(), false);
+        cv::Mat blink = image.clone();
+        blink.setTo(cv::mean(image, ~aperture), aperture);
+
+        // Occlusion: the upper half of the crop is covered:
+        cv::Mat occlusion = image.clone();
+        occlusion.rowRange(0, occlusion.rows / 2).setTo(0);
+
+        for (const auto& frame : { blink, occlusion })
+        {
+            drishti::eye::EyeModel eye, full;
+            bool isTracked = true;
+            code = (*m_eyeSegmenter)(frame, previous, cv::Matx33f::eye(), eye, &isTracked);
+            EXPECT_EQ(code, 0);
+            EXPECT_FALSE(isTracked);
+
+            (*m_eyeSegmenter)(frame, full);
+            EXPECT_EQ(isEqual(eye, full), true);
+        }
+    }
+}
+
+// Access to the regressors of a loaded model:
+class EyeModelEstimatorInternals : public drishti::eye::EyeModelEstimator
+{
+public:
+    using drishti::eye::EyeModelEstimator::EyeModelEstimator;
+
+    const drishti::eye::EyeModelEstimator::Impl* getImpl() const
+    {
+        return m_impl.get();
+    }
+};
+
+// The compiled ensembles of the shipped iris and pupil CPR models must match the xgboost
+// learners (models stored without a learner predict through the ensemble in both cases):
+TEST(EyeModelEstimator, CompiledEnsembles)
+{
+    if (!isArchiveSupported(modelFilename))
+    {
+        return;
+    }
+
+    EyeModelEstimatorInternals segmenter(modelFilename);
+    ASSERT_TRUE(segmenter.good());
+
+    cv::RNG rng(1);
+    int count = 0;
+    for (const auto* estimator : { segmenter.getImpl()->getIrisEstimator(), segmenter.getImpl()->getPupilEstimator() })
+    {
+        const auto* cpr = dynamic_cast<const drishti::rcpr::CPR*>(estimator);
+        if (!cpr)
+        {
+            continue;
+        }
+
+        for (const auto& reg : (*cpr->regModel->regs))
+        {
+            for (const auto& t : reg->xgbdt)
+            {
+                const drishti::ml::TreeEnsemble* ensemble = t.second->getEnsemble();
+                ASSERT_NE(ensemble, nullptr);
+
+                // Features are drawn around the split values, so all branches (and missing values) are visited:
+                int n = static_cast<int>(*reg->ftrData->F);
+                std::vector<float> splits;
+                for (const auto& node : ensemble->getNodes())
+                {
+                    if (node.feature >= 0)
+                    {
+                        n = std::max(n, node.feature + 1);
+                        splits.push_back(node.value);
+                    }
+                }
+                if (splits.empty())
+                {
+                    continue;
+                }
+
+                const auto range = std::minmax_element(splits.begin(), splits.end());
+                const float lower = *range.first - 1.f, upper = *range.second + 1.f;
+                std::vector<float> features(n);
+                for (int i = 0; i < 64; i++)
+                {
+                    for (auto& f : features)
+                    {
+                        f = (rng.uniform(0.f, 1.f) < 0.05f) ? NAN : rng.uniform(lower, upper);
+                    }
+
+                    const float expected = t.second->predictReference(features);
+                    EXPECT_NEAR(ensemble->predict(features), expected, 1e-4f * std::max(1.f, std::abs(expected)));
+                    count++;
+                }
+            }
+        }
+    }
+    EXPECT_GT(count, 0);
+}
+
 // Currently there is no internal quality check, but this is included for regression:
 TEST_F(EyeModelEstimatorTest, ImageIsBlack)
 {
@@ -0,0 +1,115 @@
+/*!
+  @file   test-EyeRasterizer.cpp
+  @author David Hirvonen
+  @brief  Google test for the eye model scanline rasterizer.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "drishti/eye/EyeRasterizer.h"
+
+#include <opencv2/imgproc.hpp>
+
+// clang-format off
+#define BEGIN_EMPTY_NAMESPACE namespace {
+#define END_EMPTY_NAMESPACE }
+// clang-format on
+
+BEGIN_EMPTY_NAMESPACE
+
+using drishti::eye::EyeMasks;
+using drishti::eye::EyeModel;
+
+class EyeRasterizerTest : public ::testing::Test
+{
+protected:
+    EyeRasterizerTest()
+        : size(256, 192)
+    {
+        // Eyelid aperture crossing the top of the iris:
+        for (int i = 0; i < 16; i++)
+        {
+            const float theta = float(i) * float(2.0 * M_PI / 16.0);
+            eye.eyelids.emplace_back(128.f + 112.f * std::cos(theta), 100.f + 48.f * std::sin(theta));
+        }
+        eye.irisEllipse = cv::RotatedRect({ 124.f, 90.f }, { 96.f, 90.f }, 20.f);
+        eye.pupilEllipse = cv::RotatedRect({ 126.f, 91.f }, { 36.f, 32.f }, 70.f);
+    }
+
+    // Fraction of the pixels that differ from the OpenCV drawing:
+    static float difference(const cv::Mat1b& a, const cv::Mat1b& b)
+    {
+        return float(cv::countNonZero(a != b)) / float(std::max(cv::countNonZero(b), 1));
+    }
+
+    cv::Size size;
+    EyeModel eye;
+};
+
+TEST_F(EyeRasterizerTest, MatchesDrawing)
+{
+    EyeMasks masks;
+    drishti::eye::rasterize(eye, size, masks);
+
+    std::vector<std::vector<cv::Point>> contours(1);
+    std::copy(eye.eyelids.begin(), eye.eyelids.end(), std::back_inserter(contours[0]));
+
+    cv::Mat1b aperture(size, 0), iris(size, 0), pupil(size, 0);
+    cv::fillPoly(aperture, contours, 255, 4);
+    cv::ellipse(iris, eye.irisEllipse, 255, -1, 4);
+    cv::ellipse(pupil, eye.pupilEllipse, 255, -1, 4);
+
+    // Boundary pixels only:
+    EXPECT_LT(difference(masks.eye, aperture), 0.05f);
+    EXPECT_LT(difference(masks.iris, iris & aperture), 0.05f);
+    EXPECT_LT(difference(masks.pupil, pupil & aperture), 0.1f);
+}
+
+// All masks come from the same spans, so they are exactly consistent:
+TEST_F(EyeRasterizerTest, Consistent)
+{
+    EyeMasks masks;
+    drishti::eye::rasterize(eye, size, masks);
+
+    EXPECT_EQ(cv::countNonZero(masks.iris & ~masks.eye), 0);
+    EXPECT_EQ(cv::countNonZero(masks.pupil & ~masks.iris), 0);
+    EXPECT_EQ(cv::countNonZero(masks.sclera != (masks.eye & ~masks.iris)), 0);
+
+    cv::Mat1b labels = masks.eye.clone();
+    labels.setTo(127, masks.iris);
+    EXPECT_EQ(cv::countNonZero(masks.labels != labels), 0);
+
+    // The EyeModel methods are views of the same masks:
+    EXPECT_EQ(cv::countNonZero(eye.mask(size, false) != masks.eye), 0);
+    EXPECT_EQ(cv::countNonZero(eye.mask(size, true) != masks.sclera), 0);
+    EXPECT_EQ(cv::countNonZero(eye.irisMask(size) != masks.iris), 0);
+    EXPECT_EQ(cv::countNonZero(eye.labels(size) != masks.labels), 0);
+}
+
+TEST_F(EyeRasterizerTest, EllipseArea)
+{
+    eye.eyelids.clear();
+
+    EyeMasks masks;
+    drishti::eye::rasterize(eye, size, masks, EyeMasks::kIris);
+    const float area = float(M_PI) * 48.f * 45.f;
+    EXPECT_NEAR(float(cv::countNonZero(masks.iris)) / area, 1.f, 0.02f);
+}
+
+// Regions are clipped to the image:
+TEST_F(EyeRasterizerTest, Clipping)
+{
+    eye += cv::Point2f(-100.f, -80.f);
+
+    EyeMasks masks;
+    drishti::eye::rasterize(eye, size, masks);
+    EXPECT_GT(cv::countNonZero(masks.eye), 0);
+    EXPECT_GT(cv::countNonZero(masks.iris), 0);
+    EXPECT_EQ(cv::countNonZero(masks.iris & ~masks.eye), 0);
+}
+
+END_EMPTY_NAMESPACE
@@ -0,0 +1,106 @@
+/*!
+  @file   test-IrisCode.cpp
+  @author David Hirvonen
+  @brief  Google test for iris template encoding and matching.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "drishti/eye/IrisCode.h"
+#include "drishti/eye/IrisMatcher.h"
+
+#include <opencv2/imgproc.hpp>
+
+// clang-format off
+#define BEGIN_EMPTY_NAMESPACE namespace {
+#define END_EMPTY_NAMESPACE }
+// clang-format on
+
+BEGIN_EMPTY_NAMESPACE
+
+using drishti::eye::IrisCode;
+using drishti::eye::IrisEncoder;
+using drishti::eye::IrisGallery;
+using drishti::eye::IrisMatcher;
+using drishti::eye::NormalizedIris;
+
+// Smooth random texture at the encoder resolution (no resampling):
+static NormalizedIris createIris(const cv::Size& size, int seed)
+{
+    cv::RNG rng(seed);
+    cv::Mat1b image(size), mask(size, 255);
+    rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+    cv::GaussianBlur(image, image, { 5, 1 }, 1.5);
+    mask.colRange(0, size.width / 8) = 0; // occlusion
+    return NormalizedIris(image, mask, { { 0, 0 }, size });
+}
+
+class IrisCodeTest : public ::testing::Test
+{
+protected:
+    IrisCodeTest()
+    {
+        encoder(createIris(encoder.getRecipe().size, 1), probe);
+    }
+
+    IrisEncoder encoder;
+    IrisCode probe;
+};
+
+TEST_F(IrisCodeTest, Encode)
+{
+    const auto& size = encoder.getRecipe().size;
+    ASSERT_EQ(probe.columns, size.width);
+    ASSERT_EQ(probe.bitsPerColumn, size.height * 2);
+    ASSERT_EQ(probe.code.size(), probe.words());
+    ASSERT_EQ(probe.mask.size(), probe.words());
+}
+
+// Rotating the image or the template must give the same code (the row filters are circular):
+TEST_F(IrisCodeTest, Rotation)
+{
+    IrisCode rotated;
+    encoder(createIris(encoder.getRecipe().size, 1).rotate(5), rotated);
+
+    IrisMatcher matcher(8);
+    const auto match = matcher(probe, rotated);
+    EXPECT_EQ(match.rotation, 5);
+    EXPECT_LT(match.distance, 0.01f);
+}
+
+TEST_F(IrisCodeTest, Impostor)
+{
+    IrisCode other;
+    encoder(createIris(encoder.getRecipe().size, 2), other);
+
+    IrisMatcher matcher(8);
+    EXPECT_GT(matcher(probe, other).distance, 0.3f);
+}
+
+TEST_F(IrisCodeTest, GallerySearch)
+{
+    IrisGallery gallery;
+    for (int i = 0; i < 100; i++)
+    {
+        IrisCode code;
+        encoder(createIris(encoder.getRecipe().size, 100 + i), code);
+        gallery.add((i == 37) ? probe.rotate(-3) : code);
+    }
+
+    IrisMatcher matcher(8);
+    const auto results = matcher.search(probe, gallery, 5, 7);
+    ASSERT_EQ(results.size(), 5);
+    EXPECT_EQ(results[0].index, 37);
+    EXPECT_EQ(results[0].match.rotation, -3);
+    EXPECT_EQ(results[0].match.distance, 0.f);
+    for (int i = 1; i < results.size(); i++)
+    {
+        EXPECT_LE(results[i - 1].match.distance, results[i].match.distance);
+    }
+}
+
+END_EMPTY_NAMESPACE
@@ -0,0 +1,152 @@
+/*!
+  @file   test-IrisNormalizer.cpp
+  @author David Hirvonen
+  @brief  Google test for ellipso-polar iris normalization.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "drishti/eye/IrisNormalizer.h"
+
+#include <opencv2/imgproc.hpp>
+
+// clang-format off
+#define BEGIN_EMPTY_NAMESPACE namespace {
+#define END_EMPTY_NAMESPACE }
+// clang-format on
+
+BEGIN_EMPTY_NAMESPACE
+
+using drishti::eye::EyeModel;
+using drishti::eye::IrisNormalizer;
+using drishti::eye::NormalizedIris;
+
+// Implicit ellipse equation (0 on the boundary):
+static float evaluate(const cv::RotatedRect& e, const cv::Point2f& p)
+{
+    const float theta = e.angle * float(M_PI / 180.0);
+    const cv::Point2f d = p - e.center;
+    const float x = (d.x * std::cos(theta)) + (d.y * std::sin(theta));
+    const float y = (d.y * std::cos(theta)) - (d.x * std::sin(theta));
+    return std::pow(x / (0.5f * e.size.width), 2.f) + std::pow(y / (0.5f * e.size.height), 2.f) - 1.f;
+}
+
+class IrisNormalizerTest : public ::testing::Test
+{
+protected:
+    IrisNormalizerTest()
+    {
+        eye.irisEllipse = cv::RotatedRect({ 128.f, 96.f }, { 120.f, 112.f }, 20.f);
+        eye.pupilEllipse = cv::RotatedRect({ 131.f, 94.f }, { 44.f, 40.f }, 70.f);
+
+        cv::RNG rng(1);
+        image.create(192, 256);
+        rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+        cv::GaussianBlur(image, image, { 7, 7 }, 2.0);
+    }
+
+    EyeModel eye;
+    cv::Mat1b image;
+};
+
+TEST_F(IrisNormalizerTest, RaysOnBoundaries)
+{
+    IrisNormalizer::Rays rayPixels, rayTexels;
+    const cv::Size size = IrisNormalizer().createRays(eye, { 64, 16 }, rayPixels, rayTexels, 4);
+    ASSERT_EQ(size, cv::Size(72, 16));
+    ASSERT_EQ(rayPixels.size(), size.width);
+    ASSERT_EQ(rayTexels.size(), size.width);
+    for (const auto& ray : rayPixels)
+    {
+        EXPECT_NEAR(evaluate(eye.pupilEllipse, ray[0]), 0.f, 1e-4f);
+        EXPECT_NEAR(evaluate(eye.irisEllipse, ray[1]), 0.f, 1e-4f);
+    }
+}
+
+// The cached maps reproduce the original per pixel formula (row 0 next to the iris boundary, last row on the pupil):
+TEST_F(IrisNormalizerTest, MatchesPerPixelFormula)
+{
+    const cv::Size size(128, 32);
+    IrisNormalizer normalizer;
+
+    IrisNormalizer::Rays rayPixels, rayTexels;
+    const cv::Size paddedSize = normalizer.createRays(eye, size, rayPixels, rayTexels);
+
+    cv::Mat1f mapX(paddedSize), mapY(paddedSize);
+    for (int x = 0; x < paddedSize.width; x++)
+    {
+        for (int y = 0; y < paddedSize.height; y++)
+        {
+            const float alpha = (y + 1) / float(paddedSize.height), beta = (1.0 - alpha);
+            const cv::Point2f u = (rayPixels[x][0] * alpha) + (rayPixels[x][1] * beta);
+            mapX(y, x) = u.x;
+            mapY(y, x) = u.y;
+        }
+    }
+
+    cv::Mat1b expected(paddedSize, 0);
+    cv::remap(image, expected, mapX, mapY, cv::INTER_CUBIC);
+
+    NormalizedIris cached, warped;
+    normalizer(image, eye, size, cached);
+    normalizer.warpIris(image, eye.irisMask(image.size()), paddedSize, rayPixels, rayTexels, warped);
+
+    cv::Mat difference;
+    cv::absdiff(cached.getImage(), expected, difference);
+    EXPECT_LE(cv::norm(difference, cv::NORM_INF), 1.0);
+    cv::absdiff(warped.getImage(), expected, difference);
+    EXPECT_LE(cv::norm(difference, cv::NORM_INF), 1.0);
+
+    // Orientation: the first row is sampled next to the iris boundary, the last row on the pupil:
+    const cv::Point2f first(mapX(0, 0), mapY(0, 0)), last(mapX(paddedSize.height - 1, 0), mapY(paddedSize.height - 1, 0));
+    EXPECT_LT(cv::norm(last - rayPixels[0][0]), 1e-3);
+    EXPECT_LT(cv::norm(first - rayPixels[0][1]), cv::norm(first - rayPixels[0][0]));
+}
+
+// Maps are reused within the tolerance, and rebuilt beyond it:
+TEST_F(IrisNormalizerTest, MapReuse)
+{
+    const cv::Size size(128, 32);
+    IrisNormalizer normalizer;
+    normalizer.setTolerance(0.5f);
+
+    NormalizedIris expected, cached, moved;
+    normalizer(image, eye, size, expected);
+
+    EyeModel nearby = eye;
+    nearby.irisEllipse.center.x += 0.25f;
+    normalizer(image, nearby, size, cached);
+    EXPECT_EQ(cv::countNonZero(expected.getImage() != cached.getImage()), 0);
+
+    nearby.irisEllipse.center.x += 2.f;
+    normalizer(image, nearby, size, moved);
+    EXPECT_GT(cv::countNonZero(expected.getImage() != moved.getImage()), 0);
+
+    // Without the cache, i.e., a fresh normalizer:
+    NormalizedIris reference;
+    IrisNormalizer()(image, nearby, size, reference);
+    EXPECT_EQ(cv::countNonZero(reference.getImage() != moved.getImage()), 0);
+}
+
+// Bilinear sampling through fixed point maps is close to the cubic result on smooth images:
+TEST_F(IrisNormalizerTest, FastMode)
+{
+    const cv::Size size(128, 32);
+    IrisNormalizer normalizer;
+
+    NormalizedIris cubic, bilinear;
+    normalizer(image, eye, size, cubic);
+    normalizer.setFastMode(true);
+    ASSERT_TRUE(normalizer.getFastMode());
+    normalizer(image, eye, size, bilinear);
+
+    cv::Mat difference;
+    cv::absdiff(cubic.getImage(), bilinear.getImage(), difference);
+    EXPECT_LT(cv::mean(difference)[0], 2.0);
+}
+
+END_EMPTY_NAMESPACE
@@ -0,0 +1,86 @@
+/*!
+  @file   test-IrisQuality.cpp
+  @author David Hirvonen
+  @brief  Google test for the fast iris quality assessment.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "drishti/eye/IrisQuality.h"
+
+#include <opencv2/imgproc.hpp>
+
+// clang-format off
+#define BEGIN_EMPTY_NAMESPACE namespace {
+#define END_EMPTY_NAMESPACE }
+// clang-format on
+
+BEGIN_EMPTY_NAMESPACE
+
+using drishti::eye::EyeModel;
+using drishti::eye::IrisQuality;
+using drishti::eye::IrisQualityEstimator;
+
+class IrisQualityTest : public ::testing::Test
+{
+protected:
+    IrisQualityTest()
+    {
+        eye.irisEllipse = cv::RotatedRect({ 128.f, 96.f }, { 120.f, 112.f }, 20.f);
+        eye.pupilEllipse = cv::RotatedRect({ 131.f, 94.f }, { 44.f, 40.f }, 70.f);
+
+        cv::RNG rng(1);
+        image.create(192, 256);
+        rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+        cv::GaussianBlur(image, image, { 3, 3 }, 0.5);
+    }
+
+    EyeModel eye;
+    cv::Mat1b image;
+};
+
+TEST_F(IrisQualityTest, Good)
+{
+    const IrisQuality quality = IrisQualityEstimator()(image, eye);
+    EXPECT_TRUE(quality.isGood());
+    EXPECT_GT(quality.usableArea, 0.9f);
+    EXPECT_NEAR(quality.dilation, 84.f / 232.f, 1e-4f);
+    EXPECT_LT(quality.eccentricity, 0.5f);
+}
+
+TEST_F(IrisQualityTest, NoIris)
+{
+    eye.irisEllipse = cv::RotatedRect();
+    EXPECT_EQ(IrisQualityEstimator()(image, eye).failures, IrisQuality::kNoIris);
+}
+
+TEST_F(IrisQualityTest, Blurred)
+{
+    cv::GaussianBlur(image, image, { 15, 15 }, 5.0);
+    const IrisQuality quality = IrisQualityEstimator()(image, eye);
+    EXPECT_EQ(quality.failures, IrisQuality::kBlurred);
+}
+
+// A narrow eyelid aperture across the iris center:
+TEST_F(IrisQualityTest, Occluded)
+{
+    eye.eyelids = { { 0.f, 86.f }, { 256.f, 86.f }, { 256.f, 106.f }, { 0.f, 106.f } };
+    const IrisQuality quality = IrisQualityEstimator()(image, eye);
+    EXPECT_LT(quality.usableArea, 0.5f);
+    EXPECT_EQ(quality.failures, IrisQuality::kOccluded);
+}
+
+TEST_F(IrisQualityTest, Geometry)
+{
+    eye.irisEllipse.size = { 120.f, 60.f };
+    eye.pupilEllipse.size = { 100.f, 50.f };
+    const IrisQuality quality = IrisQualityEstimator()(image, eye);
+    EXPECT_TRUE(quality.failures & IrisQuality::kOffAxis);
+    EXPECT_TRUE(quality.failures & IrisQuality::kDilation);
+}
+
+END_EMPTY_NAMESPACE
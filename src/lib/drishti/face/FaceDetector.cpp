@@ -20,6 +20,7 @@
 #include "drishti/face/Face.h"
 #include "drishti/eye/EyeModelEstimator.h"
 #include "drishti/geometry/Rectangle.h"
+#include "drishti/geometry/motion.h"
 
 // clang-format off
 #if DRISHTI_SERIALIZE_WITH_BOOST
@@ -113,6 +114,10 @@ public:
 
     void refineFace(const PaddedImage& Ib, std::vector<FaceModel>& faces, const cv::Matx33f& H, bool isDetection)
     {
+        // Tracked faces carry the landmarks and eye models from the previous frame, use them as a prior:
+        const bool doWarmStart = m_doWarmStart && !isDetection;
+        const FaceModel prior = (doWarmStart && faces.size()) ? faces[0] : FaceModel();
+
         // Find the landmarks:
         if (m_regressor)
         {
@@ -120,14 +125,14 @@ public:
             std::transform(faces.begin(), faces.end(), shapes.begin(), [](const FaceModel& face) {
                 return dsdkc::Shape(face.roi);
             });
-            findLandmarks(Ib, shapes, H, isDetection);
+            findLandmarks(Ib, shapes, H, isDetection, doWarmStart ? &faces : nullptr);
             shapesToFaces(shapes, faces);
         }
 
         if (m_eyeRegressor.size() && m_eyeRegressor[0] && m_eyeRegressor[1] && m_doEyeRefinement && faces.size())
         {
             DRISHTI_EYE::EyeModel eyeR, eyeL;
-            segmentEyes(Ib.Ib, faces[0], eyeR, eyeL);
+            segmentEyes(Ib.Ib, faces[0], eyeR, eyeL, doWarmStart ? &prior : nullptr);
             if (eyeR.eyelids.size())
             {
                 faces[0].eyeFullR = eyeR;
@@ -154,7 +159,7 @@ public:
         }
     }
 
-    void segmentEyes(const cv::Mat1b& Ib, FaceModel& face, DRISHTI_EYE::EyeModel& eyeR, DRISHTI_EYE::EyeModel& eyeL)
+    void segmentEyes(const cv::Mat1b& Ib, FaceModel& face, DRISHTI_EYE::EyeModel& eyeR, DRISHTI_EYE::EyeModel& eyeL, const FaceModel* prior = nullptr)
     {
         cv::Rect2f roiR, roiL;
         bool hasEyes = face.getEyeRegions(roiR, roiL, 0.666);
@@ -184,7 +189,6 @@ public:
             float theta = std::atan2(v.y, v.x);
             eyeR.angle = theta;
             eyeL.angle = (-theta);
-            DRISHTI_EYE::EyeModel* results[2]{ &eyeR, &eyeL };
 
             for (int i = 0; i < 2; i++)
             {
@@ -193,12 +197,39 @@ public:
                 m_eyeRegressor[i]->setIrisInits(1);
             }
 
-            drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
-                (*m_eyeRegressor[i])(crops[i], *results[i]);
-            };
+            std::vector<DRISHTI_EYE::EyeModel> results(2);
+            if (prior && prior->eyeFullR.has && prior->eyeFullL.has)
+            {
+                // Track each eye from the previous fit (mapped to the crop cs), the frame
+                // to frame motion is the similarity transform between the eye centers:
+                DRISHTI_EYE::EyeModel priors[2] = { *prior->eyeFullR - eyes[0].tl(), *prior->eyeFullL - eyes[1].tl() };
+                priors[1].flop(crops[1].cols);
+
+                const cv::Matx33f H = getSimilarityMotion(*prior, face);
+                const cv::Matx33f F(-1, 0, crops[1].cols, 0, 1, 0, 0, 0, 1); // flop (involution)
+                cv::Matx33f Hs[2];
+                for (int i = 0; i < 2; i++)
+                {
+                    const cv::Point2f tl = eyes[i].tl();
+                    Hs[i] = transformation::translate(-tl) * H * transformation::translate(tl);
+                }
+                Hs[1] = F * Hs[1] * F;
 
-            //harness({0, 2});
-            cv::parallel_for_({ 0, 2 }, harness, 2);
+                drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
+                    (*m_eyeRegressor[i])(crops[i], priors[i], Hs[i], results[i]);
+                };
+                cv::parallel_for_({ 0, 2 }, harness, 2);
+            }
+            else
+            {
+                // Each eye has its own estimator (the left eye is flipped to the right eye cs):
+                drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
+                    (*m_eyeRegressor[i])(crops[i], results[i]);
+                };
+                cv::parallel_for_({ 0, 2 }, harness, 2);
+            }
+            eyeR = results[0];
+            eyeL = results[1];
 
             eyeL.flop(crops[1].cols);
             eyeL += eyes[1].tl(); // shift features to image coordinate system
@@ -214,7 +245,7 @@ public:
         return cv::Rect(center - (diag * scale), center + (diag * scale));
     }
 
-    void findLandmarks(const PaddedImage& Ib, std::vector<dsdkc::Shape>& shapes, const cv::Matx33f& Hdr_, bool isDetection)
+    void findLandmarks(const PaddedImage& Ib, std::vector<dsdkc::Shape>& shapes, const cv::Matx33f& Hdr_, bool isDetection, const std::vector<FaceModel>* priors = nullptr)
     {
         // Scope based eye segmentation timer:
         drishti::core::ScopeTimeLogger scopeTimeLogger = [this](double elapsed) {
@@ -273,7 +304,20 @@ public:
             const float scaleInv = 1.f;
             std::vector<cv::Point2f> points;
             std::vector<bool> mask;
-            (*regressor)(crop, points, mask);
+            if (priors && (i < priors->size()) && (*priors)[i].points.has)
+            {
+                // Map the prior landmarks to the crop coordinate system:
+                std::vector<cv::Point2f> prior = *(*priors)[i].points;
+                for (auto& p : prior)
+                {
+                    p -= cv::Point2f(shapes[i].roi.tl());
+                }
+                (*regressor)(crop, prior, points, mask);
+            }
+            else
+            {
+                (*regressor)(crop, points, mask);
+            }
 
             for (const auto& p : points)
             {
@@ -393,6 +437,17 @@ public:
     void setInits(int inits)
     {
         m_inits = inits;
+        for (auto* regressor : { m_regressor.get(), m_regressor2.get() })
+        {
+            if (regressor)
+            {
+                regressor->setInits(inits);
+            }
+        }
+    }
+    void setDoWarmStart(bool flag)
+    {
+        m_doWarmStart = flag;
     }
     void setDoNMS(bool doNMS)
     {
@@ -481,6 +536,7 @@ public:
     bool m_doIrisRefinement = true;
     bool m_doEyeRefinement = true;
     bool m_doNMSGlobal = false;
+    bool m_doWarmStart = false;
     int m_inits = 1;
     float m_scaling = 1.0;
 
@@ -521,6 +577,10 @@ void FaceDetector::setInits(int inits)
 {
     m_impl->setInits(inits);
 }
+void FaceDetector::setDoWarmStart(bool flag)
+{
+    m_impl->setDoWarmStart(flag);
+}
 void FaceDetector::setDoNMS(bool doNMS)
 {
     m_impl->setDoNMS(doNMS);
@@ -104,6 +104,7 @@ public:
     void setDoIrisRefinement(bool flag);
     void setDoEyeRefinement(bool flag);
     void setInits(int inits);
+    void setDoWarmStart(bool flag); // use tracked landmarks as a regression prior
     void setDoNMS(bool doNMS);
     void setDoNMSGlobal(bool flag);
     void setDetectionTimeLogger(TimeLoggerType logger);
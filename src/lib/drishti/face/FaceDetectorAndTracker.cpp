@@ -67,6 +67,10 @@ void FaceDetectorAndTracker::operator()(const MatP& I, const PaddedImage& Ib, st
         {
             faces = { face };
             refine(Ib, faces, cv::Matx33f::eye(), false);
+            if (faces.size())
+            {
+                m_pImpl->updateFace(faces[0]); // prior for the next frame
+            }
         }
     }
 }
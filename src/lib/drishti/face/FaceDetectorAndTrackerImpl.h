@@ -80,6 +80,13 @@ public:
         return m_face;
     }
 
+    // Replace the tracked face with the refined face of the current frame (the track age is
+    // kept), so the next frame is initialized from the previous frame's landmarks and eyes:
+    virtual void updateFace(const FaceModel& face)
+    {
+        m_face = face;
+    }
+
 protected:
     virtual void initializeWithRegions(const cv::Mat1b& image, const std::vector<cv::Rect>& regions);
 
@@ -26,7 +26,6 @@ public:
 
 protected:
     virtual void initializeWithRegions(const cv::Mat1b& image, const std::vector<cv::Rect>& regions) {}
-    DRISHTI_FACE::FaceModel m_face;
 };
 
 DRISHTI_FACE_NAMESPACE_END
@@ -27,12 +27,33 @@ std::unique_ptr<ml::ObjectDetector> FaceDetectorFactory::getFaceDetector()
 
 std::unique_ptr<ml::ShapeEstimator> FaceDetectorFactory::getInnerFaceEstimator()
 {
-    return core::make_unique<ml::RegressionTreeEnsembleShapeEstimator>(sFaceRegressors[0]);
+    return shareFaceEstimator(m_innerFaceEstimator, 0);
 }
 
 std::unique_ptr<ml::ShapeEstimator> FaceDetectorFactory::getOuterFaceEstimator()
 {
-    return core::make_unique<ml::RegressionTreeEnsembleShapeEstimator>(sFaceRegressors[1]);
+    return shareFaceEstimator(m_outerFaceEstimator, 1);
+}
+
+std::unique_ptr<ml::ShapeEstimator> FaceDetectorFactory::loadFaceEstimator(int index)
+{
+    return core::make_unique<ml::RegressionTreeEnsembleShapeEstimator>(sFaceRegressors[index]);
+}
+
+std::unique_ptr<ml::ShapeEstimator> FaceDetectorFactory::shareFaceEstimator(std::shared_ptr<ml::ShapeEstimator>& prototype, int index)
+{
+    // Note: lazy initialization relies on the caller to serialize factory access
+    if (!prototype)
+    {
+        prototype = loadFaceEstimator(index);
+    }
+
+    std::unique_ptr<ml::ShapeEstimator> estimator = prototype->clone();
+    if (!estimator)
+    {
+        estimator = loadFaceEstimator(index); // variant doesn't support model sharing
+    }
+    return estimator;
 }
 
 std::unique_ptr<eye::EyeModelEstimator> FaceDetectorFactory::getEyeEstimator()
@@ -59,14 +80,9 @@ std::unique_ptr<ml::ObjectDetector> FaceDetectorFactoryStream::getFaceDetector()
     return core::make_unique<acf::Detector>(*iFaceDetector);
 }
 
-std::unique_ptr<ml::ShapeEstimator> FaceDetectorFactoryStream::getInnerFaceEstimator()
-{
-    return core::make_unique<ml::RegressionTreeEnsembleShapeEstimator>(*iFaceRegressors[0]);
-}
-
-std::unique_ptr<ml::ShapeEstimator> FaceDetectorFactoryStream::getOuterFaceEstimator()
+std::unique_ptr<ml::ShapeEstimator> FaceDetectorFactoryStream::loadFaceEstimator(int index)
 {
-    return core::make_unique<ml::RegressionTreeEnsembleShapeEstimator>(*iFaceRegressors[1]);
+    return core::make_unique<ml::RegressionTreeEnsembleShapeEstimator>(*iFaceRegressors[index]);
 }
 
 std::unique_ptr<eye::EyeModelEstimator> FaceDetectorFactoryStream::getEyeEstimator()
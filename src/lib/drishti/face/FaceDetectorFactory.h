@@ -53,6 +53,15 @@ public:
     std::vector<std::string> sFaceRegressors;
     std::string sEyeRegressor;
     std::string sFaceDetectorMean;
+
+protected:
+    // Regression models are immutable after loading and are shared by all estimators handed out
+    // by the factory (each estimator keeps its own settings and per thread scratch space):
+    std::unique_ptr<drishti::ml::ShapeEstimator> shareFaceEstimator(std::shared_ptr<drishti::ml::ShapeEstimator>& prototype, int index);
+    virtual std::unique_ptr<drishti::ml::ShapeEstimator> loadFaceEstimator(int index);
+
+    std::shared_ptr<drishti::ml::ShapeEstimator> m_innerFaceEstimator;
+    std::shared_ptr<drishti::ml::ShapeEstimator> m_outerFaceEstimator;
 };
 
 class FaceDetectorFactoryStream : public FaceDetectorFactory
@@ -73,8 +82,6 @@ public:
     }
 
     virtual std::unique_ptr<drishti::ml::ObjectDetector> getFaceDetector();
-    virtual std::unique_ptr<drishti::ml::ShapeEstimator> getInnerFaceEstimator();
-    virtual std::unique_ptr<drishti::ml::ShapeEstimator> getOuterFaceEstimator();
     virtual std::unique_ptr<drishti::eye::EyeModelEstimator> getEyeEstimator();
     virtual drishti::face::FaceModel getMeanFace();
 
@@ -82,6 +89,9 @@ public:
     std::vector<std::istream*> iFaceRegressors;
     std::istream* iEyeRegressor = nullptr;
     std::istream* iFaceDetectorMean = nullptr;
+
+protected:
+    virtual std::unique_ptr<drishti::ml::ShapeEstimator> loadFaceEstimator(int index);
 };
 
 std::ostream& operator<<(std::ostream& os, const FaceDetectorFactory& factory);
@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 
 #include "drishti/face/FaceDetectorAndTracker.h"
+#include "drishti/face/FaceDetectorAndTrackerNN.h"
 
 const char* sFaceDetector;
 const char* sFaceDetectorMean;
@@ -47,3 +48,35 @@ TEST(FaceDetectorAndTracker, Instantiation)
 
     ASSERT_EQ(true, true);
 }
+
+// Each tracked frame is initialized from the refined face of the previous frame:
+TEST(FaceDetectorAndTracker, TrackedFacePrior)
+{
+    drishti::face::TrackerNN tracker;
+    const cv::Mat1b image(64, 64, uint8_t(0));
+
+    drishti::face::FaceModel detection;
+    detection.roi = cv::Rect(8, 8, 32, 32);
+    tracker.initialize(image, detection);
+
+    for (int i = 1; i <= 3; i++)
+    {
+        drishti::face::FaceModel prior;
+        ASSERT_TRUE(tracker.update(image, prior));
+        EXPECT_EQ(*prior.roi, cv::Rect(8 + (i - 1), 8, 32, 32));
+
+        // Refinement of frame i (i.e., FaceDetector::refine()), the eyes move along:
+        drishti::face::FaceModel refined = prior;
+        refined.roi = cv::Rect(8 + i, 8, 32, 32);
+        drishti::eye::EyeModel eye;
+        eye.irisEllipse = cv::RotatedRect({ 16.f + i, 16.f }, { 4.f, 4.f }, 0.f);
+        refined.eyeFullR = eye;
+        tracker.updateFace(refined);
+
+        drishti::face::FaceModel next;
+        ASSERT_TRUE(tracker.update(image, next));
+        EXPECT_EQ(*next.roi, *refined.roi);
+        ASSERT_TRUE(next.eyeFullR.has);
+        EXPECT_EQ(next.eyeFullR->irisEllipse.center, eye.irisEllipse.center);
+    }
+}
@@ -0,0 +1,252 @@
+/*!
+  @file   ConicBatch.cpp
+  @author David Hirvonen
+  @brief  Implementation of batched (structure of arrays) conic fitting and evaluation kernels.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/geometry/ConicBatch.h"
+#include "drishti/geometry/fitEllipse.h"
+#include "drishti/core/Parallel.h"
+
+// clang-format off
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define DO_AVX2 1
+#endif
+// clang-format on
+
+// clang-format off
+#if defined(__aarch64__) || defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define DO_ARM_NEON 1
+#endif
+// clang-format on
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+DRISHTI_GEOMETRY_BEGIN
+
+// ########## PointSets ##########
+
+void PointSets::add(const std::vector<cv::Point2d>& points)
+{
+    for (const auto& p : points)
+    {
+        x.push_back(p.x);
+        y.push_back(p.y);
+    }
+    offsets.push_back(static_cast<int>(x.size()));
+}
+
+void PointSets::clear()
+{
+    x.clear();
+    y.clear();
+    offsets = { 0 };
+}
+
+// ########## EllipseArray ##########
+
+EllipseArray::EllipseArray(const std::vector<cv::RotatedRect>& ellipses)
+{
+    resize(static_cast<int>(ellipses.size()));
+    for (int i = 0; i < ellipses.size(); i++)
+    {
+        set(i, ellipses[i]);
+    }
+}
+
+void EllipseArray::resize(int n)
+{
+    cx.resize(n);
+    cy.resize(n);
+    width.resize(n);
+    height.resize(n);
+    angle.resize(n);
+}
+
+void EllipseArray::set(int i, const cv::RotatedRect& ellipse)
+{
+    cx[i] = ellipse.center.x;
+    cy[i] = ellipse.center.y;
+    width[i] = ellipse.size.width;
+    height[i] = ellipse.size.height;
+    angle[i] = ellipse.angle;
+}
+
+cv::RotatedRect EllipseArray::operator[](int i) const
+{
+    return cv::RotatedRect({ cx[i], cy[i] }, { width[i], height[i] }, angle[i]);
+}
+
+// ########## ConicArray ##########
+
+void ConicArray::resize(int n)
+{
+    A.resize(n);
+    B.resize(n);
+    C.resize(n);
+    D.resize(n);
+    E.resize(n);
+    F.resize(n);
+}
+
+// ########## fitting ##########
+
+#if !DRISHTI_BUILD_MIN_SIZE
+// Same normalization and scatter matrix as fitEllipse(), with S(j,k) = sum(D_j * D_k)
+// for the design row D = [u^2, u*v, v^2, u, v, 1] built from the moments sum(u^a * v^b):
+static cv::RotatedRect fitEllipse(const double* x, const double* y, int n)
+{
+    if (n < 5)
+    {
+        return cv::RotatedRect();
+    }
+
+    cv::Point2d mean(0.0, 0.0), lower(x[0], y[0]), upper(x[0], y[0]);
+    for (int i = 0; i < n; i++)
+    {
+        mean.x += x[i];
+        mean.y += y[i];
+        lower = { std::min(lower.x, x[i]), std::min(lower.y, y[i]) };
+        upper = { std::max(upper.x, x[i]), std::max(upper.y, y[i]) };
+    }
+    mean *= (1.0 / n);
+
+    const cv::Point2d scale((upper.x - lower.x) / 2.0, (upper.y - lower.y) / 2.0);
+    if ((scale.x <= 0.0) || (scale.y <= 0.0))
+    {
+        return cv::RotatedRect();
+    }
+
+    double m[5][5] = {}; // m[a][b] = sum(u^a * v^b), a + b <= 4
+    for (int i = 0; i < n; i++)
+    {
+        const double u = (x[i] - mean.x) / scale.x;
+        const double v = (y[i] - mean.y) / scale.y;
+        const double u2 = u * u, v2 = v * v;
+        const double us[5] = { 1.0, u, u2, u2 * u, u2 * u2 };
+        const double vs[5] = { 1.0, v, v2, v2 * v, v2 * v2 };
+        for (int a = 0; a <= 4; a++)
+        {
+            for (int b = 0; b <= (4 - a); b++)
+            {
+                m[a][b] += us[a] * vs[b];
+            }
+        }
+    }
+
+    static const int powers[6][2] = { { 2, 0 }, { 1, 1 }, { 0, 2 }, { 1, 0 }, { 0, 1 }, { 0, 0 } };
+    cv::Matx66d S;
+    for (int j = 0; j < 6; j++)
+    {
+        for (int k = 0; k < 6; k++)
+        {
+            S(j, k) = m[powers[j][0] + powers[k][0]][powers[j][1] + powers[k][1]];
+        }
+    }
+
+    return fitEllipse(S, mean, scale);
+}
+
+void fitEllipses(const PointSets& sets, EllipseArray& ellipses)
+{
+    ellipses.resize(sets.size());
+    core::ParallelHomogeneousLambda harness = [&](int i) {
+        const int begin = sets.offsets[i];
+        ellipses.set(i, fitEllipse(sets.x.data() + begin, sets.y.data() + begin, sets.offsets[i + 1] - begin));
+    };
+    cv::parallel_for_({ 0, sets.size() }, harness);
+}
+#endif // !DRISHTI_BUILD_MIN_SIZE
+
+// ########## conversions ##########
+
+void conicsCen2Par(const EllipseArray& cen, ConicArray& par)
+{
+    par.resize(cen.size());
+    for (int i = 0; i < cen.size(); i++)
+    {
+        const ConicSection_<double> conic(cen[i]);
+        par.A[i] = conic.A;
+        par.B[i] = conic.B;
+        par.C[i] = conic.C;
+        par.D[i] = conic.D;
+        par.E[i] = conic.E;
+        par.F[i] = conic.F;
+    }
+}
+
+void conicsPar2Cen(const ConicArray& par, EllipseArray& cen)
+{
+    cen.resize(par.size());
+    for (int i = 0; i < par.size(); i++)
+    {
+        cen.set(i, conicPar2Cen({ par.A[i], par.B[i], par.C[i], par.D[i], par.E[i], par.F[i] }));
+    }
+}
+
+// ########## evaluation ##########
+
+// Q(o + t * d) = a * t^2 + b * t + c, where c = Q(o):
+int intersectConicRays(const ConicSection_<float>& C, const float* ox, const float* oy, const float* dx, const float* dy, int n, float* t0, float* t1)
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    int hits = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const float x = ox[i], y = oy[i], u = dx[i], v = dy[i];
+        const float a = (C.A * u * u) + (C.B * u * v) + (C.C * v * v);
+        const float b = (2.f * C.A * x * u) + (C.B * ((x * v) + (y * u))) + (2.f * C.C * y * v) + (C.D * u) + (C.E * v);
+        const float c = (((C.A * x) + (C.B * y) + C.D) * x) + (((C.C * y) + C.E) * y) + C.F;
+        const float discriminant = (b * b) - (4.f * a * c);
+        const bool hit = (a != 0.f) && (discriminant >= 0.f);
+        const float root = std::sqrt(std::max(discriminant, 0.f));
+        const float s = 0.5f / a;
+        const float r0 = (-b - root) * s, r1 = (-b + root) * s;
+        t0[i] = hit ? std::min(r0, r1) : nan;
+        t1[i] = hit ? std::max(r0, r1) : nan;
+        hits += int(hit);
+    }
+    return hits;
+}
+
+// Q(x,y) = ((A * x + B * y + D) * x) + ((C * y + E) * y) + F
+void algebraicDistance(const ConicSection_<float>& C, const float* x, const float* y, int n, float* distance)
+{
+    int i = 0;
+#if DO_AVX2
+    const __m256 A = _mm256_set1_ps(C.A), B = _mm256_set1_ps(C.B), CC = _mm256_set1_ps(C.C);
+    const __m256 D = _mm256_set1_ps(C.D), E = _mm256_set1_ps(C.E), F = _mm256_set1_ps(C.F);
+    for (; i <= n - 8; i += 8)
+    {
+        const __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i);
+        const __m256 qx = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(A, px), _mm256_mul_ps(B, py)), D), px);
+        const __m256 qy = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(CC, py), E), py);
+        _mm256_storeu_ps(distance + i, _mm256_add_ps(_mm256_add_ps(qx, qy), F));
+    }
+#elif DO_ARM_NEON
+    const float32x4_t A = vdupq_n_f32(C.A), B = vdupq_n_f32(C.B), CC = vdupq_n_f32(C.C);
+    const float32x4_t D = vdupq_n_f32(C.D), E = vdupq_n_f32(C.E), F = vdupq_n_f32(C.F);
+    for (; i <= n - 4; i += 4)
+    {
+        const float32x4_t px = vld1q_f32(x + i), py = vld1q_f32(y + i);
+        const float32x4_t qx = vmulq_f32(vaddq_f32(vaddq_f32(vmulq_f32(A, px), vmulq_f32(B, py)), D), px);
+        const float32x4_t qy = vmulq_f32(vaddq_f32(vmulq_f32(CC, py), E), py);
+        vst1q_f32(distance + i, vaddq_f32(vaddq_f32(qx, qy), F));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        distance[i] = (((C.A * x[i]) + (C.B * y[i]) + C.D) * x[i]) + (((C.C * y[i]) + C.E) * y[i]) + C.F;
+    }
+}
+
+DRISHTI_GEOMETRY_END
@@ -0,0 +1,101 @@
+/*!
+  @file   ConicBatch.h
+  @author David Hirvonen
+  @brief  Declaration of batched (structure of arrays) conic fitting and evaluation kernels.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_geometry_ConicBatch_h__
+#define __drishti_geometry_ConicBatch_h__ 1
+
+#include "drishti/geometry/drishti_geometry.h"
+#include "drishti/geometry/ConicSection.h"
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+DRISHTI_GEOMETRY_BEGIN
+
+// Point sets in one structure of arrays, set i is [offsets[i], offsets[i + 1]):
+struct PointSets
+{
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<int> offsets = { 0 };
+
+    void add(const std::vector<cv::Point2d>& points);
+    void clear();
+
+    int size() const
+    {
+        return static_cast<int>(offsets.size()) - 1;
+    }
+};
+
+// Ellipses in the cv::RotatedRect convention (angle in degrees):
+struct EllipseArray
+{
+    EllipseArray() {}
+    EllipseArray(const std::vector<cv::RotatedRect>& ellipses);
+
+    std::vector<float> cx;
+    std::vector<float> cy;
+    std::vector<float> width;
+    std::vector<float> height;
+    std::vector<float> angle;
+
+    void resize(int n);
+    void set(int i, const cv::RotatedRect& ellipse);
+    cv::RotatedRect operator[](int i) const;
+
+    int size() const
+    {
+        return static_cast<int>(cx.size());
+    }
+};
+
+// Conic coefficients in the ConicSection_ convention: A*x^2 + B*x*y + C*y^2 + D*x + E*y + F = 0
+struct ConicArray
+{
+    std::vector<double> A;
+    std::vector<double> B;
+    std::vector<double> C;
+    std::vector<double> D;
+    std::vector<double> E;
+    std::vector<double> F;
+
+    void resize(int n);
+
+    int size() const
+    {
+        return static_cast<int>(A.size());
+    }
+};
+
+#if !DRISHTI_BUILD_MIN_SIZE
+// Direct least squares fit of each point set (sets are fit in parallel).  The
+// scatter matrix of a set is accumulated from its normalized moments in one
+// pass, so no per set design matrix is allocated.  Sets with fewer than 5
+// points (or no spread) result in an empty ellipse.
+void fitEllipses(const PointSets& sets, EllipseArray& ellipses);
+#endif // !DRISHTI_BUILD_MIN_SIZE
+
+// Parameter conversions in bulk, conicsPar2Cen() is conicPar2Cen() per conic,
+// and conicsCen2Par() is its inverse (ConicSection_ coefficients):
+void conicsCen2Par(const EllipseArray& cen, ConicArray& par);
+void conicsPar2Cen(const ConicArray& par, EllipseArray& cen);
+
+// Intersections of n rays o + t * d with one conic: t0 <= t1 for each ray,
+// NaN for rays that miss the conic.  Returns the number of rays that hit.
+int intersectConicRays(const ConicSection_<float>& C, const float* ox, const float* oy, const float* dx, const float* dy, int n, float* t0, float* t1);
+
+// Algebraic distance of n points (AVX2 or NEON where available):
+void algebraicDistance(const ConicSection_<float>& C, const float* x, const float* y, int n, float* distance);
+
+DRISHTI_GEOMETRY_END
+
+#endif // __drishti_geometry_ConicBatch_h__
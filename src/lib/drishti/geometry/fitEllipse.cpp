@@ -139,13 +139,11 @@ cv::RotatedRect fitEllipse(const std::vector<cv::Point2d>& pts)
         }
     }
 
-    double mx = mu[0];
-    double my = mu[1];
-    double sx = (max.x - min.x) / 2.0;
-    double sy = (max.y - min.y) / 2.0;
+    const cv::Point2d mean(mu[0], mu[1]);
+    const cv::Point2d scale((max.x - min.x) / 2.0, (max.y - min.y) / 2.0);
     for (int i = 0; i < pts.size(); i++)
     {
-        points[i] = cv::Point2d((pts[i].x - mu[0]) / sx, (pts[i].y - mu[1]) / sy);
+        points[i] = cv::Point2d((pts[i].x - mean.x) / scale.x, (pts[i].y - mean.y) / scale.y);
     }
 
     // Build design matrix
@@ -164,6 +162,16 @@ cv::RotatedRect fitEllipse(const std::vector<cv::Point2d>& pts)
     // Build scatter matrix, and design matrix:
     cv::Mat1d S = D.t() * D;
 
+    return fitEllipse(cv::Matx66d(S), mean, scale);
+}
+
+cv::RotatedRect fitEllipse(const cv::Matx66d& S, const cv::Point2d& mean, const cv::Point2d& scale)
+{
+    const double mx = mean.x;
+    const double my = mean.y;
+    const double sx = scale.x;
+    const double sy = scale.y;
+
     // std::cout << S << std::endl;
 
     cv::Matx33d C = cv::Matx33d::zeros();
@@ -171,10 +179,10 @@ cv::RotatedRect fitEllipse(const std::vector<cv::Point2d>& pts)
     C(1, 1) = 1.0;
 
     // Break into blocks
-    cv::Matx33d tmpA = S(cv::Range(0, 3), cv::Range(0, 3)); // tmpA = S(1:3,1:3);
-    cv::Matx33d tmpB = S(cv::Range(0, 3), cv::Range(3, 6)); // tmpB = S(1:3,4:6);
-    cv::Matx33d tmpC = S(cv::Range(3, 6), cv::Range(3, 6)); // tmpC = S(4:6,4:6);
-    cv::Matx33d tmpD = C;                                   // tmpD = C(1:3,1:3);
+    cv::Matx33d tmpA = S.get_minor<3, 3>(0, 0); // tmpA = S(1:3,1:3);
+    cv::Matx33d tmpB = S.get_minor<3, 3>(0, 3); // tmpB = S(1:3,4:6);
+    cv::Matx33d tmpC = S.get_minor<3, 3>(3, 3); // tmpC = S(4:6,4:6);
+    cv::Matx33d tmpD = C;                       // tmpD = C(1:3,1:3);
     cv::Matx33d tmpE = tmpC.inv() * tmpB.t();
     cv::Matx33d final = tmpD.inv() * (tmpA - tmpB * tmpE);
 
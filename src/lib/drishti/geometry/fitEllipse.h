@@ -37,6 +37,9 @@ cv::Vec6d conicCen2Par(const cv::RotatedRect& cen);
 #if !DRISHTI_BUILD_MIN_SIZE
 cv::RotatedRect fitEllipse(const std::vector<cv::Point2d>& pts);
 cv::RotatedRect fitEllipse(const std::vector<cv::Point2d>& points, const cv::Point2d& center);
+
+// Direct least squares solution from the 6x6 scatter matrix of points normalized as (p - mean) / scale:
+cv::RotatedRect fitEllipse(const cv::Matx66d& scatter, const cv::Point2d& mean, const cv::Point2d& scale);
 #endif // !DRISHTI_BUILD_MIN_SIZE
 
 DRISHTI_GEOMETRY_END
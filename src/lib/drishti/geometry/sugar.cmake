@@ -12,6 +12,7 @@ endif()
 include(sugar_files)
 
 sugar_files(DRISHTI_GEOMETRY_SRCS
+  ConicBatch.cpp
   DynamicObject.cpp
   Ellipse.cpp
   EllipseSerializer.cpp
@@ -26,6 +27,7 @@ sugar_files(DRISHTI_GEOMETRY_SRCS
   )
 
 sugar_files(DRISHTI_GEOMETRY_HDRS_PUBLIC
+  ConicBatch.h
   ConicSection.h
   Cylinder.h
   DynamicObject.h  
@@ -12,6 +12,10 @@
 
 #include "drishti/geometry/Ellipse.h"
 #include "drishti/geometry/intersectConicLine.h"
+#include "drishti/geometry/ConicBatch.h"
+#include "drishti/geometry/fitEllipse.h"
+
+#include <cmath>
 
 int gauze_main(int argc, char** argv)
 {
@@ -41,3 +45,93 @@ TEST(Ellipse, EllipseLineIntersection2)
 
     // assertions on order, etc
 }
+
+static std::vector<cv::Point2d> sampleEllipse(const cv::RotatedRect& e, int n)
+{
+    std::vector<cv::Point2d> points;
+    const double theta = e.angle * M_PI / 180.0;
+    for (int i = 0; i < n; i++)
+    {
+        const double t = 2.0 * M_PI * i / n;
+        const double x = 0.5 * e.size.width * std::cos(t), y = 0.5 * e.size.height * std::sin(t);
+        points.emplace_back(e.center.x + x * std::cos(theta) - y * std::sin(theta), e.center.y + x * std::sin(theta) + y * std::cos(theta));
+    }
+    return points;
+}
+
+// The batch fit is the scalar fit with a moment based scatter matrix:
+TEST(ConicBatch, FitEllipses)
+{
+    drishti::geometry::PointSets sets;
+    std::vector<cv::RotatedRect> ellipses;
+    for (int i = 0; i < 16; i++)
+    {
+        ellipses.emplace_back(cv::Point2f(100.f + i, 80.f - i), cv::Size2f(60.f + 2.f * i, 40.f + i), 10.f * i);
+        sets.add(sampleEllipse(ellipses.back(), 32));
+    }
+    sets.add({ { 0.0, 0.0 }, { 1.0, 1.0 } }); // too few points
+
+    drishti::geometry::EllipseArray fits;
+    drishti::geometry::fitEllipses(sets, fits);
+    ASSERT_EQ(fits.size(), sets.size());
+
+    for (int i = 0; i < ellipses.size(); i++)
+    {
+        const cv::RotatedRect expected = drishti::geometry::fitEllipse(sampleEllipse(ellipses[i], 32));
+        const cv::RotatedRect actual = fits[i];
+        EXPECT_NEAR(actual.center.x, expected.center.x, 1e-3f);
+        EXPECT_NEAR(actual.center.y, expected.center.y, 1e-3f);
+        EXPECT_NEAR(actual.size.width, expected.size.width, 1e-3f);
+        EXPECT_NEAR(actual.size.height, expected.size.height, 1e-3f);
+        EXPECT_NEAR(actual.angle, expected.angle, 1e-3f);
+    }
+    EXPECT_EQ(fits[ellipses.size()].size.area(), 0.f);
+}
+
+TEST(ConicBatch, Conversions)
+{
+    const std::vector<cv::RotatedRect> ellipses{ { { 10.f, 20.f }, { 8.f, 4.f }, 30.f }, { { -5.f, 3.f }, { 6.f, 2.f }, -60.f } };
+
+    drishti::geometry::ConicArray par;
+    drishti::geometry::EllipseArray cen;
+    drishti::geometry::conicsCen2Par(drishti::geometry::EllipseArray(ellipses), par);
+    drishti::geometry::conicsPar2Cen(par, cen);
+    ASSERT_EQ(cen.size(), ellipses.size());
+
+    for (int i = 0; i < ellipses.size(); i++)
+    {
+        // Same conic, up to the axis order and angle period of the parameterization:
+        const auto C = drishti::geometry::ConicSection_<double>(ellipses[i]).getMatrix();
+        const auto D = drishti::geometry::ConicSection_<double>(cen[i]).getMatrix();
+        EXPECT_LT(cv::norm(C - D), 1e-3);
+    }
+}
+
+TEST(ConicBatch, RaysAndDistances)
+{
+    drishti::geometry::ConicSection_<float> C(cv::RotatedRect({ 0.f, 0.f }, { 2.f, 1.f }, 0.f));
+
+    // Rays from the origin along x and y, and a ray that misses:
+    const float ox[] = { 0.f, 0.f, 0.f }, oy[] = { 0.f, 0.f, 2.f };
+    const float dx[] = { 1.f, 0.f, 1.f }, dy[] = { 0.f, 1.f, 0.f };
+    float t0[3], t1[3];
+    EXPECT_EQ(drishti::geometry::intersectConicRays(C, ox, oy, dx, dy, 3, t0, t1), 2);
+    EXPECT_NEAR(t0[0], -1.f, 1e-6f);
+    EXPECT_NEAR(t1[0], +1.f, 1e-6f);
+    EXPECT_NEAR(t0[1], -0.5f, 1e-6f);
+    EXPECT_NEAR(t1[1], +0.5f, 1e-6f);
+    EXPECT_TRUE(std::isnan(t0[2]) && std::isnan(t1[2]));
+
+    // SIMD body and scalar tail both match the scalar evaluation:
+    std::vector<float> x(37), y(37), d(37);
+    for (int i = 0; i < x.size(); i++)
+    {
+        x[i] = std::cos(float(i)) * 2.f;
+        y[i] = std::sin(float(i) * 0.5f);
+    }
+    drishti::geometry::algebraicDistance(C, x.data(), y.data(), int(x.size()), d.data());
+    for (int i = 0; i < x.size(); i++)
+    {
+        EXPECT_NEAR(d[i], C.algebraicDistance({ x[i], y[i] }), 1e-5f);
+    }
+}
@@ -10,6 +10,7 @@
 
 #include "drishti/hci/EyeBlob.h"
 #include "drishti/geometry/motion.h"
+#include "drishti/geometry/ConicBatch.h"
 
 DRISHTI_HCI_NAMESPACE_BEGIN
 
@@ -34,21 +35,29 @@ void EyeBlobJob::run()
 EyeBlobJob::FeaturePoints
 EyeBlobJob::getValidEyePoints(const FeaturePoints& points, const drishti::eye::EyeWarp& eyeWarp, const cv::Size& size)
 {
-    drishti::geometry::ConicSection_<float> C(eyeWarp.eye.irisEllipse);
+    const drishti::geometry::ConicSection_<float> C(eyeWarp.eye.irisEllipse);
 
-    FeaturePoints pointsOnIris;
+    // Warp all points to the eye, then test them against the iris in one batch:
+    const int n = static_cast<int>(points.size());
+    std::vector<float> x(n), y(n), d(n);
     const cv::Matx33f H = eyeWarp.H.inv() * transformation::normalize(size);
-    for (const auto& f : points)
+    for (int i = 0; i < n; i++)
     {
-        const auto& p = f.point;
+        const auto& p = points[i].point;
         cv::Point3f q3 = H * cv::Point3f(p.x, p.y, 1.f);
+        x[i] = q3.x / q3.z;
+        y[i] = q3.y / q3.z;
+    }
+    drishti::geometry::algebraicDistance(C, x.data(), y.data(), n, d.data());
 
-        FeaturePoint q;
-        q.point = { q3.x / q3.z, q3.y / q3.z };
-        q.radius = f.radius;
-
-        if (C.algebraicDistance(q.point) < 0.f)
+    FeaturePoints pointsOnIris;
+    for (int i = 0; i < n; i++)
+    {
+        if (d[i] < 0.f)
         {
+            FeaturePoint q;
+            q.point = { x[i], y[i] };
+            q.radius = points[i].radius;
             pointsOnIris.emplace_back(q);
         }
     }
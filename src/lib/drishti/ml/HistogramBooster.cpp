@@ -0,0 +1,438 @@
+/*!
+  @file   HistogramBooster.cpp
+  @author David Hirvonen
+  @brief  Internal implementation of a histogram based multi-output gradient boosted tree trainer.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/ml/HistogramBooster.h"
+#include "drishti/core/Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+static const uint8_t kMissing = 255;
+
+// Features quantized to histogram bins, with x < cuts[f][b] <=> bin <= b:
+struct QuantizedFeatures
+{
+    QuantizedFeatures(const cv::Mat1f& features, int maxBins)
+        : cuts(features.cols)
+        , bins(features.cols, features.rows)
+    {
+        core::ParallelHomogeneousLambda harness = [&](int f) {
+            std::vector<float> values;
+            values.reserve(features.rows);
+            for (int i = 0; i < features.rows; i++)
+            {
+                const float x = features(i, f);
+                if (!std::isnan(x))
+                {
+                    values.push_back(x);
+                }
+            }
+            std::sort(values.begin(), values.end());
+
+            // Split candidates are midpoints between adjacent distinct values (at sample quantiles for large sets):
+            auto& cut = cuts[f];
+            const int n = static_cast<int>(values.size());
+            int distinct = (n > 0) ? 1 : 0;
+            for (int i = 1; i < n; i++)
+            {
+                distinct += int(values[i] != values[i - 1]);
+            }
+            if (distinct <= maxBins)
+            {
+                for (int i = 1; i < n; i++)
+                {
+                    if (values[i] != values[i - 1])
+                    {
+                        cut.push_back(0.5f * (values[i - 1] + values[i]));
+                    }
+                }
+            }
+            else
+            {
+                for (int b = 1; b < maxBins; b++)
+                {
+                    const int i = (b * n) / maxBins;
+                    const auto next = std::upper_bound(values.begin() + i, values.end(), values[i - 1]);
+                    if (next != values.end())
+                    {
+                        const float value = 0.5f * (values[i - 1] + *next);
+                        if (cut.empty() || (value > cut.back()))
+                        {
+                            cut.push_back(value);
+                        }
+                    }
+                }
+            }
+
+            uint8_t* pBins = bins.ptr<uint8_t>(f);
+            for (int i = 0; i < features.rows; i++)
+            {
+                const float x = features(i, f);
+                pBins[i] = std::isnan(x) ? kMissing : static_cast<uint8_t>(std::upper_bound(cut.begin(), cut.end(), x) - cut.begin());
+            }
+        };
+        cv::parallel_for_({ 0, features.cols }, harness);
+    }
+
+    std::vector<std::vector<float>> cuts;
+    cv::Mat1b bins; // dimensions x samples (feature major)
+};
+
+// Tree with one leaf value per output:
+struct GrownTree
+{
+    struct Node
+    {
+        int feature = -1; // split feature, or -1 for a leaf
+        int bin = 0;      // samples with bin <= this go left
+        float threshold = 0.f;
+        bool defaultLeft = true;
+        int left = -1, right = -1;
+        std::vector<float> leaf; // leaf value for each output
+    };
+
+    // xgboost RegTree style view of one output for TreeEnsemble::addTree():
+    struct Output
+    {
+        struct NodeView
+        {
+            const Node& node;
+            int k;
+
+            bool is_leaf() const { return node.feature < 0; }
+            float leaf_value() const { return node.leaf[k]; }
+            int split_index() const { return node.feature; }
+            float split_cond() const { return node.threshold; }
+            bool default_left() const { return node.defaultLeft; }
+            int cleft() const { return node.left; }
+            int cright() const { return node.right; }
+        };
+
+        NodeView operator[](int i) const
+        {
+            return { tree.nodes[i], k };
+        }
+
+        const GrownTree& tree;
+        int k;
+    };
+
+    std::vector<Node> nodes;
+};
+
+struct Split
+{
+    double gain = 0.0;
+    int feature = -1;
+    int bin = 0;
+    bool defaultLeft = false;
+};
+
+// Grows the tree of a single boosting round:
+class TreeGrower
+{
+public:
+    TreeGrower(const HistogramBooster::Recipe& recipe, const QuantizedFeatures& data, const std::vector<int>& features, const std::vector<float>& gradients, int outputs)
+        : m_recipe(recipe)
+        , m_data(data)
+        , m_features(features)
+        , m_gradients(gradients)
+        , m_outputs(outputs)
+        , m_missing(std::min(std::max(recipe.bins, 2), 255))
+        , m_channels(outputs + 1)
+        , m_stride((m_missing + 1) * m_channels)
+    {
+    }
+
+    void grow(const std::vector<int>& rows, GrownTree& tree) const
+    {
+        struct Item
+        {
+            int node;
+            std::vector<int> rows;
+            std::vector<double> hist;
+        };
+
+        tree.nodes.assign(1, {});
+        std::vector<Item> level(1);
+        level[0].node = 0;
+        level[0].rows = rows;
+        build(level[0].rows, level[0].hist);
+
+        for (int depth = 0; !level.empty(); depth++)
+        {
+            std::vector<Item> next;
+            for (auto& item : level)
+            {
+                const std::vector<double> totals = sum(item.hist);
+                const Split split = (depth < m_recipe.maxDepth) ? find(item.hist, totals) : Split();
+                if (split.feature < 0)
+                {
+                    setLeaf(tree.nodes[item.node], totals);
+                    continue;
+                }
+
+                Item left, right;
+                const uint8_t* pBins = m_data.bins.ptr<uint8_t>(split.feature);
+                for (const auto& i : item.rows)
+                {
+                    const uint8_t b = pBins[i];
+                    const bool goLeft = (b == kMissing) ? split.defaultLeft : (b <= split.bin);
+                    (goLeft ? left : right).rows.push_back(i);
+                }
+
+                // Build the smaller child and subtract it from the parent for the sibling:
+                Item& small = (left.rows.size() < right.rows.size()) ? left : right;
+                Item& large = (&small == &left) ? right : left;
+                build(small.rows, small.hist);
+                large.hist.swap(item.hist);
+                std::transform(large.hist.begin(), large.hist.end(), small.hist.begin(), large.hist.begin(), std::minus<double>());
+
+                left.node = static_cast<int>(tree.nodes.size());
+                right.node = left.node + 1;
+                tree.nodes.resize(tree.nodes.size() + 2);
+
+                auto& node = tree.nodes[item.node];
+                node.feature = split.feature;
+                node.bin = split.bin;
+                node.threshold = m_data.cuts[split.feature][split.bin];
+                node.defaultLeft = split.defaultLeft;
+                node.left = left.node;
+                node.right = right.node;
+
+                next.push_back(std::move(left));
+                next.push_back(std::move(right));
+            }
+            level.swap(next);
+        }
+    }
+
+protected:
+    // Gradient histograms: feature x bin (last bin is for missing values) x { count, gradients }
+    void build(const std::vector<int>& rows, std::vector<double>& hist) const
+    {
+        hist.assign(m_features.size() * m_stride, 0.0);
+        core::ParallelHomogeneousLambda harness = [&](int j) {
+            const uint8_t* pBins = m_data.bins.ptr<uint8_t>(m_features[j]);
+            double* h = &hist[j * m_stride];
+            for (const auto& i : rows)
+            {
+                double* e = h + (std::min(int(pBins[i]), m_missing) * m_channels);
+                const float* g = &m_gradients[i * m_outputs];
+                e[0] += 1.0;
+                for (int k = 0; k < m_outputs; k++)
+                {
+                    e[k + 1] += g[k];
+                }
+            }
+        };
+        cv::parallel_for_({ 0, int(m_features.size()) }, harness);
+    }
+
+    // Node totals { count, gradients } from the bins of the first feature:
+    std::vector<double> sum(const std::vector<double>& hist) const
+    {
+        std::vector<double> totals(m_channels, 0.0);
+        for (int b = 0; b <= m_missing; b++)
+        {
+            for (int c = 0; c < m_channels; c++)
+            {
+                totals[c] += hist[(b * m_channels) + c];
+            }
+        }
+        return totals;
+    }
+
+    double score(const double* s) const
+    {
+        double value = 0.0;
+        for (int k = 1; k < m_channels; k++)
+        {
+            value += (s[k] * s[k]);
+        }
+        return value / (s[0] + m_recipe.lambda);
+    }
+
+    // Best split over all sampled features (evaluated in parallel), with the gain summed over outputs:
+    Split find(const std::vector<double>& hist, const std::vector<double>& totals) const
+    {
+        const double parent = score(totals.data());
+        const double minimum = std::max(m_recipe.minSamplesPerLeaf, 1);
+
+        std::vector<Split> splits(m_features.size());
+        core::ParallelHomogeneousLambda harness = [&](int j) {
+            const int f = m_features[j];
+            const int bins = static_cast<int>(m_data.cuts[f].size()) + 1;
+            const double* h = &hist[j * m_stride];
+            const double* missing = h + (m_missing * m_channels);
+
+            std::vector<double> left(m_channels, 0.0), right(m_channels), l(m_channels);
+            for (int b = 0; b < (bins - 1); b++)
+            {
+                for (int c = 0; c < m_channels; c++)
+                {
+                    left[c] += h[(b * m_channels) + c];
+                }
+
+                for (int defaultLeft = 0; defaultLeft < ((missing[0] > 0.0) ? 2 : 1); defaultLeft++)
+                {
+                    for (int c = 0; c < m_channels; c++)
+                    {
+                        l[c] = left[c] + (defaultLeft ? missing[c] : 0.0);
+                        right[c] = totals[c] - l[c];
+                    }
+                    if ((l[0] < minimum) || (right[0] < minimum))
+                    {
+                        continue;
+                    }
+
+                    const double gain = score(l.data()) + score(right.data()) - parent;
+                    if (gain > splits[j].gain)
+                    {
+                        splits[j] = { gain, f, b, (defaultLeft != 0) };
+                    }
+                }
+            }
+        };
+        cv::parallel_for_({ 0, int(m_features.size()) }, harness);
+
+        Split best;
+        for (const auto& split : splits)
+        {
+            if (split.gain > best.gain)
+            {
+                best = split;
+            }
+        }
+        return best;
+    }
+
+    void setLeaf(GrownTree::Node& node, const std::vector<double>& totals) const
+    {
+        node.leaf.resize(m_outputs);
+        for (int k = 0; k < m_outputs; k++)
+        {
+            node.leaf[k] = static_cast<float>(-m_recipe.learningRate * totals[k + 1] / (totals[0] + m_recipe.lambda));
+        }
+    }
+
+    const HistogramBooster::Recipe& m_recipe;
+    const QuantizedFeatures& m_data;
+    const std::vector<int>& m_features;
+    const std::vector<float>& m_gradients;
+    int m_outputs;
+    int m_missing; // bin index for missing values (== number of bins)
+    int m_channels;
+    int m_stride;
+};
+
+HistogramBooster::HistogramBooster() {}
+
+HistogramBooster::HistogramBooster(const Recipe& recipe)
+    : m_recipe(recipe)
+{
+}
+
+void HistogramBooster::train(const cv::Mat1f& features, const cv::Mat1f& targets, std::vector<TreeEnsemble>& ensembles) const
+{
+    cv::Mat1f predictions;
+    train(features, targets, ensembles, predictions);
+}
+
+void HistogramBooster::train(const cv::Mat1f& features, const cv::Mat1f& targets, std::vector<TreeEnsemble>& ensembles, cv::Mat1f& predictions) const
+{
+    CV_Assert(!features.empty() && (features.rows == targets.rows) && (targets.cols > 0));
+
+    const int N = features.rows;
+    const int D = features.cols;
+    const int K = targets.cols;
+
+    const QuantizedFeatures data(features, std::min(std::max(m_recipe.bins, 2), 255));
+
+    // Start from the mean response:
+    cv::Mat1f base;
+    cv::reduce(targets, base, 0, cv::REDUCE_AVG);
+    ensembles.assign(K, {});
+    for (int k = 0; k < K; k++)
+    {
+        ensembles[k].setBaseScore(base(k));
+    }
+    cv::repeat(base, N, 1, predictions);
+
+    cv::RNG rng(m_recipe.seed);
+    std::vector<float> gradients(N * K);
+    std::vector<int> all(D), rows;
+    std::iota(all.begin(), all.end(), 0);
+    const int sampledFeatures = std::min(std::max(int(std::round(m_recipe.featureSubsample * D)), 1), D);
+
+    GrownTree tree;
+    for (int t = 0; t < m_recipe.numberOfTrees; t++)
+    {
+        // Squared loss: gradient is the residual, hessian is 1
+        for (int i = 0; i < N; i++)
+        {
+            for (int k = 0; k < K; k++)
+            {
+                gradients[(i * K) + k] = predictions(i, k) - targets(i, k);
+            }
+        }
+
+        rows.clear();
+        for (int i = 0; i < N; i++)
+        {
+            if (rng.uniform(0.0, 1.0) < m_recipe.dataSubsample)
+            {
+                rows.push_back(i);
+            }
+        }
+        if (rows.empty())
+        {
+            rows.resize(N);
+            std::iota(rows.begin(), rows.end(), 0);
+        }
+
+        // Partial Fisher-Yates shuffle for the feature subset:
+        for (int j = 0; j < sampledFeatures; j++)
+        {
+            std::swap(all[j], all[j + rng.uniform(0, D - j)]);
+        }
+        std::vector<int> subset(all.begin(), all.begin() + sampledFeatures);
+        std::sort(subset.begin(), subset.end());
+
+        TreeGrower(m_recipe, data, subset, gradients, K).grow(rows, tree);
+
+        for (int k = 0; k < K; k++)
+        {
+            ensembles[k].addTree(GrownTree::Output{ tree, k });
+        }
+
+        // Update the predictions of all samples (including those not sampled this round):
+        core::ParallelHomogeneousLambda harness = [&](int i) {
+            const GrownTree::Node* node = &tree.nodes[0];
+            while (node->feature >= 0)
+            {
+                const uint8_t b = data.bins(node->feature, i);
+                const bool goLeft = (b == kMissing) ? node->defaultLeft : (b <= node->bin);
+                node = &tree.nodes[goLeft ? node->left : node->right];
+            }
+            for (int k = 0; k < K; k++)
+            {
+                predictions(i, k) += node->leaf[k];
+            }
+        };
+        cv::parallel_for_({ 0, N }, harness);
+    }
+}
+
+DRISHTI_ML_NAMESPACE_END
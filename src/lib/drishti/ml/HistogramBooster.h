@@ -0,0 +1,67 @@
+/*!
+  @file   HistogramBooster.h
+  @author David Hirvonen
+  @brief  Internal declaration of a histogram based multi-output gradient boosted tree trainer.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_ml_HistogramBooster_h__
+#define __drishti_ml_HistogramBooster_h__
+
+#include "drishti/ml/drishti_ml.h"
+#include "drishti/ml/TreeEnsemble.h"
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+// Squared loss gradient boosting for small, dense regression problems.
+// Features are quantized once into per feature histogram bins, and each
+// round grows one tree (depth wise) whose splits maximize the gain summed
+// over all outputs, so the gradient histograms of a node are built once
+// and shared by every output dimension.  Each output is emitted as its own
+// TreeEnsemble (same structure, separate leaf values), which is the model
+// layout used by XGBooster and the CPR stages.
+class HistogramBooster
+{
+public:
+    struct Recipe
+    {
+        int numberOfTrees = 512;
+        int maxDepth = 5;
+        double dataSubsample = 0.5;
+        double learningRate = 0.1;
+        double featureSubsample = 0.1;
+        int bins = 64;             // histogram bins per feature (at most 255)
+        double lambda = 1.0;       // L2 regularization of the leaf values
+        int minSamplesPerLeaf = 1; // minimum number of training samples per leaf
+        unsigned int seed = 0;     // row and feature subsampling
+    };
+
+    HistogramBooster();
+    HistogramBooster(const Recipe& recipe);
+
+    // features: samples x dimensions (NaN for missing values)
+    // targets: samples x outputs
+    // ensembles: one ensemble per output (column of targets)
+    // predictions: samples x outputs training predictions of the ensembles
+    void train(const cv::Mat1f& features, const cv::Mat1f& targets, std::vector<TreeEnsemble>& ensembles, cv::Mat1f& predictions) const;
+    void train(const cv::Mat1f& features, const cv::Mat1f& targets, std::vector<TreeEnsemble>& ensembles) const;
+
+    const Recipe& getRecipe() const
+    {
+        return m_recipe;
+    }
+
+protected:
+    Recipe m_recipe;
+};
+
+DRISHTI_ML_NAMESPACE_END
+
+#endif // __drishti_ml_HistogramBooster_h__
@@ -180,6 +180,19 @@ void StandardizedPCA::gemm_transpose(const cv::Mat& A, const cv::Mat& Bt, cv::Ma
     C1 = A1 * B1t;
 }
 
+void StandardizedPCA::getBackProjection(cv::Mat1f& basis, cv::Mat1f& offset) const
+{
+    // Matches the partial back projection path in backProject(): unstandardize(y * E)
+    m_pca->eigenvectors.convertTo(basis, CV_32F);
+    cv::Mat1f sigma;
+    m_transform.sigma.convertTo(sigma, CV_32F);
+    for (int i = 0; i < basis.rows; i++)
+    {
+        cv::multiply(basis.row(i), sigma, basis.row(i));
+    }
+    m_transform.mu.convertTo(offset, CV_32F);
+}
+
 cv::Mat StandardizedPCA::backProject(const cv::Mat& projection) const
 {
     cv::Mat result;
@@ -59,6 +59,9 @@ public:
         return m_eT;
     }
 
+    // Back projection as an affine map x = offset + sum_i y_i * basis.row(i) (sigma folded into the basis):
+    void getBackProjection(cv::Mat1f& basis, cv::Mat1f& offset) const;
+
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version);
 
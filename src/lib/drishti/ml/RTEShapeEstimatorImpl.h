@@ -19,6 +19,8 @@
 #include "drishti/ml/drishti_ml.h"
 #include "drishti/ml/shape_predictor.h"
 
+#include <numeric>
+
 #define _SHAPE_PREDICTOR drishti::ml::shape_predictor
 
 #if DRISHTI_SERIALIZE_WITH_BOOST
@@ -30,6 +32,32 @@ DRISHTI_ML_NAMESPACE_BEGIN
 class RegressionTreeEnsembleShapeEstimator::Impl
 {
 public:
+    // The shape models are immutable after loading, so an Impl (or a shallow copy sharing the
+    // models with different settings) can be used from any number of threads.  All per call state
+    // lives in a thread local workspace.
+    struct Workspace
+    {
+        _SHAPE_PREDICTOR::workspace predictor;
+        const Impl* owner = nullptr; // estimator that made the last call (shared by all estimators on a thread)
+        int stagesUsed = 0;
+    };
+
+    static Workspace& getWorkspace()
+    {
+        thread_local Workspace ws;
+        return ws;
+    }
+
+    // Prepare the workspace for a call from this estimator:
+    Workspace& beginCall() const
+    {
+        Workspace& ws = getWorkspace();
+        ws.predictor.logger = m_streamLogger.get();
+        ws.owner = this;
+        ws.stagesUsed = 0;
+        return ws;
+    }
+
     Impl() {}
     Impl(const std::string& filename);
     Impl(std::istream& is);
@@ -50,6 +78,13 @@ public:
     }
 
     int operator()(const cv::Mat& crop, std::vector<cv::Point2f>& points, std::vector<bool>& mask) const
+    {
+        return (*this)(crop, points, mask, nullptr);
+    }
+
+    // With m_inits > 1 the estimate is the per point median of m_inits perturbed initializations
+    // and the optional variance output contains the per point spread of those estimates.
+    int operator()(const cv::Mat& crop, std::vector<cv::Point2f>& points, std::vector<bool>& mask, std::vector<float>* variance) const
     {
         DRISHTI_STREAM_LOG_FUNC(6, 3, m_streamLogger);
         CV_Assert(crop.type() == CV_8UC1);
@@ -67,10 +102,165 @@ public:
         // Zero copy cv::Mat wrapper:
         auto img = dlib::cv_image<uint8_t>(crop);
         dlib::rectangle roi(0, 0, crop.cols, crop.rows);
-        dlib::full_object_detection shape = (*m_predictor)(img, roi, initial_shape, m_iters, m_stagesHint);
+
+        Workspace& ws = beginCall();
+        if (m_inits > 1)
+        {
+            std::vector<fshape> starter_shapes(m_inits, initial_shape);
+            for (int i = 1; i < m_inits; i++)
+            {
+                perturbShape(starter_shapes[i], m_predictor->m_ellipse_count, m_perturbations[i]);
+            }
+
+            std::vector<dlib::full_object_detection> shapes;
+            sp(ws.predictor, img, roi, starter_shapes, shapes, m_iters, m_stagesHint);
+            ws.stagesUsed = std::min(int(sp.forests.size()), m_stagesHint);
+
+            return medianOfShapes(shapes, points, mask, variance);
+        }
+
+        const float threshold = m_doEarlyExit ? sp.m_early_exit_threshold : 0.f;
+        dlib::full_object_detection shape = sp(ws.predictor, img, roi, initial_shape, m_iters, m_stagesHint, threshold, &ws.stagesUsed);
+
+        if (variance)
+        {
+            variance->assign(shape.num_parts(), 0.f);
+        }
+
+        return shapeToPoints(shape, points, mask);
+    }
+
+    static int medianOfShapes(const std::vector<dlib::full_object_detection>& shapes, std::vector<cv::Point2f>& points, std::vector<bool>& mask, std::vector<float>* variance)
+    {
+        const int n = int(shapes.size());
+        const int parts = int(shapes.front().num_parts());
+
+        points.resize(parts);
+        mask.assign(parts, true);
+        if (variance)
+        {
+            variance->resize(parts);
+        }
+
+        std::vector<float> xs(n), ys(n);
+        for (int j = 0; j < parts; j++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                xs[i] = float(shapes[i].part(j).x());
+                ys[i] = float(shapes[i].part(j).y());
+            }
+
+            if (variance)
+            {
+                // Total variance (trace of the covariance) of the point estimates:
+                const cv::Point2f mu(std::accumulate(xs.begin(), xs.end(), 0.f) / float(n), std::accumulate(ys.begin(), ys.end(), 0.f) / float(n));
+                float sigma2 = 0.f;
+                for (int i = 0; i < n; i++)
+                {
+                    sigma2 += (xs[i] - mu.x) * (xs[i] - mu.x) + (ys[i] - mu.y) * (ys[i] - mu.y);
+                }
+                (*variance)[j] = sigma2 / float(n);
+            }
+
+            std::nth_element(xs.begin(), xs.begin() + n / 2, xs.end());
+            std::nth_element(ys.begin(), ys.begin() + n / 2, ys.end());
+            points[j] = { xs[n / 2], ys[n / 2] };
+        }
+
+        return parts;
+    }
+
+    // Apply a small similarity transform (about the centroid) to the landmark points in a normalized shape:
+    static void perturbShape(fshape& shape, int ellipseCount, const cv::Vec4f& params)
+    {
+        const int pointLength = (int(shape.size()) - (ellipseCount * 5)) / 2;
+        if (pointLength <= 0)
+        {
+            return;
+        }
+
+        cv::Point2f mu(0.f, 0.f);
+        for (int i = 0; i < pointLength; i++)
+        {
+            mu += cv::Point2f(shape(i * 2 + 0), shape(i * 2 + 1));
+        }
+        mu *= (1.f / float(pointLength));
+
+        const float scale = params[0], c = std::cos(params[1]) * scale, s = std::sin(params[1]) * scale;
+        for (int i = 0; i < pointLength; i++)
+        {
+            const cv::Point2f p = cv::Point2f(shape(i * 2 + 0), shape(i * 2 + 1)) - mu;
+            shape(i * 2 + 0) = (c * p.x - s * p.y) + mu.x + params[2];
+            shape(i * 2 + 1) = (s * p.x + c * p.y) + mu.y + params[3];
+        }
+    }
+
+    void setInits(int inits)
+    {
+        m_inits = std::max(inits, 1);
+
+        // Deterministic perturbations (scale, rotation, tx, ty) with identity for the first init:
+        cv::RNG rng(0);
+        m_perturbations.resize(m_inits);
+        m_perturbations[0] = { 1.f, 0.f, 0.f, 0.f };
+        for (int i = 1; i < m_inits; i++)
+        {
+            m_perturbations[i][0] = rng.uniform(0.95f, 1.05f);
+            m_perturbations[i][1] = rng.uniform(-0.05f, 0.05f);
+            m_perturbations[i][2] = rng.uniform(-0.03f, 0.03f);
+            m_perturbations[i][3] = rng.uniform(-0.03f, 0.03f);
+        }
+    }
+
+    int getInits() const
+    {
+        return m_inits;
+    }
+
+    // Warm start from a prior shape (crop coordinates) using the reduced tail cascade.  If there is
+    // no tail model, or if the tail moves the prior by more than m_maxPriorResidual (normalized by
+    // the crop width) we fall back to the full cascade from the mean shape.
+    int operator()(const cv::Mat& crop, const std::vector<cv::Point2f>& prior, std::vector<cv::Point2f>& points, std::vector<bool>& mask) const
+    {
+        DRISHTI_STREAM_LOG_FUNC(6, 15, m_streamLogger);
+        CV_Assert(crop.type() == CV_8UC1);
+
+        const int partCount = m_tail ? (int(m_tail->initial_shape.size()) - (m_tail->m_ellipse_count * 5)) / 2 + (m_tail->m_ellipse_count * 5) : 0;
+        if (m_tail && (int(prior.size()) == partCount))
+        {
+            auto img = dlib::cv_image<uint8_t>(crop);
+            dlib::rectangle roi(0, 0, crop.cols, crop.rows);
+
+            fshape starter_shape = m_tail->initial_shape;
+            normalizePointsInShape(prior, roi, m_tail->m_ellipse_count, starter_shape);
+
+            Workspace& ws = beginCall();
+            dlib::full_object_detection shape = (*m_tail)(ws.predictor, img, roi, starter_shape, m_iters, m_stagesHint, 0.f, &ws.stagesUsed);
+
+            // Measure the residual over the landmark points (trailing ellipse parameters are excluded):
+            const int pointLength = int(prior.size()) - (m_tail->m_ellipse_count * 5);
+            float residual = 0.f;
+            for (int j = 0; j < pointLength; j++)
+            {
+                residual = std::max(residual, float(cv::norm(cv_point(shape.part(j)) - prior[j])));
+            }
+
+            if (residual <= (m_maxPriorResidual * float(crop.cols)))
+            {
+                points.clear();
+                return shapeToPoints(shape, points, mask);
+            }
+        }
 
         points.clear();
-        points.reserve(initial_shape.size() / 2);
+        return (*this)(crop, points, mask);
+    }
+
+    int shapeToPoints(const dlib::full_object_detection& shape, std::vector<cv::Point2f>& points, std::vector<bool>& mask) const
+    {
+        points.clear();
+        points.reserve(shape.num_parts());
         for (int j = 0; j < shape.num_parts(); j++)
         {
             points.push_back(cv_point(shape.part(j)));
@@ -80,6 +270,45 @@ public:
         return int(points.size());
     }
 
+    // Map points from the roi to the normalized shape space of the regressor
+    static void normalizePointsInShape(const std::vector<cv::Point2f>& points, const dlib::rectangle& roi, int ellipseCount, fshape& shape)
+    {
+        const dlib::point_transform_affine tform_from_img = impl::normalizing_tform(roi);
+
+        int pointLength = int(points.size()) - (ellipseCount * 5);
+        for (int i = 0; i < pointLength; i++)
+        {
+            const fpoint p = tform_from_img(fpoint(points[i].x, points[i].y));
+            shape(i * 2 + 0) = p.x();
+            shape(i * 2 + 1) = p.y();
+        }
+
+        const auto& m = tform_from_img.get_m();
+        const auto& b = tform_from_img.get_b();
+        const cv::Matx33f H(m(0, 0), m(0, 1), b(0), m(1, 0), m(1, 1), b(1), 0, 0, 1);
+        for (int i = 0; i < ellipseCount; i++)
+        {
+            const cv::RotatedRect e = H * geometry::pointsToEllipse(&points[pointLength + (i * 5)]);
+            std::vector<float> phi = geometry::ellipseToPhi(e);
+            memcpy(&shape(pointLength * 2 + (i * 5)), &phi[0], sizeof(float) * phi.size());
+        }
+    }
+
+    void setTail(std::shared_ptr<_SHAPE_PREDICTOR>& tail)
+    {
+        m_tail = tail;
+    }
+
+    void setMaxPriorResidual(float value)
+    {
+        m_maxPriorResidual = value;
+    }
+
+    float getMaxPriorResidual() const
+    {
+        return m_maxPriorResidual;
+    }
+
     void setStagesHint(int stages)
     {
         DRISHTI_STREAM_LOG_FUNC(6, 4, m_streamLogger);
@@ -92,6 +321,24 @@ public:
         return m_stagesHint;
     }
 
+    void setDoEarlyExit(bool flag)
+    {
+        m_doEarlyExit = flag;
+    }
+
+    bool getDoEarlyExit() const
+    {
+        return m_doEarlyExit;
+    }
+
+    // Stages used by this estimator's last call on the current thread (0 if another estimator,
+    // e.g., a clone, has been called on this thread since):
+    int getStagesUsed() const
+    {
+        const Workspace& ws = getWorkspace();
+        return (ws.owner == this) ? ws.stagesUsed : 0;
+    }
+
     // {{p[0].x, p[0].y}, ..., {p[n].x,p[n.y}, {phi0[0],0}, {phi0[1],0} {phi0[2],0}, {phi0[3],0}, {phi0[4],0}}...
     std::vector<cv::Point2f> getMeanShape() const
     {
@@ -109,13 +356,10 @@ public:
         return m_predictor->getShapeUpdates(values, pca);
     }
 
+    // The models can be shared with clones, so the logger is passed to them per call (see Workspace):
     void setStreamLogger(std::shared_ptr<spdlog::logger>& logger)
     {
         m_streamLogger = logger;
-        if (m_predictor)
-        {
-            m_predictor->setStreamLogger(logger);
-        }
     }
 
     template <class Archive>
@@ -126,6 +370,12 @@ public:
             m_predictor = std::make_shared<_SHAPE_PREDICTOR>();
         }
         ar&(*m_predictor);
+
+        if (version >= 1)
+        {
+            ar& m_tail;
+            ar& m_maxPriorResidual;
+        }
     }
 
     bool isPCA() const
@@ -134,12 +384,21 @@ public:
     }
 
     int m_iters = 1;
-    int m_inits = 1;
     int m_stagesHint = std::numeric_limits<int>::max();
+    bool m_doEarlyExit = false;
 
     std::shared_ptr<_SHAPE_PREDICTOR> m_predictor; // TODO: Create virtual interface
 
+    // Optional reduced cascade trained to refine a nearby prior (i.e., previous frame):
+    std::shared_ptr<_SHAPE_PREDICTOR> m_tail;
+    float m_maxPriorResidual = 0.1f; // max point displacement / crop width for a valid warm start
+
     std::shared_ptr<spdlog::logger> m_streamLogger;
+
+private:
+    // Set together by setInits(), so the perturbations always cover the inits:
+    int m_inits = 1;
+    std::vector<cv::Vec4f> m_perturbations{ { 1.f, 0.f, 0.f, 0.f } };
 };
 
 // Boost serialization:
@@ -160,4 +419,12 @@ void RTEShapeEstimator::serializeModel(Archive& ar, const unsigned int version)
 
 DRISHTI_ML_NAMESPACE_END
 
+#if DRISHTI_SERIALIZE_WITH_BOOST
+BOOST_CLASS_VERSION(drishti::ml::RegressionTreeEnsembleShapeEstimator::Impl, 1);
+#endif
+
+#if DRISHTI_SERIALIZE_WITH_CEREAL
+CEREAL_CLASS_VERSION(drishti::ml::RegressionTreeEnsembleShapeEstimator::Impl, 1);
+#endif
+
 #endif // __drishti_ml_RTEShapeEstimatorImpl_h__
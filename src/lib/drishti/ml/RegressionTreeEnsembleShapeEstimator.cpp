@@ -56,6 +56,15 @@ void RTEShapeEstimator::setStreamLogger(std::shared_ptr<spdlog::logger>& logger)
     }
 }
 
+// Shallow copy: settings are copied and the regression models are shared
+std::unique_ptr<ShapeEstimator> RTEShapeEstimator::clone() const
+{
+    std::unique_ptr<RTEShapeEstimator> estimator(new RTEShapeEstimator);
+    estimator->m_impl = std::make_shared<RegressionTreeEnsembleShapeEstimator::Impl>(*m_impl);
+    estimator->m_streamLogger = m_streamLogger;
+    return std::move(estimator);
+}
+
 RTEShapeEstimator::RegressionTreeEnsembleShapeEstimator(const std::string& filename)
 {
 #if DRISHTI_SERIALIZE_WITH_BOOST
@@ -105,12 +114,77 @@ int RTEShapeEstimator::getStagesHint() const
     return m_impl->getStagesHint();
 }
 
+void RTEShapeEstimator::setDoEarlyExit(bool flag)
+{
+    DRISHTI_STREAM_LOG_FUNC(6, 12, m_streamLogger);
+    m_impl->setDoEarlyExit(flag);
+}
+
+bool RTEShapeEstimator::getDoEarlyExit() const
+{
+    DRISHTI_STREAM_LOG_FUNC(6, 13, m_streamLogger);
+    return m_impl->getDoEarlyExit();
+}
+
+int RTEShapeEstimator::getStagesUsed() const
+{
+    DRISHTI_STREAM_LOG_FUNC(6, 14, m_streamLogger);
+    return m_impl->getStagesUsed();
+}
+
 int RTEShapeEstimator::operator()(const cv::Mat& gray, std::vector<cv::Point2f>& points, std::vector<bool>& mask) const
 {
     DRISHTI_STREAM_LOG_FUNC(6, 9, m_streamLogger);
     return (*m_impl)(gray, points, mask);
 }
 
+int RTEShapeEstimator::operator()(const cv::Mat& gray, const Point2fVec& prior, Point2fVec& points, BoolVec& mask) const
+{
+    DRISHTI_STREAM_LOG_FUNC(6, 16, m_streamLogger);
+    return (*m_impl)(gray, prior, points, mask);
+}
+
+int RTEShapeEstimator::operator()(const cv::Mat& gray, Point2fVec& points, BoolVec& mask, std::vector<float>& variance) const
+{
+    DRISHTI_STREAM_LOG_FUNC(6, 17, m_streamLogger);
+    return (*m_impl)(gray, points, mask, &variance);
+}
+
+void RTEShapeEstimator::setInits(int inits)
+{
+    DRISHTI_STREAM_LOG_FUNC(6, 18, m_streamLogger);
+    m_impl->setInits(inits);
+}
+
+int RTEShapeEstimator::getInits() const
+{
+    DRISHTI_STREAM_LOG_FUNC(6, 19, m_streamLogger);
+    return m_impl->getInits();
+}
+
+void RTEShapeEstimator::loadWarmStartModel(const std::string& filename)
+{
+#if DRISHTI_SERIALIZE_WITH_BOOST
+    if (filename.find(".pba.z") != std::string::npos)
+    {
+        auto tail = load_pba_z(filename);
+        m_impl->setTail(tail);
+        return;
+    }
+#endif
+    throw std::runtime_error("RTEShapeEstimator::loadWarmStartModel() unsupported format: " + filename);
+}
+
+void RTEShapeEstimator::setWarmStartMaxResidual(float value)
+{
+    m_impl->setMaxPriorResidual(value);
+}
+
+float RTEShapeEstimator::getWarmStartMaxResidual() const
+{
+    return m_impl->getMaxPriorResidual();
+}
+
 int RTEShapeEstimator::operator()(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, BoolVec& mask) const
 {
     DRISHTI_STREAM_LOG_FUNC(6, 10, m_streamLogger);
@@ -32,13 +32,28 @@ public:
     RegressionTreeEnsembleShapeEstimator(std::istream& is, const std::string& hint = {});
 
     virtual void setStreamLogger(std::shared_ptr<spdlog::logger>& logger);
+    virtual std::unique_ptr<ShapeEstimator> clone() const;
     virtual int operator()(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, BoolVec& mask) const;
     virtual int operator()(const cv::Mat& I, Point2fVec& points, BoolVec& mask) const;
+    virtual int operator()(const cv::Mat& I, const Point2fVec& prior, Point2fVec& points, BoolVec& mask) const;
+    virtual void setInits(int inits);
+    virtual int getInits() const;
+
+    // Multi-initialization estimate with per point variance of the estimates (confidence):
+    int operator()(const cv::Mat& I, Point2fVec& points, BoolVec& mask, std::vector<float>& variance) const;
     virtual std::vector<cv::Point2f> getMeanShape() const;
     virtual void setDoPreview(bool flag) {}
     virtual bool isPCA() const;
     virtual void setStagesHint(int stages);
     virtual int getStagesHint() const;
+    virtual void setDoEarlyExit(bool flag);
+    virtual bool getDoEarlyExit() const;
+    virtual int getStagesUsed() const;
+
+    // Reduced cascade for warm starts from a prior shape (see train_shape_predictor --warm-start):
+    void loadWarmStartModel(const std::string& filename);
+    void setWarmStartMaxResidual(float value);
+    float getWarmStartMaxResidual() const;
 
     void saveImpl(const std::string& filename);
     void loadImpl(const std::string& filename);
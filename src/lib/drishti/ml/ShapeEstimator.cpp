@@ -18,6 +18,7 @@
 #include "drishti/geometry/Primitives.h"
 #include "drishti/core/Shape.h"
 #include "drishti/core/Logger.h"
+#include "drishti/core/Parallel.h"
 
 #include <deque>
 
@@ -49,6 +50,34 @@ int ShapeEstimator::operator()(const cv::Mat& image, const cv::Rect& roi, Point2
     return n;
 }
 
+int ShapeEstimator::operator()(const cv::Mat& crop, const Point2fVec& prior, Point2fVec& points, BoolVec& mask) const
+{
+    points.clear();
+    return (*this)(crop, points, mask);
+}
+
+// Below this size, thread dispatch costs more than the shapes themselves:
+static const int kParallelBatch = 32;
+
+int ShapeEstimator::operator()(const cv::Mat& crop, std::vector<Point2fVec>& points) const
+{
+    core::ParallelHomogeneousLambda harness = [&](int i) {
+        BoolVec mask;
+        (*this)(crop, points[i], mask);
+    };
+
+    const cv::Range range(0, int(points.size()));
+    if (range.size() >= kParallelBatch)
+    {
+        cv::parallel_for_(range, harness);
+    }
+    else
+    {
+        harness(range);
+    }
+    return 0;
+}
+
 DRISHTI_ML_NAMESPACE_END
 
 // clang-format off
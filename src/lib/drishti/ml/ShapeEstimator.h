@@ -38,6 +38,13 @@ public:
 
     virtual ~ShapeEstimator() {}
 
+    // Create an estimator that shares the (immutable) model data with this one, or nullptr if
+    // the variant doesn't support sharing:
+    virtual std::unique_ptr<ShapeEstimator> clone() const
+    {
+        return nullptr;
+    }
+
     virtual void setStreamLogger(std::shared_ptr<spdlog::logger>& logger)
     {
         m_streamLogger = logger;
@@ -46,6 +53,15 @@ public:
     virtual int operator()(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, BoolVec& mask) const = 0;
     virtual int operator()(const cv::Mat& crop, Point2fVec& points, BoolVec& mask) const = 0;
     virtual int operator()(const cv::Mat& image, const cv::Rect& roi, Point2fVec& points, BoolVec& mask) const;
+
+    // Warm start from a prior shape in crop coordinates (i.e., from the previous frame).
+    // The default implementation ignores the prior and runs the full estimator.
+    virtual int operator()(const cv::Mat& crop, const Point2fVec& prior, Point2fVec& points, BoolVec& mask) const;
+
+    // Batch: each shape is estimated from its own initial points (as in operator()(crop, points, mask)).
+    // The default implementation runs the shapes independently, fanning out to threads for large batches.
+    virtual int operator()(const cv::Mat& crop, std::vector<Point2fVec>& points) const;
+
     virtual std::vector<cv::Point2f> getMeanShape() const
     {
         return std::vector<cv::Point2f>();
@@ -61,6 +77,26 @@ public:
         return 0;
     }
 
+    // Number of (perturbed) initializations combined by a per point median:
+    virtual void setInits(int inits) {}
+    virtual int getInits() const
+    {
+        return 1;
+    }
+
+    // Stop the cascade when the shape update norm falls below the model's learned threshold:
+    virtual void setDoEarlyExit(bool flag) {}
+    virtual bool getDoEarlyExit() const
+    {
+        return false;
+    }
+
+    // Number of cascade stages evaluated in this estimator's most recent call on the calling thread (0 == not reported):
+    virtual int getStagesUsed() const
+    {
+        return 0;
+    }
+
     virtual void setStagesRepetitionFactor(int x){};
     virtual int getStagesRepetitionFactor() const
     {
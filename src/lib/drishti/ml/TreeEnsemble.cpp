@@ -0,0 +1,363 @@
+/*!
+  @file   TreeEnsemble.cpp
+  @author David Hirvonen
+  @brief  Internal implementation of a flat (read only) regression tree ensemble evaluator.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include "drishti/ml/TreeEnsemble.h"
+
+// clang-format off
+#if defined(ANDROID)
+#  define HALF_ENABLE_CPP11_CMATH 0
+#endif
+// clang-format on
+#include "half/half.hpp"
+
+// clang-format off
+#if defined(__F16C__)
+#  include <immintrin.h>
+#  define DO_F16C 1
+#endif
+// clang-format on
+
+// clang-format off
+#if defined(__aarch64__) || (defined(__ARM_NEON) && defined(__ARM_FP) && (__ARM_FP & 2))
+#  include <arm_neon.h>
+#  define DO_ARM_NEON 1
+#endif
+// clang-format on
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+using Node = TreeEnsemble::Node;
+
+static inline int nextNode(const Node& node, const float* features, int n)
+{
+    const int f = node.feature;
+    if ((f >= n) || std::isnan(features[f]))
+    {
+        return node.missing;
+    }
+    return node.child + int(!(features[f] < node.value));
+}
+
+// Each tree is traversed for a block of samples in lock step, so the
+// independent node loads of each lane overlap instead of serializing
+// on one root to leaf path at a time.
+static const int kLanes = 8;
+static inline void traverse(const std::vector<Node>& nodes, int root, const float* x, int lanes, int n, int stride, int* index)
+{
+    std::fill(index, index + lanes, root);
+    for (bool active = true; active;)
+    {
+        active = false;
+        for (int j = 0; j < lanes; j++)
+        {
+            const Node& node = nodes[index[j]];
+            if (node.feature >= 0)
+            {
+                index[j] = nextNode(node, x + (j * stride), n);
+                active = true;
+            }
+        }
+    }
+}
+
+// Matches the xgboost "binary:logistic" prediction transform:
+static inline float logistic(float x)
+{
+    return 1.f / (1.f + std::exp(-x));
+}
+
+float TreeEnsemble::predict(const float* features, int n) const
+{
+    float sum = m_baseScore;
+    for (const auto& root : m_roots)
+    {
+        const Node* node = &m_nodes[root];
+        while (node->feature >= 0)
+        {
+            node = &m_nodes[nextNode(*node, features, n)];
+        }
+        sum += node->value;
+    }
+
+    return m_logistic ? logistic(sum) : sum;
+}
+
+void TreeEnsemble::predict(const float* features, int samples, int n, int stride, float* outputs) const
+{
+    std::fill(outputs, outputs + samples, m_baseScore);
+    for (int i = 0; i < samples; i += kLanes)
+    {
+        const int lanes = std::min(kLanes, samples - i);
+        const float* x = features + (i * stride);
+        for (const auto& root : m_roots)
+        {
+            int index[kLanes];
+            traverse(m_nodes, root, x, lanes, n, stride, index);
+            for (int j = 0; j < lanes; j++)
+            {
+                outputs[i + j] += m_nodes[index[j]].value;
+            }
+        }
+    }
+
+    if (m_logistic)
+    {
+        std::transform(outputs, outputs + samples, outputs, logistic);
+    }
+}
+
+// ########## Packed storage ##########
+
+static const int kMaxPackedFeature = 0x7fff;
+static const uint16_t kDefaultRight = 0x8000;
+
+static uint16_t floatToHalf(float value)
+{
+    return half_float::detail::float2half<std::round_to_nearest>(value);
+}
+
+static void halfToFloat(const uint16_t* src, float* dst, int n)
+{
+    int i = 0;
+#if DO_F16C
+    for (; i <= n - 8; i += 8)
+    {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    }
+#elif DO_ARM_NEON
+    for (; i <= n - 4; i += 4)
+    {
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[i] = half_float::detail::half2float(src[i]);
+    }
+}
+
+bool TreeEnsemble::pack(Precision precision, Packed& packed) const
+{
+    packed = {};
+    if (m_roots.empty())
+    {
+        return false; // nothing to store in place of the learner
+    }
+
+    packed.precision = static_cast<uint8_t>(precision);
+    packed.baseScore = m_baseScore;
+    packed.logistic = static_cast<uint8_t>(m_logistic);
+
+    for (std::size_t t = 0; t < m_roots.size(); t++)
+    {
+        const int begin = m_roots[t];
+        const int end = (t + 1) < m_roots.size() ? m_roots[t + 1] : static_cast<int>(m_nodes.size());
+
+        float scale = 0.f;
+        for (int i = begin, k = 0; i < end; i++)
+        {
+            const Node& node = m_nodes[i];
+            if (node.feature >= 0)
+            {
+                if ((node.feature >= kMaxPackedFeature) || (node.child != (begin + 1 + 2 * k++)))
+                {
+                    return false;
+                }
+                packed.features.push_back(uint16_t(node.feature + 1) | ((node.missing != node.child) ? kDefaultRight : 0));
+            }
+            else
+            {
+                packed.features.push_back(0);
+                scale = std::max(scale, std::abs(node.value));
+            }
+        }
+        scale /= 127.f;
+
+        for (int i = begin; i < end; i++)
+        {
+            const Node& node = m_nodes[i];
+            switch (precision)
+            {
+                case kFloat:
+                    packed.values.push_back(node.value);
+                    break;
+                case kHalf:
+                    packed.halfs.push_back(floatToHalf(node.value));
+                    break;
+                case kInt8:
+                    if (node.feature >= 0)
+                    {
+                        packed.halfs.push_back(floatToHalf(node.value));
+                    }
+                    else
+                    {
+                        const float q = (scale > 0.f) ? std::round(node.value / scale) : 0.f;
+                        packed.leaves.push_back(static_cast<int8_t>(std::max(std::min(q, 127.f), -127.f)));
+                    }
+                    break;
+            }
+        }
+
+        if (precision == kInt8)
+        {
+            packed.scales.push_back(scale);
+        }
+    }
+
+    return true;
+}
+
+void TreeEnsemble::unpack(const Packed& packed)
+{
+    clear();
+    m_baseScore = packed.baseScore;
+    m_logistic = (packed.logistic != 0);
+
+    const int n = static_cast<int>(packed.features.size());
+    const int splits = static_cast<int>(std::count_if(packed.features.begin(), packed.features.end(), [](uint16_t f) { return f != 0; }));
+
+    std::vector<float> values;
+    switch (packed.precision)
+    {
+        case kFloat:
+            values = packed.values;
+            break;
+        case kHalf:
+        case kInt8:
+            values.resize(packed.halfs.size());
+            halfToFloat(packed.halfs.data(), values.data(), static_cast<int>(values.size()));
+            break;
+        default:
+            throw std::runtime_error("TreeEnsemble: unsupported packed precision");
+    }
+
+    const bool quantized = (packed.precision == kInt8);
+    if (quantized ? ((values.size() != splits) || (packed.leaves.size() != (n - splits))) : (values.size() != n))
+    {
+        throw std::runtime_error("TreeEnsemble: inconsistent packed model");
+    }
+
+    // Walk the breadth first trees, a tree ends when no children are pending:
+    m_nodes.resize(n);
+    int root = 0, pending = 0, k = 0, split = 0, leaf = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (pending == 0)
+        {
+            root = i;
+            k = 0;
+            pending = 1;
+            m_roots.push_back(root);
+        }
+        pending--;
+
+        const uint16_t code = packed.features[i];
+        Node& node = m_nodes[i];
+        if (code)
+        {
+            node.feature = int(code & ~kDefaultRight) - 1;
+            node.child = root + 1 + 2 * k++;
+            node.missing = node.child + int((code & kDefaultRight) != 0);
+            node.value = values[quantized ? split++ : i];
+            pending += 2;
+        }
+        else
+        {
+            node.value = quantized ? float(packed.leaves[leaf++]) * packed.scales.at(m_roots.size() - 1) : values[i];
+        }
+    }
+
+    if ((pending != 0) || (quantized && (packed.scales.size() != m_roots.size())))
+    {
+        clear();
+        throw std::runtime_error("TreeEnsemble: inconsistent packed model");
+    }
+}
+
+// ########## MultiTreeEnsemble ##########
+
+void MultiTreeEnsemble::clear()
+{
+    m_nodes.clear();
+    m_roots.clear();
+    m_outputs.clear();
+    m_baseScores.clear();
+    m_logistic.clear();
+}
+
+void MultiTreeEnsemble::add(const TreeEnsemble& ensemble)
+{
+    const int output = getOutputs();
+    const int offset = static_cast<int>(m_nodes.size());
+
+    for (auto node : ensemble.getNodes())
+    {
+        if (node.feature >= 0)
+        {
+            node.child += offset;
+            node.missing += offset;
+        }
+        m_nodes.push_back(node);
+    }
+
+    for (const auto& root : ensemble.getRoots())
+    {
+        m_roots.push_back(root + offset);
+        m_outputs.push_back(output);
+    }
+
+    m_baseScores.push_back(ensemble.getBaseScore());
+    m_logistic.push_back(ensemble.getLogistic());
+}
+
+void MultiTreeEnsemble::predict(const float* features, int samples, int n, int stride, float* outputs) const
+{
+    const int dim = getOutputs();
+    for (int i = 0; i < samples; i++)
+    {
+        std::copy(m_baseScores.begin(), m_baseScores.end(), outputs + (i * dim));
+    }
+
+    for (int i = 0; i < samples; i += kLanes)
+    {
+        const int lanes = std::min(kLanes, samples - i);
+        const float* x = features + (i * stride);
+        float* y = outputs + (i * dim);
+
+        for (std::size_t t = 0; t < m_roots.size(); t++)
+        {
+            int index[kLanes];
+            traverse(m_nodes, m_roots[t], x, lanes, n, stride, index);
+
+            const int k = m_outputs[t];
+            for (int j = 0; j < lanes; j++)
+            {
+                y[(j * dim) + k] += m_nodes[index[j]].value;
+            }
+        }
+    }
+
+    for (int k = 0; k < dim; k++)
+    {
+        if (m_logistic[k])
+        {
+            for (int i = 0; i < samples; i++)
+            {
+                outputs[(i * dim) + k] = logistic(outputs[(i * dim) + k]);
+            }
+        }
+    }
+}
+
+DRISHTI_ML_NAMESPACE_END
@@ -0,0 +1,200 @@
+/*!
+  @file   TreeEnsemble.h
+  @author David Hirvonen
+  @brief  Internal declaration of a flat (read only) regression tree ensemble evaluator.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#ifndef __drishti_ml_TreeEnsemble_h__
+#define __drishti_ml_TreeEnsemble_h__
+
+#include "drishti/ml/drishti_ml.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+DRISHTI_ML_NAMESPACE_BEGIN
+
+// Trees are stored in a single node array with sibling nodes in adjacent
+// slots, so a split only needs to store the index of its left child.
+// Evaluation is const and allocation free, so one instance can be shared
+// by any number of threads.
+class TreeEnsemble
+{
+public:
+    // Storage precision of the compact (packed) representation:
+    enum Precision
+    {
+        kFloat, // 32 bit thresholds and leaves
+        kHalf,  // 16 bit thresholds and leaves
+        kInt8   // 16 bit thresholds, 8 bit leaves with a per tree scale
+    };
+
+    // Compact serializable node array.  Each tree is stored breadth first,
+    // so child indices are implicit and only the split feature, the missing
+    // value direction and the node value remain per node.
+    struct Packed
+    {
+        uint8_t precision = kFloat;
+        float baseScore = 0.f;
+        uint8_t logistic = 0;
+        std::vector<uint16_t> features; // (feature + 1) | default right bit, or 0 for a leaf
+        std::vector<float> values;      // kFloat: node values
+        std::vector<uint16_t> halfs;    // kHalf: node values, kInt8: thresholds (fp16)
+        std::vector<int8_t> leaves;     // kInt8: leaf values / scale
+        std::vector<float> scales;      // kInt8: per tree leaf scale
+
+        template <class Archive>
+        void serialize(Archive& ar, const unsigned int version)
+        {
+            ar& precision;
+            ar& baseScore;
+            ar& logistic;
+            ar& features;
+            ar& values;
+            ar& halfs;
+            ar& leaves;
+            ar& scales;
+        }
+    };
+
+    struct Node
+    {
+        int feature = -1;  // split feature index, or -1 for a leaf
+        float value = 0.f; // split threshold (x < value goes left), or leaf response
+        int child = 0;     // left child (right child is child + 1)
+        int missing = 0;   // child for missing (NaN or out of range) features
+    };
+
+    TreeEnsemble() {}
+
+    void clear()
+    {
+        m_nodes.clear();
+        m_roots.clear();
+        m_baseScore = 0.f;
+        m_logistic = false;
+    }
+
+    bool empty() const
+    {
+        return m_roots.empty();
+    }
+
+    std::size_t size() const
+    {
+        return m_roots.size();
+    }
+
+    void setBaseScore(float value) { m_baseScore = value; }
+    float getBaseScore() const { return m_baseScore; }
+
+    void setLogistic(bool flag) { m_logistic = flag; }
+    bool getLogistic() const { return m_logistic; }
+
+    // Append a tree exposing the xgboost RegTree node interface (root node 0):
+    template <typename Tree>
+    void addTree(const Tree& tree)
+    {
+        const int root = static_cast<int>(m_nodes.size());
+        m_roots.push_back(root);
+        m_nodes.emplace_back();
+
+        // Breadth first, so the children of the k'th split are at root + 1 + 2k:
+        std::vector<std::pair<int, int>> queue{ { 0, root } }; // { source, target }
+        for (std::size_t head = 0; head < queue.size(); head++)
+        {
+            const auto item = queue[head];
+
+            const auto& src = tree[item.first];
+            Node node;
+            if (src.is_leaf())
+            {
+                node.value = src.leaf_value();
+            }
+            else
+            {
+                node.feature = static_cast<int>(src.split_index());
+                node.value = src.split_cond();
+                node.child = static_cast<int>(m_nodes.size());
+                node.missing = node.child + (src.default_left() ? 0 : 1);
+                m_nodes.resize(m_nodes.size() + 2);
+                queue.emplace_back(src.cleft(), node.child);
+                queue.emplace_back(src.cright(), node.child + 1);
+            }
+            m_nodes[item.second] = node;
+        }
+    }
+
+    float predict(const float* features, int n) const;
+    float predict(const std::vector<float>& features) const
+    {
+        return predict(features.data(), static_cast<int>(features.size()));
+    }
+
+    // Batch: samples x n features with the given row stride, outputs[samples]
+    void predict(const float* features, int samples, int n, int stride, float* outputs) const;
+
+    const std::vector<Node>& getNodes() const { return m_nodes; }
+    const std::vector<int>& getRoots() const { return m_roots; }
+
+    // Compact representation (returns false if the trees can't be packed, i.e.,
+    // more than 32767 features or nodes not in breadth first order):
+    bool pack(Precision precision, Packed& packed) const;
+
+    // Expand a compact representation (16 bit values use F16C/NEON conversions where available):
+    void unpack(const Packed& packed);
+
+protected:
+    std::vector<Node> m_nodes;
+    std::vector<int> m_roots;
+    float m_baseScore = 0.f;
+    bool m_logistic = false;
+};
+
+// Several single output ensembles over a shared feature vector merged into one
+// node array, so all outputs (and many samples) are evaluated in one pass.
+class MultiTreeEnsemble
+{
+public:
+    MultiTreeEnsemble() {}
+
+    void clear();
+
+    bool empty() const
+    {
+        return m_roots.empty();
+    }
+
+    int getOutputs() const
+    {
+        return static_cast<int>(m_baseScores.size());
+    }
+
+    // Append an ensemble as the next output:
+    void add(const TreeEnsemble& ensemble);
+
+    // Single sample: outputs[getOutputs()]
+    void predict(const float* features, int n, float* outputs) const
+    {
+        predict(features, 1, n, n, outputs);
+    }
+
+    // Batch: samples x n features with the given row stride, outputs[samples * getOutputs()]
+    void predict(const float* features, int samples, int n, int stride, float* outputs) const;
+
+protected:
+    std::vector<TreeEnsemble::Node> m_nodes;
+    std::vector<int> m_roots;
+    std::vector<int> m_outputs; // output index for each tree
+    std::vector<float> m_baseScores;
+    std::vector<uint8_t> m_logistic;
+};
+
+DRISHTI_ML_NAMESPACE_END
+
+#endif // __drishti_ml_TreeEnsemble_h__
@@ -32,12 +32,55 @@ void XGBooster::setStreamLogger(std::shared_ptr<spdlog::logger>& logger)
     }
 }
 
-float XGBooster::operator()(const std::vector<float>& features)
+float XGBooster::operator()(const std::vector<float>& features) const
 {
     DRISHTI_STREAM_LOG_FUNC(7, 3, m_streamLogger);
     return (*m_impl)(features);
 }
 
+void XGBooster::operator()(const cv::Mat1f& features, cv::Mat1f& outputs) const
+{
+    DRISHTI_STREAM_LOG_FUNC(7, 5, m_streamLogger);
+    m_impl->predict(features, outputs);
+}
+
+float XGBooster::predictReference(const std::vector<float>& features) const
+{
+    DRISHTI_STREAM_LOG_FUNC(7, 4, m_streamLogger);
+    return m_impl->predictReference(features);
+}
+
+const TreeEnsemble* XGBooster::getEnsemble() const
+{
+    const TreeEnsemble& ensemble = m_impl->getEnsemble();
+    return ensemble.empty() ? nullptr : &ensemble;
+}
+
+void XGBooster::setEnsemble(const TreeEnsemble& ensemble)
+{
+    m_impl->setEnsemble(ensemble);
+}
+
+void XGBooster::setPrecision(TreeEnsemble::Precision precision)
+{
+    m_impl->setPrecision(precision);
+}
+
+TreeEnsemble::Precision XGBooster::getPrecision() const
+{
+    return m_impl->getPrecision();
+}
+
+void XGBooster::setThreads(int threads)
+{
+    m_impl->setThreads(threads);
+}
+
+int XGBooster::getThreads() const
+{
+    return m_impl->getThreads();
+}
+
 void XGBooster::train(const MatrixType<float>& features, const std::vector<float>& values, const MatrixType<uint8_t>& mask)
 {
 #if DRISHTI_BUILD_MIN_SIZE
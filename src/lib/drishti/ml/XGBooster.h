@@ -12,6 +12,7 @@
 #define __drishti_ml_XGBooster_h__
 
 #include "drishti/ml/drishti_ml.h"
+#include "drishti/ml/TreeEnsemble.h"
 #include "drishti/core/Logger.h"
 
 #include <opencv2/core.hpp>
@@ -44,9 +45,37 @@ public:
     class Impl;
     XGBooster();
     XGBooster(const Recipe& recipe);
-    float operator()(const std::vector<float>& features);
+
+    // Reentrant prediction through the compiled (flat) tree ensemble:
+    float operator()(const std::vector<float>& features) const;
+
+    // Batch prediction: features (N x D samples) -> outputs (N x 1), rows are
+    // read in place and large batches are evaluated in parallel:
+    void operator()(const cv::Mat1f& features, cv::Mat1f& outputs) const;
+
+    // Prediction through the xgboost learner, for validation.  Concurrent calls
+    // use per thread learner instances cloned on demand from the model:
+    float predictReference(const std::vector<float>& features) const;
+
+    // Compiled ensemble (nullptr if unavailable):
+    const TreeEnsemble* getEnsemble() const;
+
+    // Replace the model with an externally trained ensemble (e.g., HistogramBooster),
+    // which is then evaluated and serialized without the xgboost learner (serialize()
+    // and write() throw std::runtime_error if it can't be stored):
+    void setEnsemble(const TreeEnsemble& ensemble);
+
+    // Number of threads used by the xgboost learner for training (default: all cores):
+    void setThreads(int threads);
+    int getThreads() const;
+
     void train(const MatrixType<float>& features, const std::vector<float>& values, const MatrixType<uint8_t>& mask = {});
 
+    // Storage precision used by serialize(), reduced precision models are stored
+    // as a packed ensemble (the loaded precision is reported after loading):
+    void setPrecision(TreeEnsemble::Precision precision);
+    TreeEnsemble::Precision getPrecision() const;
+
     void read(const std::string& filename);
     void write(const std::string& filename) const;
 
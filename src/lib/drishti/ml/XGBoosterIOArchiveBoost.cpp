@@ -11,6 +11,8 @@
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/export.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 // include all std functions
 using namespace std;
@@ -27,6 +29,8 @@ using namespace std;
 using namespace xgboost;
 using namespace xgboost::io;
 
+BOOST_CLASS_VERSION(drishti::ml::XGBooster::Impl, 1);
+
 // Learner (IGradBooster):
 BOOST_SERIALIZATION_ASSUME_ABSTRACT(xgboost::gbm::IGradBooster);
 BOOST_CLASS_EXPORT_GUID(xgboost::gbm::IGradBooster, "IGradBooster");
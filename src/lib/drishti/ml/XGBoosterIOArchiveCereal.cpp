@@ -31,6 +31,8 @@ CEREAL_SPECIALIZE_FOR_ALL_ARCHIVES(xgboost::gbm::IGradBooster, cereal::specializ
 CEREAL_SPECIALIZE_FOR_ALL_ARCHIVES(xgboost::gbm::GBTree, cereal::specialization::non_member_serialize);
 CEREAL_SPECIALIZE_FOR_ALL_ARCHIVES(xgboost::tree::RegTree, cereal::specialization::non_member_serialize);
 
+CEREAL_CLASS_VERSION(drishti::ml::XGBooster::Impl, 1);
+
 CEREAL_REGISTER_TYPE(xgboost::wrapper::Booster);
 CEREAL_REGISTER_TYPE(xgboost::gbm::GBTree);
 CEREAL_REGISTER_POLYMORPHIC_RELATION(xgboost::gbm::IGradBooster, xgboost::gbm::GBTree);
@@ -12,6 +12,12 @@
 #define __drishti_ml_XGBoosterImpl_h__
 
 #include "drishti/ml/Booster.h"
+#include "drishti/ml/TreeEnsemble.h"
+#include "drishti/core/Parallel.h"
+
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 
 DRISHTI_ML_NAMESPACE_BEGIN
 
@@ -52,7 +58,7 @@ public:
 
         // https://github.com/dmlc/xgboost/blob/master/doc/parameter.md
         m_booster->SetParam("silent", "1");
-        m_booster->SetParam("nthread", "8");
+        m_booster->SetParam("nthread", xtos(m_threads).c_str());
         m_booster->SetParam("booster", "gbtree");
 
         m_booster->SetParam("eta", xtos(m_recipe.learningRate).c_str()); // shrinkage
@@ -74,14 +80,97 @@ public:
         }
     }
 
-    float operator()(const std::vector<float>& features)
+    float operator()(const std::vector<float>& features) const
     {
+        if (!m_ensemble.empty())
+        {
+            return m_ensemble.predict(features);
+        }
+        return predictReference(features);
+    }
+
+    // Batch prediction for the rows of features (samples x dimensions): the
+    // compiled ensemble reads the rows in place and large batches are split
+    // across threads, else the learner predicts all rows from one DMatrix.
+    void predict(const cv::Mat1f& features, cv::Mat1f& outputs) const
+    {
+        outputs.create(features.rows, 1);
+        if (features.empty())
+        {
+            return;
+        }
+
+        if (!m_ensemble.empty())
+        {
+            const int step = static_cast<int>(features.step1());
+            core::ParallelLambdaRange harness = [&](const cv::Range& r) {
+                m_ensemble.predict(features.ptr<float>(r.start), r.size(), features.cols, step, outputs.ptr<float>(r.start));
+            };
+
+            static const int kRowsPerStripe = 256;
+            const int stripes = (features.rows + kRowsPerStripe - 1) / kRowsPerStripe;
+            if (stripes > 1)
+            {
+                cv::parallel_for_({ 0, features.rows }, harness, stripes);
+            }
+            else
+            {
+                harness({ 0, features.rows });
+            }
+            return;
+        }
+
+        const cv::Mat1f samples = features.isContinuous() ? features : features.clone();
+        std::shared_ptr<DMatrixSimple> dTest = xgboost::DMatrixSimpleFromMat(samples.ptr<float>(), samples.rows, samples.cols, NAN);
+        std::vector<float> predictions(samples.rows, 0.f);
+
+#if DRISHTI_BUILD_MIN_SIZE
+        {
+            std::lock_guard<std::mutex> lock(m_poolMutex);
+            m_booster->Predict(*dTest, false, &predictions);
+        }
+#else
+        LearnerLease learner(*this);
+        learner->Predict(*dTest, false, &predictions);
+#endif
+        std::copy(predictions.begin(), predictions.end(), outputs.begin());
+    }
+
+    // The xgboost learner prediction is not reentrant, so each call leases a
+    // learner from a pool of instances cloned from the serialized model.
+    float predictReference(const std::vector<float>& features) const
+    {
+        if (!m_hasLearner)
+        {
+            return m_ensemble.predict(features); // compact models are stored without the learner
+        }
+
         std::shared_ptr<DMatrixSimple> dTest = xgboost::DMatrixSimpleFromMat(&features[0], 1, features.size(), NAN);
         std::vector<float> predictions(1, 0.f);
+
+#if DRISHTI_BUILD_MIN_SIZE
+        // Learners can't be cloned in minimal builds:
+        std::lock_guard<std::mutex> lock(m_poolMutex);
         m_booster->Predict(*dTest, false, &predictions);
+#else
+        LearnerLease learner(*this);
+        learner->Predict(*dTest, false, &predictions);
+#endif
         return predictions.front();
     }
 
+    // Number of threads used by the xgboost learner (training):
+    void setThreads(int threads)
+    {
+        m_threads = std::max(threads, 1);
+        m_booster->SetParam("nthread", xtos(m_threads).c_str());
+    }
+
+    int getThreads() const
+    {
+        return m_threads;
+    }
+
     void train(const MatrixType<float>& features, const std::vector<float>& values, const MatrixType<uint8_t>& mask = {})
     {
 #if DRISHTI_BUILD_MIN_SIZE
@@ -101,9 +190,56 @@ public:
         {
             m_booster->UpdateOneIter(t, *dTrain);
         }
+
+        compile();
+        m_hasLearner = true;
 #endif
     }
 
+    // Flatten the learned trees into a read only ensemble for reentrant inference.
+    // Unsupported configurations (linear or multi-output boosters) leave the
+    // ensemble empty and predictions fall back to the xgboost learner.
+    void compile()
+    {
+        resetLearners();
+        m_ensemble.clear();
+
+        auto* gbt = dynamic_cast<xgboost::gbm::GBTree*>(m_booster->gbm_);
+        if (!gbt || (gbt->mparam.num_output_group != 1))
+        {
+            return;
+        }
+
+        for (const auto& tree : gbt->trees)
+        {
+            if (tree->param.num_roots != 1)
+            {
+                m_ensemble.clear();
+                return;
+            }
+            m_ensemble.addTree(*tree);
+        }
+
+        // The learner stores base_score as a margin after model initialization:
+        m_ensemble.setBaseScore(m_booster->mparam.base_score);
+
+        const std::string& objective = m_booster->name_obj_;
+        m_ensemble.setLogistic((objective == "binary:logistic") || (objective == "reg:logistic"));
+    }
+
+    const TreeEnsemble& getEnsemble() const
+    {
+        return m_ensemble;
+    }
+
+    // Use an externally trained ensemble (e.g., HistogramBooster) in place of the learner:
+    void setEnsemble(const TreeEnsemble& ensemble)
+    {
+        resetLearners();
+        m_ensemble = ensemble;
+        m_hasLearner = false;
+    }
+
     void read(const std::string& name)
     {
 #if DRISHTI_BUILD_MIN_SIZE
@@ -111,6 +247,8 @@ public:
 #else
         // normal XGBoost logging not needed with boost serialization
         m_booster->LoadModel(name.c_str());
+        compile();
+        m_hasLearner = true;
 #endif
     }
 
@@ -119,15 +257,74 @@ public:
 #if DRISHTI_BUILD_MIN_SIZE
         assert(false);
 #else
+        if (!m_hasLearner)
+        {
+            throw std::runtime_error("XGBooster: the xgboost model format requires a learner (use serialize())");
+        }
         m_booster->SaveModel(name.c_str(), true); // with_pbuffer TODO
 #endif
     }
 
+    void setPrecision(TreeEnsemble::Precision precision)
+    {
+        m_precision = precision;
+    }
+
+    TreeEnsemble::Precision getPrecision() const
+    {
+        return m_precision;
+    }
+
+    // Version 1: reduced precision models (or models loaded without a learner)
+    // are stored as a packed ensemble in place of the xgboost learner, and the
+    // stored format is read back at runtime independent of the build.
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version)
     {
         ar& m_recipe;
-        ar& m_booster;
+
+        TreeEnsemble::Packed packed;
+        uint8_t compact = 0;
+        if (!Archive::is_loading::value)
+        {
+            // Learners that don't compile to an ensemble (linear, multi-output) are stored as is:
+            if (!m_ensemble.empty() && ((m_precision != TreeEnsemble::kFloat) || !m_hasLearner))
+            {
+                compact = m_ensemble.pack(m_precision, packed);
+            }
+
+            // The (empty) learner is no substitute for an ensemble that can't be packed:
+            if (!compact && !m_hasLearner)
+            {
+                throw std::runtime_error("XGBooster: ensemble without a learner can't be packed");
+            }
+        }
+
+        if (version >= 1)
+        {
+            ar& compact;
+        }
+
+        if (compact)
+        {
+            ar& packed;
+            if (Archive::is_loading::value)
+            {
+                m_ensemble.unpack(packed);
+                m_precision = static_cast<TreeEnsemble::Precision>(packed.precision);
+                m_hasLearner = false;
+            }
+        }
+        else
+        {
+            ar& m_booster;
+            if (Archive::is_loading::value)
+            {
+                compile();
+                m_precision = TreeEnsemble::kFloat;
+                m_hasLearner = true;
+            }
+        }
     }
 
     void setStreamLogger(std::shared_ptr<spdlog::logger>& logger)
@@ -140,8 +337,90 @@ public:
     }
 
 protected:
+    using LearnerPtr = std::shared_ptr<xgboost::wrapper::Booster>;
+
+#if !DRISHTI_BUILD_MIN_SIZE
+    LearnerPtr acquireLearner() const
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        if (!m_learners.empty())
+        {
+            LearnerPtr learner = m_learners.back();
+            m_learners.pop_back();
+            return learner;
+        }
+
+        // The model buffer is shared by all clones and created on first use:
+        if (m_model.empty())
+        {
+            bst_ulong length = 0;
+            const char* model = m_booster->GetModelRaw(&length);
+            m_model.assign(model, model + length);
+        }
+
+        LearnerPtr learner = std::make_shared<xgboost::wrapper::Booster>();
+        learner->SetParam("silent", "1");
+        learner->SetParam("nthread", "1"); // callers provide the parallelism
+        learner->LoadModelFromBuffer(m_model.data(), m_model.size());
+        auto logger = m_streamLogger;
+        learner->setStreamLogger(logger);
+        return learner;
+    }
+
+    void releaseLearner(const LearnerPtr& learner) const
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        m_learners.push_back(learner);
+    }
+
+    // Scoped lease, the learner returns to the pool even if Predict() throws:
+    class LearnerLease
+    {
+    public:
+        LearnerLease(const Impl& impl)
+            : m_impl(impl)
+            , m_learner(impl.acquireLearner())
+        {
+        }
+
+        ~LearnerLease()
+        {
+            m_impl.releaseLearner(m_learner);
+        }
+
+        LearnerLease(const LearnerLease&) = delete;
+        LearnerLease& operator=(const LearnerLease&) = delete;
+
+        xgboost::wrapper::Booster* operator->() const
+        {
+            return m_learner.get();
+        }
+
+    protected:
+        const Impl& m_impl;
+        LearnerPtr m_learner;
+    };
+#endif
+
+    // Drop cloned learners when the model changes:
+    void resetLearners()
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        m_learners.clear();
+        m_model.clear();
+    }
+
     Recipe m_recipe;
     std::shared_ptr<xgboost::wrapper::Booster> m_booster;
+    TreeEnsemble m_ensemble;
+    TreeEnsemble::Precision m_precision = TreeEnsemble::kFloat; // storage precision
+    bool m_hasLearner = true;                                   // false for packed models
+
+    int m_threads = std::max(int(std::thread::hardware_concurrency()), 1);
+
+    mutable std::mutex m_poolMutex;
+    mutable std::vector<LearnerPtr> m_learners; // idle learner clones
+    mutable std::vector<char> m_model;          // serialized model for cloning
 
     std::shared_ptr<spdlog::logger> m_streamLogger;
 };
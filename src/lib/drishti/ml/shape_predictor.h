@@ -64,6 +64,7 @@
 #endif
 
 #include "drishti/core/arithmetic.h"
+#include "drishti/core/AlignedAllocator.h"
 
 // clang-format off
 #if DRISHTI_SERIALIZE_WITH_BOOST
@@ -75,6 +76,7 @@
 #include <opencv2/core/core.hpp>
 
 // STL
+#include <algorithm>
 #include <deque>
 
 DRISHTI_ML_NAMESPACE_BEGIN
@@ -727,6 +729,7 @@ public:
          (i.e. there need to be the right number of leaves given the number of splits in the tree)
          !*/
     {
+        fold_pca();
     }
 
     void getShapeUpdates(std::vector<float>& values, bool pca)
@@ -807,6 +810,7 @@ public:
                   (i.e. there need to be the right number of leaves given the number of splits in the tree)
         !*/
     {
+        fold_pca();
         anchor_idx.resize(pixel_coordinates.size());
         deltas.resize(pixel_coordinates.size());
         // Each cascade uses a different set of pixels for its features.  We compute
@@ -835,94 +839,320 @@ public:
         memcpy(&dst(0), back_projection.ptr<float>(), sizeof(float) * back_projection.cols);
     }
 
+    // Cache the PCA back projection as an aligned (padded) row major basis so that inference can
+    // maintain the euclidean shape incrementally with one deferred axpy per PCA coefficient update
+    // instead of a cv::Mat based back_project() per stage iteration.
+    void fold_pca()
+    {
+        m_pca_basis.clear();
+        m_pca_offset.clear();
+        m_pca_stride = 0;
+        if (m_pca)
+        {
+            cv::Mat1f basis, offset;
+            m_pca->getBackProjection(basis, offset);
+            m_pca_stride = int(core::alignedLength<float>(basis.cols));
+            m_pca_basis.assign(basis.rows * m_pca_stride, 0.f);
+            for (int i = 0; i < basis.rows; i++)
+            {
+                memcpy(&m_pca_basis[i * m_pca_stride], basis.ptr<float>(i), sizeof(float) * basis.cols);
+            }
+            m_pca_offset.assign(offset.begin(), offset.end());
+        }
+    }
+
+    // Project the starter shape and reset the euclidean estimate to the PCA offset (no components):
+    void begin_shape(fshape& current_shape, fshape& current_shape_full_, int& basis_dim) const
+    {
+        basis_dim = 0;
+        if (m_pca)
+        {
+            project(*m_pca, current_shape, current_shape_full_);
+            current_shape.set_size(m_pca_offset.size());
+            memcpy(&current_shape(0), m_pca_offset.data(), sizeof(float) * m_pca_offset.size());
+        }
+    }
+
+    // Include (or remove) PCA components so that the euclidean shape reflects components [0, dim):
+    void set_basis_dim(const fshape& current_shape_full_, fshape& current_shape, int& basis_dim, int dim) const
+    {
+        const float sign = (dim > basis_dim) ? 1.f : -1.f;
+        for (int j = std::min(basis_dim, dim); j < std::max(basis_dim, dim); j++)
+        {
+            core::axpy32f(sign * current_shape_full_(j), &m_pca_basis[j * m_pca_stride], &current_shape(0), int(current_shape.size()));
+        }
+        basis_dim = dim;
+    }
+
+    // Scratch buffers for a single inference call.  The model itself is not modified by inference,
+    // so one shape_predictor instance can be shared by any number of threads as long as each thread
+    // uses its own workspace (see get_thread_workspace()).  Buffers are reused across calls.
+    struct workspace
+    {
+        std::vector<float> feature_pixel_values;
+        fshape current_shape, current_shape_full_, update, previous_shape;
+
+        // Batched (multi-initialization) state:
+        std::vector<fshape> current_shapes, current_shapes_full_;
+        std::vector<int> basis_dims;
+
+        // Per caller stream logger (overrides m_streamLogger), so a model shared by several
+        // estimator clones is never written to when one of them installs a logger:
+        spdlog::logger* logger = nullptr;
+    };
+
+    spdlog::logger* get_logger(const workspace& ws) const
+    {
+        return ws.logger ? ws.logger : m_streamLogger.get();
+    }
+
+    static workspace& get_thread_workspace()
+    {
+        thread_local workspace ws;
+        return ws;
+    }
+
     template <typename image_type>
     dlib::full_object_detection operator()(
         const image_type& img,
         const dlib::rectangle& rect,
-        fshape starter_shape,
+        const fshape& starter_shape,
+        int iters = 2,
+        int stages = std::numeric_limits<int>::max(),
+        float early_exit_threshold = 0.f,
+        int* stages_used = nullptr,
+        std::vector<float>* update_norms = nullptr) const
+    {
+        return (*this)(get_thread_workspace(), img, rect, starter_shape, iters, stages, early_exit_threshold, stages_used, update_norms);
+    }
+
+    template <typename image_type>
+    dlib::full_object_detection operator()(
+        workspace& ws,
+        const image_type& img,
+        const dlib::rectangle& rect,
+        const fshape& starter_shape,
+        int iters = 2,
+        int stages = std::numeric_limits<int>::max(),
+        float early_exit_threshold = 0.f,
+        int* stages_used = nullptr,
+        std::vector<float>* update_norms = nullptr) const
+    {
+        DRISHTI_STREAM_LOG_FUNC(5, 1, get_logger(ws));
+
+        // Track the norm of the per stage shape update for early termination (and threshold learning):
+        const bool do_track_update = (early_exit_threshold > 0.f) || update_norms;
+        int stage_count = 0;
+
+        int basis_dim = 0;
+        fshape& current_shape = ws.current_shape;
+        fshape& current_shape_full_ = ws.current_shape_full_; // for PCA mode
+        current_shape = starter_shape;
+        begin_shape(current_shape, current_shape_full_, basis_dim);
+
+        size_t forestCount = std::min(int(forests.size()), stages);
+        for (unsigned long iter = 0; iter < forestCount; ++iter)
+        {
+            float update_norm = 0.f;
+            for (int k = 0; k < iters; k++)
+            {
+                update_norm = apply_stage(ws, img, rect, iter, current_shape, current_shape_full_, basis_dim, do_track_update);
+            }
+
+            stage_count = int(iter) + 1;
+
+            if (update_norms)
+            {
+                update_norms->push_back(update_norm);
+            }
+
+            // The cascade has converged for this sample when the stage update falls below the learned threshold:
+            if ((early_exit_threshold > 0.f) && (update_norm < early_exit_threshold))
+            {
+                break;
+            }
+        }
+
+        if (stages_used)
+        {
+            *stages_used = stage_count;
+        }
+
+        return to_detection(ws, img, rect, current_shape, current_shape_full_, basis_dim);
+    }
+
+    // Batched regression for multiple initializations of the same object: the stage loop is the outer
+    // loop, so each stage's forest stays hot in the cache across the initializations, and the per
+    // thread scratch buffers are reused.  Each initialization still extracts its own features and
+    // traverses the forest itself (the features are indexed by its shape), so K initializations
+    // cost about K single runs, minus the cache misses.
+    template <typename image_type>
+    void operator()(
+        const image_type& img,
+        const dlib::rectangle& rect,
+        const std::vector<fshape>& starter_shapes,
+        std::vector<dlib::full_object_detection>& detections,
         int iters = 2,
         int stages = std::numeric_limits<int>::max()) const
     {
-        DRISHTI_STREAM_LOG_FUNC(5, 1, m_streamLogger);
-        using namespace impl;
+        (*this)(get_thread_workspace(), img, rect, starter_shapes, detections, iters, stages);
+    }
 
-        bool do_pca = m_pca ? true : false;
+    template <typename image_type>
+    void operator()(
+        workspace& ws,
+        const image_type& img,
+        const dlib::rectangle& rect,
+        const std::vector<fshape>& starter_shapes,
+        std::vector<dlib::full_object_detection>& detections,
+        int iters = 2,
+        int stages = std::numeric_limits<int>::max()) const
+    {
+        DRISHTI_STREAM_LOG_FUNC(5, 8, get_logger(ws));
 
-        cv::Mat1f cs;
-        fshape current_shape = starter_shape, current_shape_full_; // for PCA mode
+        std::vector<int>& basis_dims = ws.basis_dims;
+        std::vector<fshape>& current_shapes = ws.current_shapes;
+        std::vector<fshape>& current_shapes_full_ = ws.current_shapes_full_;
 
-        if (do_pca)
+        basis_dims.assign(starter_shapes.size(), 0);
+        current_shapes.resize(starter_shapes.size());
+        current_shapes_full_.resize(starter_shapes.size());
+        for (std::size_t i = 0; i < current_shapes.size(); i++)
         {
-            project(*m_pca, starter_shape, current_shape_full_);
+            current_shapes[i] = starter_shapes[i];
+            begin_shape(current_shapes[i], current_shapes_full_[i], basis_dims[i]);
         }
 
-        std::vector<float> feature_pixel_values;
         size_t forestCount = std::min(int(forests.size()), stages);
         for (unsigned long iter = 0; iter < forestCount; ++iter)
         {
-            auto& cs_ = current_shape;
-            auto& is_ = initial_shape; // this is used to map pose indexed features to current shape
-
-            for (int k = 0; k < iters; k++)
+            for (std::size_t i = 0; i < current_shapes.size(); i++)
             {
-                // Previously had for loop
-                DRISHTI_STREAM_LOG_FUNC(5, 2, m_streamLogger);
-
-                if (do_pca)
+                for (int k = 0; k < iters; k++)
                 {
-                    // Get euclidean model for current shape space estimate:
-                    int current_pca_dim = int(forests[iter][0].leaf_values[0].size());
-                    back_project(*m_pca, current_pca_dim, current_shape_full_, current_shape);
+                    apply_stage(ws, img, rect, iter, current_shapes[i], current_shapes_full_[i], basis_dims[i], false);
                 }
+            }
+        }
 
-                DRISHTI_STREAM_LOG_FUNC(5, 3, m_streamLogger);
-                if (interpolated_features.size())
-                {
-                    extract_feature_pixel_values(img, rect, cs_, interpolated_features[iter], feature_pixel_values);
-                }
-                else
-                {
-                    extract_feature_pixel_values(img, rect, cs_, is_, anchor_idx[iter], deltas[iter], feature_pixel_values, m_ellipse_count, m_do_affine);
-                }
+        detections.resize(current_shapes.size());
+        for (std::size_t i = 0; i < current_shapes.size(); i++)
+        {
+            detections[i] = to_detection(ws, img, rect, current_shapes[i], current_shapes_full_[i], basis_dims[i]);
+        }
+    }
+
+    // Apply one iteration of cascade stage 'iter' and return the norm of the shape update (if requested):
+    template <typename image_type>
+    float apply_stage(
+        workspace& ws,
+        const image_type& img,
+        const dlib::rectangle& rect,
+        unsigned long iter,
+        fshape& current_shape,
+        fshape& current_shape_full_,
+        int& basis_dim,
+        bool do_track_update) const
+    {
+        DRISHTI_STREAM_LOG_FUNC(5, 2, get_logger(ws));
+        using namespace impl;
+
+        bool do_pca = m_pca ? true : false;
+
+        auto& cs_ = current_shape;
+        auto& is_ = initial_shape; // this is used to map pose indexed features to current shape
+
+        if (do_pca)
+        {
+            // Get euclidean model for current shape space estimate (only components changed by the stage dimension):
+            int current_pca_dim = int(forests[iter][0].leaf_values[0].size());
+            set_basis_dim(current_shape_full_, current_shape, basis_dim, current_pca_dim);
+        }
+
+        DRISHTI_STREAM_LOG_FUNC(5, 3, get_logger(ws));
+        std::vector<float>& feature_pixel_values = ws.feature_pixel_values;
+        if (interpolated_features.size())
+        {
+            extract_feature_pixel_values(img, rect, cs_, interpolated_features[iter], feature_pixel_values);
+        }
+        else
+        {
+            extract_feature_pixel_values(img, rect, cs_, is_, anchor_idx[iter], deltas[iter], feature_pixel_values, m_ellipse_count, m_do_affine);
+        }
 
-                fshape current_shape_;
-                auto& active_shape = do_pca ? current_shape_ : current_shape;
+        fshape& current_shape_ = ws.update;
+        fshape& previous_shape = ws.previous_shape;
+        if (do_pca)
+        {
+            current_shape_.set_size(forests[iter][0].leaf_values[0].size()); // no-op when the size is unchanged
+            current_shape_ = 0;
+        }
+        auto& active_shape = do_pca ? current_shape_ : current_shape;
+        if (do_track_update)
+        {
+            previous_shape = current_shape;
+        }
 
-                DRISHTI_STREAM_LOG_FUNC(5, 4, m_streamLogger);
+        DRISHTI_STREAM_LOG_FUNC(5, 4, get_logger(ws));
 #if DRISHTI_BUILD_REGRESSION_FIXED_POINT
-                // Fixed point is currently only working for PCA in most cases (check numerical overflow)
-                DVec16s shape_accumulator;
-                for (auto& f : forests[iter])
-                {
-                    add16sAnd16s(shape_accumulator, f(feature_pixel_values, Fixed(), m_npd), shape_accumulator);
-                }
-                active_shape.set_size(shape_accumulator.size());
-                for (int i = 0; i < shape_accumulator.size(); i++)
-                {
-                    active_shape(i) = float(shape_accumulator(i)) / float(1 << FIXED_PRECISION);
-                }
+        // Fixed point is currently only working for PCA in most cases (check numerical overflow)
+        DVec16s shape_accumulator;
+        for (auto& f : forests[iter])
+        {
+            add16sAnd16s(shape_accumulator, f(feature_pixel_values, Fixed(), m_npd), shape_accumulator);
+        }
+        active_shape.set_size(shape_accumulator.size());
+        for (int i = 0; i < shape_accumulator.size(); i++)
+        {
+            active_shape(i) = float(shape_accumulator(i)) / float(1 << FIXED_PRECISION);
+        }
 
 #else  /* else don't DRISHTI_BUILD_REGRESSION_FIXED_POINT */
-                for (auto& f : forests[iter])
-                {
-                    add32F(active_shape, f(feature_pixel_values, m_npd), active_shape);
-                }
+        for (auto& f : forests[iter])
+        {
+            add32F(active_shape, f(feature_pixel_values, m_npd), active_shape);
+        }
 #endif /* DRISHTI_BUILD_REGRESSION_FIXED_POINT */
 
-                if (do_pca)
-                {
-                    DRISHTI_STREAM_LOG_FUNC(5, 5, m_streamLogger);
-                    dlib::set_rowm(current_shape_full_, dlib::range(0, current_shape_.size() - 1)) += current_shape_;
-                }
+        if (do_pca)
+        {
+            // Deferred back projection of the accumulated stage update (single GEMV):
+            DRISHTI_STREAM_LOG_FUNC(5, 5, get_logger(ws));
+            dlib::set_rowm(current_shape_full_, dlib::range(0, current_shape_.size() - 1)) += current_shape_;
+            for (int j = 0; j < current_shape_.size(); j++)
+            {
+                core::axpy32f(current_shape_(j), &m_pca_basis[j * m_pca_stride], &current_shape(0), int(current_shape.size()));
             }
         }
 
-        if (do_pca)
+        float update_norm = 0.f;
+        if (do_track_update)
+        {
+            // Measured on the back projected shape in both modes: the standardized PCA basis
+            // is scaled by the per dimension sigmas, so the coefficient norm would not match
+            update_norm = float(dlib::length(current_shape - previous_shape));
+        }
+        return update_norm;
+    }
+
+    // Convert the current shape estimate into a full_object_detection in the image coordinate system:
+    template <typename image_type>
+    dlib::full_object_detection to_detection(
+        const workspace& ws,
+        const image_type& img,
+        const dlib::rectangle& rect,
+        fshape& current_shape,
+        fshape& current_shape_full_,
+        int& basis_dim) const
+    {
+        using namespace impl;
+
+        if (m_pca)
         {
             // Convert the final model back to euclidean
-            DRISHTI_STREAM_LOG_FUNC(5, 6, m_streamLogger);
+            DRISHTI_STREAM_LOG_FUNC(5, 6, get_logger(ws));
             int current_pca_dim = int(forests.back()[0].leaf_values[0].size());
-            back_project(*m_pca, current_pca_dim, current_shape_full_, current_shape);
+            set_basis_dim(current_shape_full_, current_shape, basis_dim, current_pca_dim);
         }
 
         // convert the current_shape into a full_object_detection
@@ -936,7 +1166,7 @@ public:
         }
 
         // Convert trailing ellipse back to standard form:
-        DRISHTI_STREAM_LOG_FUNC(5, 7, m_streamLogger);
+        DRISHTI_STREAM_LOG_FUNC(5, 7, get_logger(ws));
         for (int i = 0; i < m_ellipse_count; i++)
         {
             std::vector<float> phi(5, 0.f);
@@ -1036,10 +1266,19 @@ public:
 
     // PCA reduction:
     std::shared_ptr<drishti::ml::StandardizedPCA> m_pca; // global pca
+
+    // Folded PCA back projection (see fold_pca()):
+    core::AlignedVector<float> m_pca_basis; // 32 byte aligned rows w/ stride m_pca_stride
+    core::AlignedVector<float> m_pca_offset;
+    int m_pca_stride = 0;
     int m_ellipse_count = 0;
     bool m_npd = false;
     bool m_do_affine = false;
 
+    // Stop the cascade when the norm of a stage update falls below this value (0 == disabled).
+    // This is learned offline on validation data with learn_early_exit_threshold().
+    float m_early_exit_threshold = 0.f;
+
     // Use interpolated "line indexed" features (stead of the relative encoding above):
     std::vector<std::vector<InterpolatedFeature>> interpolated_features;
 
@@ -1067,6 +1306,7 @@ public:
         _lambda = 0.1;
         _num_test_splits = 20;
         _feature_pool_region_padding = 0;
+        _warm_start_noise = 0;
         _verbose = false;
     }
 
@@ -1212,6 +1452,20 @@ public:
         _feature_pool_region_padding = padding;
     }
 
+    double get_warm_start_noise() const
+    {
+        return _warm_start_noise;
+    }
+    void set_warm_start_noise(
+        double noise)
+    /*!
+        Train a reduced cascade for warm starts: initial shapes are the targets perturbed by
+        gaussian noise with this standard deviation (in normalized shape coordinates).
+    !*/
+    {
+        _warm_start_noise = noise;
+    }
+
     void be_verbose()
     {
         _verbose = true;
@@ -1862,9 +2116,19 @@ private:
         mean_shape /= count;
 
         // now go pick random initial shapes
+        const long point_length = (long(mean_shape.size()) - (ellipse_count * 5)) / 2;
         for (unsigned long i = 0; i < samples.size(); ++i)
         {
-            if ((i % get_oversampling_amount()) == 0)
+            if (get_warm_start_noise() > 0.0)
+            {
+                // Warm start: perturb the target landmarks to simulate a prior from the previous frame
+                samples[i].current_shape = samples[i].target_shape;
+                for (long j = 0; j < point_length * 2; j++)
+                {
+                    samples[i].current_shape(j) += get_warm_start_noise() * rnd.get_random_gaussian();
+                }
+            }
+            else if ((i % get_oversampling_amount()) == 0)
             {
                 // The mean shape is what we really use as an initial shape so always
                 // include it in the training set as an example starting shape.
@@ -2005,6 +2269,7 @@ private:
     double _lambda;
     unsigned long _num_test_splits;
     double _feature_pool_region_padding;
+    double _warm_start_noise;
     bool _verbose;
 
     // experimental
@@ -2085,6 +2350,102 @@ double test_shape_predictor(
     return test_shape_predictor(sp, images, objects, no_scales);
 }
 
+namespace impl
+{
+template <
+    typename image_array>
+double test_shape_predictor_early_exit(
+    const shape_predictor& sp,
+    const image_array& images,
+    const std::vector<std::vector<dlib::full_object_detection>>& objects,
+    const std::vector<std::vector<double>>& scales,
+    int iters,
+    float early_exit_threshold,
+    double& mean_stages,
+    std::vector<float>* update_norms = nullptr)
+{
+    dlib::running_stats<double> rs, stages;
+    for (unsigned long i = 0; i < objects.size(); ++i)
+    {
+        for (unsigned long j = 0; j < objects[i].size(); ++j)
+        {
+            const double scale = scales.size() == 0 ? 1 : scales[i][j];
+
+            int stages_used = 0;
+            const auto& rect = objects[i][j].get_rect();
+            const auto& limit = std::numeric_limits<int>::max();
+            dlib::full_object_detection det = sp(images[i], rect, sp.initial_shape, iters, limit, early_exit_threshold, &stages_used, update_norms);
+            stages.add(stages_used);
+
+            for (unsigned long k = 0; k < det.num_parts(); ++k)
+            {
+                rs.add(length(det.part(k) - objects[i][j].part(k)) / scale);
+            }
+        }
+    }
+    mean_stages = stages.mean();
+    return rs.mean();
+}
+} // namespace impl
+
+// Learn the early exit threshold from a validation set: candidate thresholds are drawn from the
+// distribution of per stage update norms, and the largest one whose mean error stays within
+// (1 + max_error_increase) of the full cascade error is retained.  Returns 0 (disabled) if no
+// candidate satisfies the error budget.
+template <
+    typename image_array>
+float learn_early_exit_threshold(
+    const shape_predictor& sp,
+    const image_array& images,
+    const std::vector<std::vector<dlib::full_object_detection>>& objects,
+    const std::vector<std::vector<double>>& scales,
+    double max_error_increase = 0.01,
+    int iters = 1,
+    double* mean_stages = nullptr)
+{
+    std::vector<float> norms;
+    double stages_full = 0.0;
+    const double error_full = impl::test_shape_predictor_early_exit(sp, images, objects, scales, iters, 0.f, stages_full, &norms);
+    const double error_limit = error_full * (1.0 + max_error_increase);
+
+    if (mean_stages)
+    {
+        *mean_stages = stages_full;
+    }
+
+    if (norms.empty())
+    {
+        return 0.f;
+    }
+
+    std::sort(norms.begin(), norms.end());
+
+    float best = 0.f;
+    for (int q = 1; q <= 10; q++)
+    {
+        const float threshold = norms[(norms.size() * q) / 20]; // 5%, 10%, ..., 50%
+        if (threshold <= best)
+        {
+            continue;
+        }
+
+        double stages = 0.0;
+        const double error = impl::test_shape_predictor_early_exit(sp, images, objects, scales, iters, threshold, stages);
+        if (error > error_limit)
+        {
+            break;
+        }
+
+        best = threshold;
+        if (mean_stages)
+        {
+            *mean_stages = stages;
+        }
+    }
+
+    return best;
+}
+
 #endif // !DRISHTI_BUILD_MIN_SIZE
 
 void serialize(const drishti::ml::shape_predictor& item, std::ostream& out);
@@ -2146,7 +2507,7 @@ DRISHTI_END_NAMESPACE(boost)         // namespace boost
 
 BOOST_CLASS_IMPLEMENTATION(_SHAPE_PREDICTOR, boost::serialization::object_class_info);
 BOOST_CLASS_TRACKING(_SHAPE_PREDICTOR, boost::serialization::track_always);
-BOOST_CLASS_VERSION(_SHAPE_PREDICTOR, 4);
+BOOST_CLASS_VERSION(_SHAPE_PREDICTOR, 5);
 
 #endif // DRISHTI_SERIALIZE_WITH_BOOST
 
@@ -2160,7 +2521,7 @@ DRISHTI_BEGIN_NAMESPACE(cereal)
 #include "drishti/ml/shape_predictor_archive.h"
 DRISHTI_END_NAMESPACE(cereal)
 
-CEREAL_CLASS_VERSION(_SHAPE_PREDICTOR, 4);
+CEREAL_CLASS_VERSION(_SHAPE_PREDICTOR, 5);
 #endif // DRISHTI_SERIALIZE_WITH_CEREAL
 
 #endif // __drishti_ml_shape_predictor_h__
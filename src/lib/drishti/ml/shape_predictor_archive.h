@@ -166,6 +166,16 @@ void serialize(Archive& ar, drishti::ml::shape_predictor& sp, const unsigned int
     {
         ar& sp.interpolated_features;
     }
+
+    if (version >= 5)
+    {
+        ar& sp.m_early_exit_threshold;
+    }
+
+    if (Archive::is_loading::value)
+    {
+        sp.fold_pca();
+    }
 }
 
 //#endif /* shape_predictor_archive_h */
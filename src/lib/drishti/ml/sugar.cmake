@@ -16,6 +16,8 @@ sugar_files(DRISHTI_ML_SRCS
   PCA.cpp
   RegressionTreeEnsembleShapeEstimator.cpp
   ShapeEstimator.cpp
+  HistogramBooster.cpp
+  TreeEnsemble.cpp
   XGBooster.cpp
   )
 
@@ -45,6 +47,8 @@ sugar_files(DRISHTI_ML_HDRS_PUBLIC
   drishti_ml.h
   shape_predictor.h
   shape_predictor_archive.h
+  HistogramBooster.h
+  TreeEnsemble.h
   XGBooster.h
   XGBoosterImpl.h  
   Booster.h
@@ -30,8 +30,15 @@
 // clang-format on
 
 #include "drishti/ml/RegressionTreeEnsembleShapeEstimator.h"
+#include "drishti/ml/RTEShapeEstimatorImpl.h" // warm start tail
+#include "drishti/ml/shape_predictor.h"
+#include "drishti/core/Parallel.h"
+
+#include <dlib/array.h>
+#include <dlib/array2d.h>
 
 #include <fstream>
+#include <numeric>
 
 // https://code.google.com/p/googletest/wiki/Primer
 
@@ -180,4 +187,381 @@ TEST_F(RTEShapeEstimatorTest, ShapeSerialization)
     /* int code = */ (*m_shapePredictor)(m_image, points, mask);
 }
 
+TEST_F(RTEShapeEstimatorTest, EarlyExit)
+{
+    std::vector<bool> mask;
+    std::vector<cv::Point2f> points;
+    (*m_shapePredictor)(m_image, points, mask);
+    const int stagesFull = m_shapePredictor->getStagesUsed();
+    ASSERT_GT(stagesFull, 0);
+
+    // Early exit can only reduce the number of stages (and is a no-op for models w/o a threshold):
+    m_shapePredictor->setDoEarlyExit(true);
+    points.clear();
+    mask.clear();
+    (*m_shapePredictor)(m_image, points, mask);
+    m_shapePredictor->setDoEarlyExit(false);
+    ASSERT_GT(m_shapePredictor->getStagesUsed(), 0);
+    ASSERT_LE(m_shapePredictor->getStagesUsed(), stagesFull);
+
+    // The count belongs to the estimator that made the call, not to the thread:
+    auto clone = m_shapePredictor->clone();
+    ASSERT_NE(clone, nullptr);
+    clone->setStagesHint(1);
+    points.clear();
+    mask.clear();
+    (*clone)(m_image, points, mask);
+    EXPECT_EQ(clone->getStagesUsed(), 1);
+    EXPECT_EQ(m_shapePredictor->getStagesUsed(), 0);
+}
+
+#if !DRISHTI_BUILD_MIN_SIZE
+using ImageArray = dlib::array<dlib::array2d<uint8_t>>;
+using ObjectSet = std::vector<std::vector<dlib::full_object_detection>>;
+
+// Bright squares (4 corner landmarks) in noise, with jittered object boxes:
+static void createSquares(int count, cv::RNG& rng, ImageArray& images, ObjectSet& objects)
+{
+    images.resize(count);
+    objects.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        cv::Mat1b image(64, 64);
+        rng.fill(image, cv::RNG::UNIFORM, 0, 64);
+
+        const int size = rng.uniform(24, 36), x = rng.uniform(8, 56 - size), y = rng.uniform(8, 56 - size);
+        image(cv::Rect(x, y, size, size)).setTo(200);
+        dlib::assign_image(images[i], dlib::cv_image<uint8_t>(image));
+
+        const std::vector<dlib::point> parts{ { x, y }, { x + size, y }, { x + size, y + size }, { x, y + size } };
+        const int dx = rng.uniform(-3, 4), dy = rng.uniform(-3, 4);
+        objects[i] = { dlib::full_object_detection(dlib::rectangle(x + dx, y + dy, x + dx + size, y + dy + size), parts) };
+    }
+}
+
+// The threshold is learned on a validation split and the stage savings are measured on held out samples:
+TEST(ShapePredictor, EarlyExit)
+{
+    cv::RNG rng(1);
+    ImageArray imagesTrain, imagesValidation, imagesTest;
+    ObjectSet objectsTrain, objectsValidation, objectsTest;
+    createSquares(64, rng, imagesTrain, objectsTrain);
+    createSquares(32, rng, imagesValidation, objectsValidation);
+    createSquares(32, rng, imagesTest, objectsTest);
+
+    // PCA model, so the update norm is measured on the back projected shapes:
+    const std::vector<int> dimensions{ 4, 4, 6, 6, 8, 8, 8, 8 };
+    drishti::ml::shape_predictor_trainer trainer;
+    trainer.set_cascade_depth(dimensions.size());
+    trainer.set_tree_depth(3);
+    trainer.set_num_trees_per_cascade_level(50);
+    trainer.set_oversampling_amount(5);
+    trainer.set_feature_pool_size(100);
+    trainer.set_num_test_splits(10);
+    const drishti::ml::shape_predictor sp = trainer.train(imagesTrain, objectsTrain, dimensions);
+
+    double stagesValidation = 0.0;
+    const float threshold = drishti::ml::learn_early_exit_threshold(sp, imagesValidation, objectsValidation, {}, 0.05, 1, &stagesValidation);
+    ASSERT_GT(threshold, 0.f);
+    ASSERT_LT(stagesValidation, double(dimensions.size()));
+
+    double stagesFull = 0.0, stagesEarly = 0.0;
+    const double errorFull = drishti::ml::impl::test_shape_predictor_early_exit(sp, imagesTest, objectsTest, {}, 1, 0.f, stagesFull);
+    const double errorEarly = drishti::ml::impl::test_shape_predictor_early_exit(sp, imagesTest, objectsTest, {}, 1, threshold, stagesEarly);
+    EXPECT_EQ(stagesFull, double(dimensions.size()));
+    EXPECT_LT(stagesEarly, stagesFull);
+    EXPECT_LT(errorEarly, errorFull * 1.25);
+
+    // Each sample exits at the first stage whose update falls below the threshold:
+    for (int i = 0; i < imagesTest.size(); i++)
+    {
+        int stagesUsed = 0;
+        std::vector<float> norms;
+        const auto& rect = objectsTest[i][0].get_rect();
+        sp(imagesTest[i], rect, sp.initial_shape, 1, std::numeric_limits<int>::max(), threshold, &stagesUsed, &norms);
+        ASSERT_EQ(norms.size(), stagesUsed);
+        for (int j = 0; j < (stagesUsed - 1); j++)
+        {
+            EXPECT_GE(norms[j], threshold);
+        }
+        if (stagesUsed < dimensions.size())
+        {
+            EXPECT_LT(norms.back(), threshold);
+        }
+    }
+}
+
+// The folded PCA basis (incremental axpy updates) gives the shapes of the StandardizedPCA back
+// projection of the coefficients at each stage, including stages that add or remove components:
+TEST(ShapePredictor, FoldedPCA)
+{
+    cv::RNG rng(1);
+    ImageArray imagesTrain, imagesTest;
+    ObjectSet objectsTrain, objectsTest;
+    createSquares(64, rng, imagesTrain, objectsTrain);
+    createSquares(16, rng, imagesTest, objectsTest);
+
+    const std::vector<int> dimensions{ 4, 4, 6, 8, 6, 8, 8, 8 };
+    drishti::ml::shape_predictor_trainer trainer;
+    trainer.set_cascade_depth(dimensions.size());
+    trainer.set_tree_depth(3);
+    trainer.set_num_trees_per_cascade_level(50);
+    trainer.set_oversampling_amount(5);
+    trainer.set_feature_pool_size(100);
+    trainer.set_num_test_splits(10);
+    const drishti::ml::shape_predictor sp = trainer.train(imagesTrain, objectsTrain, dimensions);
+    ASSERT_NE(sp.m_pca, nullptr);
+
+    const int iters = 2;
+    const float tolerance = 1e-4f; // normalized shape coordinates
+    drishti::ml::shape_predictor::workspace ws;
+    for (int i = 0; i < imagesTest.size(); i++)
+    {
+        const auto& rect = objectsTest[i][0].get_rect();
+
+        // Folded path, stage by stage as in shape_predictor::operator():
+        int basis_dim = 0;
+        drishti::ml::fshape shape = sp.initial_shape, coefficients;
+        sp.begin_shape(shape, coefficients, basis_dim);
+
+        drishti::ml::fshape reference(shape.size());
+        for (unsigned long iter = 0; iter < sp.forests.size(); iter++)
+        {
+            const int dim = int(sp.forests[iter][0].leaf_values[0].size());
+            for (int k = 0; k < iters; k++)
+            {
+                sp.apply_stage(ws, imagesTest[i], rect, iter, shape, coefficients, basis_dim, false);
+                ASSERT_EQ(basis_dim, dim);
+
+                // Reference: cv::Mat based back projection of the leading coefficients:
+                drishti::ml::fshape leading = coefficients;
+                drishti::ml::shape_predictor::back_project(*sp.m_pca, dim, leading, reference);
+                ASSERT_LT(dlib::max(dlib::abs(shape - reference)), tolerance) << "sample " << i << " stage " << iter;
+            }
+        }
+
+        // The detection matches the reference shape (up to the integer landmark rounding):
+        const dlib::full_object_detection detection = sp(imagesTest[i], rect, sp.initial_shape, iters);
+        const dlib::point_transform_affine tform_to_img = drishti::ml::impl::unnormalizing_tform(rect);
+        ASSERT_EQ(detection.num_parts(), reference.size() / 2);
+        for (int j = 0; j < detection.num_parts(); j++)
+        {
+            const auto p = tform_to_img(drishti::ml::impl::location(reference, j));
+            EXPECT_NEAR(detection.part(j).x(), p.x(), 1.0);
+            EXPECT_NEAR(detection.part(j).y(), p.y(), 1.0);
+        }
+    }
+}
+
+// Bright squares in noise, the object box is the whole crop (as in RTEShapeEstimator):
+static void createSquareCrops(int count, cv::RNG& rng, std::vector<cv::Mat1b>& crops, ImageArray& images, ObjectSet& objects)
+{
+    crops.resize(count);
+    images.resize(count);
+    objects.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        cv::Mat1b crop(48, 48);
+        rng.fill(crop, cv::RNG::UNIFORM, 0, 64);
+
+        const int size = rng.uniform(28, 35), x = (crop.cols - size) / 2 + rng.uniform(-3, 4), y = (crop.rows - size) / 2 + rng.uniform(-3, 4);
+        crop(cv::Rect(x, y, size, size)).setTo(200);
+        dlib::assign_image(images[i], dlib::cv_image<uint8_t>(crop));
+        crops[i] = crop;
+
+        const std::vector<dlib::point> parts{ { x, y }, { x + size, y }, { x + size, y + size }, { x, y + size } };
+        objects[i] = { dlib::full_object_detection(dlib::rectangle(0, 0, crop.cols, crop.rows), parts) };
+    }
+}
+
+// Mean landmark error in pixels:
+static float getError(const std::vector<cv::Point2f>& points, const dlib::full_object_detection& truth)
+{
+    float error = 0.f;
+    for (int j = 0; j < truth.num_parts(); j++)
+    {
+        error += float(cv::norm(points[j] - cv::Point2f(truth.part(j).x(), truth.part(j).y())));
+    }
+    return error / float(truth.num_parts());
+}
+
+// A tail cascade trained on perturbed targets refines nearby priors, bad priors fall back
+// to the full cascade from the mean shape:
+TEST(ShapePredictor, WarmStart)
+{
+    cv::RNG rng(1);
+    std::vector<cv::Mat1b> cropsTrain, cropsTest;
+    ImageArray imagesTrain, imagesTest;
+    ObjectSet objectsTrain, objectsTest;
+    createSquareCrops(64, rng, cropsTrain, imagesTrain, objectsTrain);
+    createSquareCrops(32, rng, cropsTest, imagesTest, objectsTest);
+
+    const std::vector<int> dimensions{ 4, 4, 6, 6, 8, 8, 8, 8 }, tailDimensions{ 8, 8, 8, 8 };
+    drishti::ml::shape_predictor_trainer trainer;
+    trainer.set_cascade_depth(dimensions.size());
+    trainer.set_tree_depth(3);
+    trainer.set_num_trees_per_cascade_level(50);
+    trainer.set_oversampling_amount(5);
+    trainer.set_feature_pool_size(100);
+    trainer.set_num_test_splits(10);
+    auto predictor = std::make_shared<drishti::ml::shape_predictor>(trainer.train(imagesTrain, objectsTrain, dimensions));
+
+    trainer.set_cascade_depth(tailDimensions.size());
+    trainer.set_warm_start_noise(0.05); // ~2.4 pixels
+    auto tail = std::make_shared<drishti::ml::shape_predictor>(trainer.train(imagesTrain, objectsTrain, tailDimensions));
+
+    drishti::ml::RTEShapeEstimator estimator;
+    estimator.m_impl = std::make_shared<drishti::ml::RTEShapeEstimator::Impl>();
+    estimator.m_impl->m_predictor = predictor;
+    estimator.m_impl->setTail(tail);
+
+    // Nearby priors (the truth perturbed by up to 2 pixels) converge with the tail:
+    int tracked = 0;
+    float errorPrior = 0.f, errorWarm = 0.f, errorFull = 0.f;
+    for (int i = 0; i < cropsTest.size(); i++)
+    {
+        const auto& truth = objectsTest[i][0];
+        std::vector<cv::Point2f> prior, warm, full;
+        for (int j = 0; j < truth.num_parts(); j++)
+        {
+            prior.emplace_back(truth.part(j).x() + rng.uniform(-2.f, 2.f), truth.part(j).y() + rng.uniform(-2.f, 2.f));
+        }
+
+        std::vector<bool> mask;
+        estimator(cropsTest[i], prior, warm, mask);
+        ASSERT_EQ(warm.size(), truth.num_parts());
+        tracked += int(estimator.getStagesUsed() == int(tailDimensions.size()));
+
+        estimator(cropsTest[i], full, mask);
+        errorPrior += getError(prior, truth);
+        errorWarm += getError(warm, truth);
+        errorFull += getError(full, truth);
+    }
+    EXPECT_GE(tracked, int(cropsTest.size() * 9 / 10));
+    EXPECT_LT(errorWarm, errorPrior);
+    EXPECT_LT(errorWarm, errorFull * 1.5f);
+
+    // Bad priors (wrong size, or moved by more than the max residual) give the mean shape fit:
+    for (int i = 0; i < cropsTest.size(); i++)
+    {
+        const auto& truth = objectsTest[i][0];
+        std::vector<cv::Point2f> prior, full, warm;
+        for (int j = 0; j < truth.num_parts(); j++)
+        {
+            prior.emplace_back(truth.part(j).x(), truth.part(j).y());
+        }
+
+        std::vector<bool> mask;
+        estimator(cropsTest[i], full, mask);
+
+        estimator.setWarmStartMaxResidual(0.f);
+        estimator(cropsTest[i], prior, warm, mask);
+        EXPECT_EQ(warm, full);
+        EXPECT_EQ(estimator.getStagesUsed(), int(dimensions.size()));
+        estimator.setWarmStartMaxResidual(0.1f);
+
+        prior.pop_back();
+        estimator(cropsTest[i], prior, warm, mask);
+        EXPECT_EQ(warm, full);
+    }
+}
+#endif // !DRISHTI_BUILD_MIN_SIZE
+
+// Mean variance of the multi-initialization estimate:
+static float getMeanVariance(const drishti::ml::RTEShapeEstimator& estimator, const cv::Mat& crop)
+{
+    std::vector<bool> mask;
+    std::vector<cv::Point2f> points;
+    std::vector<float> variance;
+    estimator(crop, points, mask, variance);
+    return std::accumulate(variance.begin(), variance.end(), 0.f) / float(std::max(int(variance.size()), 1));
+}
+
+TEST_F(RTEShapeEstimatorTest, MultiInit)
+{
+    // A single init is the plain (single initialization) estimate, with no variance:
+    std::vector<bool> mask;
+    std::vector<cv::Point2f> points, points1;
+    std::vector<float> variance;
+    (*m_shapePredictor)(m_image, points, mask);
+    (*m_shapePredictor)(m_image, points1, mask, variance);
+    ASSERT_EQ(variance.size(), points.size());
+    EXPECT_EQ(points1, points);
+    for (const auto& v : variance)
+    {
+        EXPECT_EQ(v, 0.f);
+    }
+
+    // The median of perturbed inits stays close to the single init estimate:
+    m_shapePredictor->setInits(5);
+    std::vector<bool> mask5;
+    std::vector<cv::Point2f> points5;
+    std::vector<float> variance5;
+    (*m_shapePredictor)(m_image, points5, mask5, variance5);
+
+    ASSERT_EQ(points5.size(), points.size());
+    ASSERT_EQ(variance5.size(), points.size());
+    float error = 0.f;
+    for (int i = 0; i < points.size(); i++)
+    {
+        EXPECT_GE(variance5[i], 0.f);
+        error += float(cv::norm(points5[i] - points[i]));
+    }
+    EXPECT_LT(error / float(points.size()), 0.05f * float(m_image.cols));
+
+    // A poorly registered crop (shifted and scaled roi) gives a less consistent estimate:
+    cv::Mat padded;
+    const int border = m_image.cols / 4;
+    cv::copyMakeBorder(m_image, padded, border, border, border, border, cv::BORDER_REPLICATE);
+    const cv::Rect jittered(border + m_image.cols / 8, border - m_image.rows / 10, m_image.cols * 9 / 8, m_image.rows * 9 / 8);
+    const cv::Mat crop = padded(jittered).clone();
+    EXPECT_GT(getMeanVariance(*m_shapePredictor, crop), getMeanVariance(*m_shapePredictor, m_image));
+
+    m_shapePredictor->setInits(1);
+}
+
+TEST_F(RTEShapeEstimatorTest, ParallelClone)
+{
+    // A clone shares the model with the original estimator:
+    auto clone = m_shapePredictor->clone();
+    auto* estimator = dynamic_cast<drishti::ml::RTEShapeEstimator*>(clone.get());
+    ASSERT_NE(estimator, nullptr);
+    ASSERT_NE(estimator->m_impl, m_shapePredictor->m_impl);
+    EXPECT_EQ(estimator->m_impl->m_predictor, m_shapePredictor->m_impl->m_predictor);
+
+    // Shifted crops of the test image:
+    cv::Mat padded;
+    const int border = m_image.cols / 8;
+    cv::copyMakeBorder(m_image, padded, border, border, border, border, cv::BORDER_REPLICATE);
+    std::vector<cv::Mat> crops;
+    for (int y = 0; y < 4; y++)
+    {
+        for (int x = 0; x < 4; x++)
+        {
+            const cv::Point tl(border + (x - 2) * border / 4, border + (y - 2) * border / 4);
+            crops.push_back(padded(cv::Rect(tl, m_image.size())).clone());
+        }
+    }
+
+    std::vector<std::vector<cv::Point2f>> serial(crops.size()), parallel(crops.size());
+    for (int i = 0; i < crops.size(); i++)
+    {
+        std::vector<bool> mask;
+        (*m_shapePredictor)(crops[i], serial[i], mask);
+    }
+
+    // One clone called from several threads at once gives the serial results:
+    drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
+        std::vector<bool> mask;
+        (*estimator)(crops[i], parallel[i], mask);
+    };
+    cv::parallel_for_({ 0, int(crops.size()) }, harness, 4);
+
+    for (int i = 0; i < crops.size(); i++)
+    {
+        ASSERT_FALSE(serial[i].empty());
+        EXPECT_EQ(parallel[i], serial[i]);
+    }
+}
+
 END_EMPTY_NAMESPACE
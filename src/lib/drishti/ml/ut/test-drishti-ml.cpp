@@ -10,6 +10,10 @@
 
 #include <gtest/gtest.h>
 
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
 extern const char* modelFilename;
 extern const char* imageFilename;
 extern const char* truthFilename;
@@ -18,7 +22,10 @@ extern bool isTextArchive;
 
 #include "drishti/ml/RegressionTreeEnsembleShapeEstimator.h"
 #include "drishti/ml/XGBooster.h"
+#include "drishti/ml/TreeEnsemble.h"
+#include "drishti/ml/HistogramBooster.h"
 #include "drishti/ml/PCA.h"
+#include "drishti/core/Parallel.h"
 
 // clang-format off
 #if DRISHTI_SERIALIZE_WITH_BOOST
@@ -55,6 +62,362 @@ TEST(XGBooster, XGBoosterInit)
     ASSERT_EQ(true, true);
 }
 
+#if !DRISHTI_BUILD_MIN_SIZE
+static void fitXGBooster(drishti::ml::XGBooster& booster, MatrixType<float>& features, int samples, bool regression, int levels = 0)
+{
+    const int dim = 8;
+    cv::RNG rng(1);
+    std::vector<float> values(samples);
+    features.resize(samples, std::vector<float>(dim));
+    for (int i = 0; i < samples; i++)
+    {
+        for (auto& f : features[i])
+        {
+            f = rng.uniform(-1.f, 1.f);
+            if (levels > 0)
+            {
+                f = std::round(f * levels) / levels;
+            }
+        }
+        const float y = std::sin(features[i][0] * 3.f) + features[i][1] * features[i][2];
+        values[i] = regression ? y : float(y > 0.f);
+    }
+    booster.train(features, values);
+}
+
+// clang-format off
+#if DRISHTI_SERIALIZE_WITH_CEREAL && DRISHTI_BUILD_CEREAL_OUTPUT_ARCHIVES
+#  define DRISHTI_ML_DO_ARCHIVE_TESTS 1
+#elif DRISHTI_SERIALIZE_WITH_BOOST
+#  define DRISHTI_ML_DO_ARCHIVE_TESTS 1
+#endif
+// clang-format on
+
+#if DRISHTI_ML_DO_ARCHIVE_TESTS
+// In memory save/load round trip through the default archive:
+static void saveAndLoad(drishti::ml::XGBooster& booster, drishti::ml::XGBooster& loaded)
+{
+    std::stringstream ss;
+#if DRISHTI_SERIALIZE_WITH_CEREAL && DRISHTI_BUILD_CEREAL_OUTPUT_ARCHIVES
+    save_cpb(ss, booster);
+    load_cpb(ss, loaded);
+#else
+    save_pba_z(ss, booster);
+    load_pba_z(ss, loaded);
+#endif
+}
+#endif // DRISHTI_ML_DO_ARCHIVE_TESTS
+
+static void testXGBoosterCompiled(bool regression)
+{
+    drishti::ml::XGBooster::Recipe recipe;
+    recipe.numberOfTrees = 32;
+    recipe.maxDepth = 4;
+    recipe.featureSubsample = 1.0;
+    recipe.regression = regression;
+
+    MatrixType<float> features;
+    drishti::ml::XGBooster booster(recipe);
+    fitXGBooster(booster, features, 256, regression);
+
+    // Compiled ensemble must match the xgboost learner:
+    std::vector<float> predictions(features.size());
+    for (int i = 0; i < int(features.size()); i++)
+    {
+        predictions[i] = booster(features[i]);
+        EXPECT_NEAR(predictions[i], booster.predictReference(features[i]), 1e-5f);
+    }
+
+    // ... and must be safe to evaluate concurrently:
+    std::vector<float> concurrent(features.size());
+    drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
+        concurrent[i] = booster(features[i]);
+    };
+    cv::parallel_for_({ 0, int(features.size()) }, harness);
+    for (int i = 0; i < int(features.size()); i++)
+    {
+        EXPECT_EQ(predictions[i], concurrent[i]);
+    }
+}
+
+TEST(XGBooster, XGBoosterCompiledRegression)
+{
+    testXGBoosterCompiled(true);
+}
+
+TEST(XGBooster, XGBoosterCompiledLogistic)
+{
+    testXGBoosterCompiled(false);
+}
+
+TEST(XGBooster, XGBoosterReferenceConcurrent)
+{
+    drishti::ml::XGBooster::Recipe recipe;
+    recipe.numberOfTrees = 16;
+    recipe.maxDepth = 3;
+    recipe.featureSubsample = 1.0;
+
+    MatrixType<float> features;
+    drishti::ml::XGBooster booster(recipe);
+    booster.setThreads(2);
+    ASSERT_EQ(booster.getThreads(), 2);
+    fitXGBooster(booster, features, 128, true);
+
+    // Learner predictions from pooled instances must match the serial ones:
+    std::vector<float> serial(features.size()), concurrent(features.size());
+    for (int i = 0; i < int(features.size()); i++)
+    {
+        serial[i] = booster.predictReference(features[i]);
+    }
+    drishti::core::ParallelHomogeneousLambda harness = [&](int i) {
+        concurrent[i] = booster.predictReference(features[i]);
+    };
+    cv::parallel_for_({ 0, int(features.size()) }, harness);
+    for (int i = 0; i < int(features.size()); i++)
+    {
+        EXPECT_EQ(serial[i], concurrent[i]);
+    }
+}
+
+TEST(XGBooster, XGBoosterBatch)
+{
+    drishti::ml::XGBooster::Recipe recipe;
+    recipe.numberOfTrees = 16;
+    recipe.maxDepth = 3;
+    recipe.featureSubsample = 1.0;
+
+    // Enough rows to be split across threads, with padded rows:
+    MatrixType<float> features;
+    drishti::ml::XGBooster booster(recipe);
+    fitXGBooster(booster, features, 1000, true);
+
+    const int n = int(features[0].size());
+    cv::Mat1f padded(int(features.size()), n + 3, 0.f), outputs;
+    cv::Mat1f samples = padded.colRange(0, n);
+    for (int i = 0; i < samples.rows; i++)
+    {
+        std::copy(features[i].begin(), features[i].end(), samples[i]);
+    }
+
+    booster(samples, outputs);
+    ASSERT_EQ(outputs.rows, samples.rows);
+    ASSERT_EQ(outputs.cols, 1);
+    for (int i = 0; i < samples.rows; i++)
+    {
+        EXPECT_EQ(outputs(i), booster(features[i]));
+    }
+}
+
+TEST(XGBooster, MultiTreeEnsemble)
+{
+    drishti::ml::XGBooster::Recipe recipe;
+    recipe.numberOfTrees = 16;
+    recipe.maxDepth = 3;
+    recipe.featureSubsample = 1.0;
+
+    // Merge boosters trained on the same features into one multi-output ensemble:
+    MatrixType<float> features;
+    std::vector<drishti::ml::XGBooster> boosters;
+    drishti::ml::MultiTreeEnsemble ensemble;
+    for (int k = 0; k < 3; k++)
+    {
+        boosters.emplace_back(recipe);
+        fitXGBooster(boosters[k], features, 64 + k, true);
+        ASSERT_NE(boosters[k].getEnsemble(), nullptr);
+        ensemble.add(*boosters[k].getEnsemble());
+    }
+    ASSERT_EQ(ensemble.getOutputs(), int(boosters.size()));
+
+    // Batch prediction must match the per-dimension predictions:
+    const int n = int(features[0].size());
+    std::vector<float> data;
+    for (const auto& f : features)
+    {
+        data.insert(data.end(), f.begin(), f.end());
+    }
+    std::vector<float> outputs(features.size() * boosters.size());
+    ensemble.predict(data.data(), int(features.size()), n, n, outputs.data());
+    for (int i = 0; i < int(features.size()); i++)
+    {
+        for (int k = 0; k < boosters.size(); k++)
+        {
+            EXPECT_EQ(outputs[(i * boosters.size()) + k], boosters[k](features[i]));
+        }
+    }
+}
+
+TEST(XGBooster, TreeEnsemblePacked)
+{
+    drishti::ml::XGBooster::Recipe recipe;
+    recipe.numberOfTrees = 32;
+    recipe.maxDepth = 4;
+    recipe.featureSubsample = 1.0;
+
+    // Quantized features (like pixel differences) keep splits away from fp16 rounding of the thresholds:
+    MatrixType<float> features;
+    drishti::ml::XGBooster booster(recipe);
+    fitXGBooster(booster, features, 256, true, 64);
+    ASSERT_NE(booster.getEnsemble(), nullptr);
+    const auto& ensemble = *booster.getEnsemble();
+
+    using Precision = drishti::ml::TreeEnsemble::Precision;
+    const std::vector<std::pair<Precision, float>> tests{
+        { drishti::ml::TreeEnsemble::kFloat, 0.f },
+        { drishti::ml::TreeEnsemble::kHalf, 1e-3f },
+        { drishti::ml::TreeEnsemble::kInt8, 3e-2f }
+    };
+    for (const auto& test : tests)
+    {
+        drishti::ml::TreeEnsemble::Packed packed;
+        ASSERT_TRUE(ensemble.pack(test.first, packed));
+
+        drishti::ml::TreeEnsemble unpacked;
+        unpacked.unpack(packed);
+        ASSERT_EQ(unpacked.size(), ensemble.size());
+        for (const auto& f : features)
+        {
+            EXPECT_NEAR(unpacked.predict(f), ensemble.predict(f), test.second);
+        }
+    }
+
+    // There is nothing to pack in place of a learner without trees:
+    drishti::ml::TreeEnsemble::Packed packed;
+    EXPECT_FALSE(drishti::ml::TreeEnsemble().pack(drishti::ml::TreeEnsemble::kHalf, packed));
+}
+
+#if DRISHTI_ML_DO_ARCHIVE_TESTS
+// A reduced precision request for a learner without a compiled ensemble must keep the learner:
+TEST(XGBooster, TreeEnsemblePackedEmpty)
+{
+    drishti::ml::XGBooster::Recipe recipe;
+    recipe.numberOfTrees = 0;
+
+    MatrixType<float> features;
+    drishti::ml::XGBooster booster(recipe);
+    fitXGBooster(booster, features, 64, true);
+    ASSERT_EQ(booster.getEnsemble(), nullptr);
+
+    booster.setPrecision(drishti::ml::TreeEnsemble::kHalf);
+
+    drishti::ml::XGBooster loaded;
+    saveAndLoad(booster, loaded);
+    EXPECT_EQ(loaded.getPrecision(), drishti::ml::TreeEnsemble::kFloat);
+    for (const auto& f : features)
+    {
+        EXPECT_EQ(loaded.predictReference(f), booster.predictReference(f));
+    }
+}
+
+// Ensembles without a learner can only be stored packed, anything else is an error:
+TEST(XGBooster, TreeEnsembleUnpackable)
+{
+    drishti::ml::HistogramBooster::Recipe recipe;
+    recipe.numberOfTrees = 1;
+    recipe.maxDepth = 1;
+    recipe.dataSubsample = 1.0;
+    recipe.featureSubsample = 1.0;
+
+    // Only the last feature (beyond the packed feature range) is informative:
+    const int samples = 16, dim = 0x7fff + 2;
+    cv::Mat1f features(samples, dim, 0.f), targets(samples, 1);
+    for (int i = 0; i < samples; i++)
+    {
+        features(i, dim - 1) = targets(i, 0) = float(i % 2);
+    }
+
+    std::vector<drishti::ml::TreeEnsemble> ensembles;
+    drishti::ml::HistogramBooster(recipe).train(features, targets, ensembles);
+    ASSERT_EQ(ensembles.size(), 1);
+
+    drishti::ml::TreeEnsemble::Packed packed;
+    ASSERT_FALSE(ensembles[0].pack(drishti::ml::TreeEnsemble::kFloat, packed));
+
+    drishti::ml::XGBooster booster, loaded;
+    booster.setEnsemble(ensembles[0]);
+    EXPECT_THROW(saveAndLoad(booster, loaded), std::runtime_error);
+    EXPECT_THROW(booster.write(std::string(outputDirectory) + "/unpackable.xgb"), std::runtime_error);
+}
+
+// Native (HistogramBooster) ensembles are stored without a learner:
+TEST(XGBooster, TreeEnsembleNative)
+{
+    drishti::ml::HistogramBooster::Recipe recipe;
+    recipe.numberOfTrees = 32;
+    recipe.maxDepth = 4;
+
+    const int samples = 256, dim = 8;
+    cv::RNG rng(1);
+    cv::Mat1f features(samples, dim), targets(samples, 1);
+    rng.fill(features, cv::RNG::UNIFORM, -1.f, 1.f);
+    for (int i = 0; i < samples; i++)
+    {
+        targets(i, 0) = std::sin(features(i, 0) * 3.f) + features(i, 1) * features(i, 2);
+    }
+
+    std::vector<drishti::ml::TreeEnsemble> ensembles;
+    drishti::ml::HistogramBooster(recipe).train(features, targets, ensembles);
+
+    drishti::ml::XGBooster booster, loaded;
+    booster.setEnsemble(ensembles[0]);
+    saveAndLoad(booster, loaded);
+    ASSERT_NE(loaded.getEnsemble(), nullptr);
+
+    cv::Mat1f expected, actual;
+    booster(features, expected);
+    loaded(features, actual);
+    EXPECT_EQ(cv::norm(expected, actual, cv::NORM_INF), 0.0);
+}
+#endif // DRISHTI_ML_DO_ARCHIVE_TESTS
+#endif // !DRISHTI_BUILD_MIN_SIZE
+
+TEST(HistogramBooster, MultiOutputRegression)
+{
+    drishti::ml::HistogramBooster::Recipe recipe;
+    recipe.numberOfTrees = 64;
+    recipe.maxDepth = 4;
+    recipe.featureSubsample = 1.0;
+
+    // Two outputs over shared features, with missing (NaN) values:
+    const int samples = 1000, dim = 8;
+    cv::RNG rng(1);
+    cv::Mat1f features(samples, dim), targets(samples, 2);
+    rng.fill(features, cv::RNG::UNIFORM, -1.f, 1.f);
+    for (int i = 0; i < samples; i++)
+    {
+        targets(i, 0) = std::sin(features(i, 0) * 3.f);
+        targets(i, 1) = features(i, 1) * features(i, 2);
+        if ((i % 7) == 0)
+        {
+            features(i, 3) = std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+
+    std::vector<drishti::ml::TreeEnsemble> ensembles;
+    cv::Mat1f predictions;
+    drishti::ml::HistogramBooster(recipe).train(features, targets, ensembles, predictions);
+    ASSERT_EQ(ensembles.size(), 2);
+    ASSERT_EQ(predictions.size(), targets.size());
+
+    for (int k = 0; k < targets.cols; k++)
+    {
+        // The emitted ensemble (also through XGBooster) must reproduce the training predictions:
+        drishti::ml::XGBooster booster;
+        booster.setEnsemble(ensembles[k]);
+
+        double error = 0.0, variance = 0.0;
+        for (int i = 0; i < samples; i++)
+        {
+            const std::vector<float> sample(features[i], features[i] + dim);
+            EXPECT_NEAR(ensembles[k].predict(sample), predictions(i, k), 1e-5f);
+            EXPECT_EQ(booster(sample), ensembles[k].predict(sample));
+
+            error += std::pow(predictions(i, k) - targets(i, k), 2.0);
+            variance += std::pow(targets(i, k), 2.0);
+        }
+        EXPECT_LT(error, variance * 0.1);
+    }
+}
+
 TEST(StandardizedPCA, gemm_transpose_continuous)
 {
     cv::Mat A, Bt, C;
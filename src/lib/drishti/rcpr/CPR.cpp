@@ -24,6 +24,9 @@
 #endif
 // clang-format on
 
+#include <algorithm>
+#include <map>
+
 DRISHTI_RCPR_NAMESPACE_BEGIN
 
 bool CPR::usesMask() const
@@ -45,6 +48,44 @@ void CPR::setDoPreview(bool flag)
     m_doPreview = flag;
 }
 
+void CPR::setPrecision(ml::TreeEnsemble::Precision precision)
+{
+    if (regModel->regs.has)
+    {
+        for (auto& reg : *(regModel->regs))
+        {
+            reg->ftrData->doHalf = (precision != ml::TreeEnsemble::kFloat);
+            for (auto& booster : reg->xgbdt)
+            {
+                if (booster.second)
+                {
+                    booster.second->setPrecision(precision);
+                }
+            }
+        }
+    }
+}
+
+void CPR::setInits(int inits)
+{
+    m_inits = std::max(1, inits);
+
+    // Perturbations are relative to the initial pose (normalized translation, radians, log2 scale):
+    cv::RNG rng(0);
+    m_perturbations.resize(m_inits);
+    m_perturbations[0] = Vector1d(5, RealType(0.0));
+    for (int i = 1; i < m_inits; i++)
+    {
+        m_perturbations[i] = {
+            RealType(rng.uniform(-0.15, 0.15)), // tx
+            RealType(rng.uniform(-0.15, 0.15)), // ty
+            RealType(rng.uniform(-0.15, 0.15)), // theta
+            RealType(rng.uniform(-0.10, 0.10)), // scale
+            RealType(rng.uniform(-0.05, 0.05))  // aspect ratio
+        };
+    }
+}
+
 std::vector<cv::Point2f> CPR::getMeanShape() const
 {
     Vector1d mu = regModel->pStar;
@@ -66,6 +107,23 @@ void CPR::CprPrm::FtrPrm::merge(const CPR::CprPrm::FtrPrm& opts, int checkExtra)
     nChn.merge(opts.nChn, checkExtra);
 }
 
+void CPR::RegModel::Regs::compile()
+{
+    // Keep the per-dimension boosters if any of them can't be compiled:
+    ensemble.reset();
+    auto merged = std::make_shared<ml::MultiTreeEnsemble>();
+    for (const auto& t : xgbdt)
+    {
+        const ml::TreeEnsemble* trees = t.second ? t.second->getEnsemble() : nullptr;
+        if (!trees)
+        {
+            return;
+        }
+        merged->add(*trees);
+    }
+    ensemble = merged;
+}
+
 CPR::CPR() {}
 CPR::CPR(const CPR& src) {}
 
@@ -94,11 +152,40 @@ static Vector1d pointsToPhi(const std::vector<cv::Point2f>& points)
     return ellipseToPhi(pointsToEllipse(points));
 }
 
+static void pointsToPhi(const std::vector<cv::Point2f>& points, Vector1d& phi)
+{
+    ellipseToPhi(pointsToEllipse(points), phi);
+}
+
+static void phiToPoints(const Vector1d& phi, std::vector<cv::Point2f>& points)
+{
+    if (phi.size() == 5)
+    {
+        points.resize(5);
+        cv::RotatedRect ellipse = phiToEllipse(phi);
+        points = {
+            { ellipse.center.x, 0.f }, // tranpose center
+            { ellipse.center.y, 0.f },
+            { ellipse.size.width, 0.f }, // flip width and height
+            { ellipse.size.height, 0.f },
+            { ellipse.angle, 0.f }
+        };
+
+        if (DRISHTI_CPR_TRANSPOSE)
+        {
+            float theta = ellipse.angle * M_PI / 180.0;
+            std::swap(points[0].x, points[1].x);
+            points[4].x = atan2(std::cos(theta), std::sin(theta)) * 180.0 / M_PI;
+        }
+    }
+}
+
 int CPR::operator()(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, BoolVec& mask) const
 {
     DRISHTI_STREAM_LOG_FUNC(8, 2, m_streamLogger);
 
     CPRResult result;
+    const Vector1d* phi = &result.p;
 
     if (m_isMat)
     {
@@ -117,31 +204,54 @@ int CPR::operator()(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, Bool
     }
     else
     {
-        ImageMaskPair Is{ I, M };
-        Vector1d pStar = (points.size() == 5) ? pointsToPhi(points) : (*regModel->pStar);
-        cprApplyTree(Is, *regModel, pStar, result, m_doPreview);
+        // Run the cascade in the per thread workspace to avoid per call allocations:
+        Workspace& ws = getWorkspace();
+        if (points.size() == 5)
+        {
+            pointsToPhi(points, ws.pose);
+        }
+        else
+        {
+            ws.pose = (*regModel->pStar);
+        }
+        if (m_inits > 1)
+        {
+            cprApplyTreeRestarts(ws, { I, M }, *regModel, ws.pose);
+            phi = &ws.pose;
+        }
+        else
+        {
+            ws.poses.resize(1);
+            ws.poses.front() = ws.pose;
+            cprApplyTree(ws, { I, M }, *regModel, ws.poses, ws.results);
+            phi = &ws.results.front().p;
+        }
     }
 
-    if (result.p.size() == 5)
-    {
-        points.resize(5);
-        cv::RotatedRect ellipse = phiToEllipse(result.p);
-        points = {
-            { ellipse.center.x, 0.f }, // tranpose center
-            { ellipse.center.y, 0.f },
-            { ellipse.size.width, 0.f }, // flip width and height
-            { ellipse.size.height, 0.f },
-            { ellipse.angle, 0.f }
-        };
+    phiToPoints(*phi, points);
 
-        if (DRISHTI_CPR_TRANSPOSE)
-        {
-            float theta = ellipse.angle * M_PI / 180.0;
-            std::swap(points[0].x, points[1].x);
-            points[4].x = atan2(std::cos(theta), std::sin(theta)) * 180.0 / M_PI;
-        }
+    return 0;
+}
+
+int CPR::refine(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, int stages) const
+{
+    DRISHTI_STREAM_LOG_FUNC(8, 5, m_streamLogger);
+
+    if (m_isMat || (points.size() != 5))
+    {
+        std::vector<bool> mask;
+        return (*this)(I, M, points, mask);
     }
 
+    const int count = std::min(stagesHint, int(*regModel->T));
+    const int firstStage = (stages > 0) ? std::max(count - stages, 0) : 0;
+
+    Workspace& ws = getWorkspace();
+    ws.poses.resize(1);
+    pointsToPhi(points, ws.poses.front());
+    cprApplyTree(ws, { I, M }, *regModel, ws.poses, ws.results, firstStage);
+    phiToPoints(ws.results.front().p, points);
+
     return 0;
 }
 
@@ -151,4 +261,53 @@ int CPR::operator()(const cv::Mat& I, std::vector<cv::Point2f>& points, std::vec
     return (*this)(I, {}, points, mask);
 }
 
+int CPR::operator()(const cv::Mat& I, std::vector<Point2fVec>& points) const
+{
+    DRISHTI_STREAM_LOG_FUNC(8, 4, m_streamLogger);
+
+    if (m_isMat)
+    {
+        return ShapeEstimator::operator()(I, points);
+    }
+
+    // Initial poses as in the single shape call, with duplicates removed (ordered lookup):
+    std::vector<Vector1d> poses;
+    std::map<Vector1d, int> lookup;
+    std::vector<int> index(points.size());
+    for (int i = 0; i < points.size(); i++)
+    {
+        const Vector1d pose = (points[i].size() == 5) ? pointsToPhi(points[i]) : (*regModel->pStar);
+        const auto entry = lookup.emplace(pose, int(poses.size()));
+        if (entry.second)
+        {
+            poses.push_back(pose);
+        }
+        index[i] = entry.first->second;
+    }
+
+    Workspace& ws = getWorkspace();
+    if (m_inits > 1)
+    {
+        for (auto& pose : poses)
+        {
+            cprApplyTreeRestarts(ws, { I, {} }, *regModel, pose);
+        }
+    }
+    else
+    {
+        cprApplyTree(ws, { I, {} }, *regModel, poses, ws.results);
+        for (int i = 0; i < poses.size(); i++)
+        {
+            poses[i] = ws.results[i].p;
+        }
+    }
+
+    for (int i = 0; i < points.size(); i++)
+    {
+        phiToPoints(poses[index[i]], points[i]);
+    }
+
+    return 0;
+}
+
 DRISHTI_RCPR_NAMESPACE_END
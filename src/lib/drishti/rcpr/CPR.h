@@ -25,20 +25,16 @@
 #include "half/half.hpp"
 
 #include "drishti/rcpr/drishti_rcpr.h"
+#include "drishti/rcpr/PointHalf.h"
 #include "drishti/acf/ACFField.h"
 
-// clang-format off
-#if DRISHTI_CPR_DO_HALF_FLOAT
-#  include "drishti/rcpr/PointHalf.h"
-#endif
-// clang-format on
-
 #include "drishti/core/Logger.h"
 #include "drishti/rcpr/ImageMaskPair.h"
 #include "drishti/rcpr/Vector1d.h"
 #include "drishti/rcpr/Recipe.h"
 #include "drishti/ml/ShapeEstimator.h"
 #include "drishti/ml/XGBooster.h"
+#include "drishti/ml/TreeEnsemble.h"
 
 #include <boost/serialization/export.hpp>
 #include <boost/serialization/version.hpp>
@@ -235,6 +231,8 @@ public:
                 acf::Field<PointVec> xs;   // feature locations relative to unit circle (Fx2)
                 acf::Field<Vector1d> pids; // part ids for each x (just one part implemented)
 
+                bool doHalf = DRISHTI_CPR_DO_HALF_FLOAT; // storage precision of xs (recorded in version >= 1)
+
                 friend class boost::serialization::access;
                 template <class Archive>
                 void serialize(Archive& ar, const unsigned int version);
@@ -245,6 +243,10 @@ public:
 
             std::vector<std::pair<int, std::shared_ptr<ml::XGBooster>>> xgbdt;
 
+            // Per-dimension boosters merged into one multi-output ensemble (not serialized):
+            std::shared_ptr<ml::MultiTreeEnsemble> ensemble;
+            void compile();
+
             // Boost serialization:
             friend class boost::serialization::access;
             template <class Archive>
@@ -287,6 +289,14 @@ public:
     virtual int operator()(const cv::Mat& I, const cv::Mat& M, PointVec& points, std::vector<bool>& mask) const;
     virtual int operator()(const cv::Mat& I, PointVec& points, std::vector<bool>& mask) const;
 
+    // Batch: all shapes go through one cascade pass per stage, and shapes with identical
+    // initial poses (e.g., priors that don't define a pose) share a single estimate:
+    virtual int operator()(const cv::Mat& I, std::vector<Point2fVec>& points) const;
+
+    // Warm start: refine a prior pose (i.e., the previous frame's fit) with the last
+    // `stages` stages of the cascade only, skipping the coarse initial stages (0: all):
+    int refine(const cv::Mat& I, const cv::Mat& M, Point2fVec& points, int stages) const;
+
     struct FeaturesResult
     {
         Vector1d ftrs;
@@ -299,12 +309,52 @@ public:
         Vector1d ysCum; // predicted outputs after each stage
     };
 
+    // Buffers reused across cascade calls (no heap allocations at steady state):
+    struct Workspace
+    {
+        cv::Mat image, mask; // transposed input (DRISHTI_CPR_TRANSPOSE)
+        std::vector<float> features, outputs;
+        cv::Mat1f response; // per booster batch output
+        Vector1d delta, pose, values;
+        std::vector<Vector1d> poses;
+        std::vector<CPRResult> results;
+    };
+
+    // Per thread workspace used by the convenience overloads:
+    static Workspace& getWorkspace();
+
     int cprTrain(const ImageMaskPairVec& images, const EllipseVec& ellipses, const HVec& H, const CprPrm& cprPrm, bool doJitter = false);
     int cprApplyTree(const cv::Mat& Is, const RegModel& regModel, const Vector1d& p, CPRResult& result, bool preview = false) const;
     int cprApplyTree(const ImageMaskPair& Is, const RegModel& regModel, const Vector1d& p, CPRResult& result, bool preview = false) const;
+    int cprApplyTree(const ImageMaskPair& Is, const RegModel& regModel, const std::vector<Vector1d>& p, std::vector<CPRResult>& results) const;
+    int cprApplyTree(Workspace& ws, const ImageMaskPair& Is, const RegModel& regModel, const std::vector<Vector1d>& p, std::vector<CPRResult>& results, int firstStage = 0) const;
+
+    // Run getInits() restarts around p in one batch and replace p with their per-parameter median:
+    int cprApplyTreeRestarts(Workspace& ws, const ImageMaskPair& Is, const RegModel& regModel, Vector1d& p) const;
+
+    // Restarts are deterministic perturbations of the initial pose (the first one is the identity):
+    virtual void setInits(int inits);
+    virtual int getInits() const
+    {
+        return m_inits;
+    }
+
+    // Normalized restart spread (center distance / scale) above which a second round of
+    // restarts is run from the median (0 disables the second round):
+    void setRestartSpreadThreshold(float value)
+    {
+        m_restartSpreadThreshold = value;
+    }
+    float getRestartSpreadThreshold() const
+    {
+        return m_restartSpreadThreshold;
+    }
 
     virtual void setDoPreview(bool flag);
 
+    // Storage precision for feature locations and trees of all stages (used by serialize()):
+    void setPrecision(ml::TreeEnsemble::Precision precision);
+
     template <class Archive>
     void serialize(Archive& ar, const unsigned int version);
 
@@ -335,6 +385,10 @@ protected:
     int stagesHint = std::numeric_limits<int>::max();
     int stagesRepetitionFactor = 1;
 
+    int m_inits = 1;
+    float m_restartSpreadThreshold = 0.f;
+    std::vector<Vector1d> m_perturbations;
+
     ViewFunc m_viewer;
 };
 
@@ -343,13 +397,17 @@ using FtrData = CPR::RegModel::Regs::FtrData;
 
 int createModel(int type, CPR::Model& model);
 int featuresComp(const CPR::Model& model, const Vector1d& p, const ImageMaskPair& I, const FtrData& ftrData, CPR::FeaturesResult& result, bool useNPD = false);
+int featuresComp(const CPR::Model& model, const Vector1d& p, const ImageMaskPair& I, const FtrData& ftrData, float* ftrs, bool useNPD = false);
+int featuresComp_c(const CPR::Model& model, const Vector1d& p, const ImageMaskPair& I, const FtrData& ftrData, float* ftrs, bool useNPD = false); // scalar reference
 int ftrsGen(const CPR::Model& model, const CPR::CprPrm::FtrPrm& ftrPrmIn, FtrData& ftrData, float lambda = 0.1f);
 Vector1d identity(const CPR::Model& model);
 Vector1d compose(const CPR::Model& mnodel, const Vector1d& phis0, const Vector1d& phis1);
+void compose(const CPR::Model& mnodel, const Vector1d& phis0, const Vector1d& phis1, Vector1d& phis);
 Vector1d inverse(const CPR::Model& model, const Vector1d& phis0);
 Vector1d phisFrHs(const Matx33Real& Hs);
 Vector1d compPhiStar(const CPR::Model& mnodel, const EllipseVec& phis);
 Vector1d ellipseToPhi(const cv::RotatedRect& e);
+void ellipseToPhi(const cv::RotatedRect& e, Vector1d& phi); // reuses the phi storage
 cv::RotatedRect phiToEllipse(const Vector1d& phi, bool transpose = DRISHTI_CPR_TRANSPOSE);
 Matx33Real phisToHs(const Vector1d& phis);
 double normAng(double ang, double rng);
@@ -96,21 +96,36 @@ void CPR::RegModel::Regs::FtrData::serialize(Archive& ar, const unsigned int ver
     ar& F;
     ar& nChn;
 
-#if DRISHTI_CPR_DO_HALF_FLOAT
-    std::vector<PointHalf> xs_;
-    if (Archive::is_loading::value)
+    // Version 0 archives use the build precision, later versions record it:
+    uint8_t half = doHalf;
+    if (version >= 1)
     {
-        ar& xs_;
-        copy(xs_, (*xs));
+        ar& half;
     }
     else
     {
-        copy((*xs), xs_);
-        ar& xs_;
+        half = DRISHTI_CPR_DO_HALF_FLOAT;
     }
-#else
-    ar& xs;
-#endif
+
+    if (half)
+    {
+        std::vector<PointHalf> xs_;
+        if (Archive::is_loading::value)
+        {
+            ar& xs_;
+            copy(xs_, (*xs));
+        }
+        else
+        {
+            copy((*xs), xs_);
+            ar& xs_;
+        }
+    }
+    else
+    {
+        ar& xs;
+    }
+    doHalf = (half != 0);
 
     ar& pids;
 }
@@ -125,6 +140,11 @@ void CPR::RegModel::Regs::serialize(Archive& ar, const unsigned int version)
     ar& ftrData;
     ar& r;
     ar& xgbdt;
+
+    if (Archive::is_loading::value)
+    {
+        compile();
+    }
 }
 
 template <class Archive>
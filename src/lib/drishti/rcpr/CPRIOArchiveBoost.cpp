@@ -13,6 +13,7 @@
 #include <boost/serialization/utility.hpp>
 
 #include "drishti/core/drishti_cvmat_boost.h"
+#include "drishti/core/drishti_cv_boost.h"
 #include "drishti/rcpr/CPRIOArchive.h"
 
 // clang-format off
@@ -23,6 +24,7 @@
 #include "boost-pba/portable_binary_iarchive.hpp"
 
 BOOST_CLASS_VERSION(drishti::rcpr::CPR::RegModel, 1);
+BOOST_CLASS_VERSION(drishti::rcpr::CPR::RegModel::Regs::FtrData, 1);
 
 DRISHTI_RCPR_NAMESPACE_BEGIN
 
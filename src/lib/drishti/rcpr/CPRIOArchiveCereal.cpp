@@ -26,6 +26,7 @@
 #include <opencv2/core.hpp>
 
 CEREAL_CLASS_VERSION(drishti::rcpr::CPR::RegModel, 1);
+CEREAL_CLASS_VERSION(drishti::rcpr::CPR::RegModel::Regs::FtrData, 1);
 
 // Workaround:
 // cereal found more than one compatible output serialization function for the provided type and archive combination.
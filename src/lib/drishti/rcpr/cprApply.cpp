@@ -12,9 +12,13 @@
 #include "drishti/rcpr/CPR.h"
 
 #include "drishti/core/timing.h"
+#include "drishti/core/Parallel.h"
 
 #include "drishti/geometry/Ellipse.h"
 
+#include <algorithm>
+#include <cmath>
+
 #define DRISHTI_CPR_DO_DEBUG 0
 
 // clang-format off
@@ -215,103 +219,211 @@ std::ostream& operator<<(std::ostream& os, const cv::RotatedRect& e)
     return os;
 }
 
+CPR::Workspace& CPR::getWorkspace()
+{
+    thread_local Workspace workspace;
+    return workspace;
+}
+
 int CPR::cprApplyTree(const cv::Mat& I, const RegModel& regModel, const Vector1d& pIn, CPRResult& result, bool doPreview) const
 {
-    cv::Mat1b mask = cv::Mat1b::ones(I.size());
-    return cprApplyTree(ImageMaskPair(I, mask), regModel, pIn, result, doPreview);
+    // An empty mask is equivalent to a mask of ones:
+    return cprApplyTree(ImageMaskPair(I), regModel, pIn, result, doPreview);
 }
 
 #define STAGE_REPETITION_FACTOR 1
 
-int CPR::cprApplyTree(const ImageMaskPair& IsIn, const RegModel& regModel, const Vector1d& pIn, CPRResult& result, bool doPreview) const
+int CPR::cprApplyTree(const ImageMaskPair& Is, const RegModel& regModel, const Vector1d& pIn, CPRResult& result, bool doPreview) const
+{
+    Workspace& ws = getWorkspace();
+    ws.poses.resize(1);
+    ws.poses.front() = pIn;
+    cprApplyTree(ws, Is, regModel, ws.poses, ws.results);
+    result = ws.results.front();
+
+#if DRISHTI_CPR_DO_DEBUG && !HAS_XGBOOST
+    // TODO: Legacy non xgboost
+    if (doPreview)
+    {
+        cv::Mat canvas;
+        cv::cvtColor(Is.getImage(), canvas, cv::COLOR_GRAY2BGR);
+
+        const auto e = phiToEllipse(result.p), eIn = phiToEllipse(pIn);
+        cv::ellipse(canvas, eIn, { 255, 0, 0 }, 1, 8);
+        cv::ellipse(canvas, e, { 0, 255, 0 }, 1, 8);
+
+        drishti::geometry::Ellipse e2(e);
+        cv::line(canvas, e.center, e2.getMajorAxisPos(), { 0, 255, 0 }, 1, 8);
+        cv::imshow("I", canvas); // opt
+        cv::waitKey(0);
+    }
+#endif
+
+    return 0;
+}
+
+int CPR::cprApplyTree(const ImageMaskPair& Is, const RegModel& regModel, const std::vector<Vector1d>& pIn, std::vector<CPRResult>& results) const
+{
+    return cprApplyTree(getWorkspace(), Is, regModel, pIn, results);
+}
+
+// Below this many poses, thread dispatch costs more than the feature extraction:
+static const int kParallelBatch = 32;
+
+// Apply the cascade to several poses (i.e., restarts) in the same image.
+// Each stage stacks the features of all poses in one matrix and evaluates
+// all output dimensions of the stage in a single ensemble pass.
+int CPR::cprApplyTree(Workspace& ws, const ImageMaskPair& IsIn, const RegModel& regModel, const std::vector<Vector1d>& pIn, std::vector<CPRResult>& results, int firstStage) const
 {
     DRISHTI_STREAM_LOG_FUNC(9, 2, m_streamLogger);
 
-    ImageMaskPair Is = IsIn;
+    ImageMaskPair Is = IsIn; // shallow
     if (DRISHTI_CPR_TRANSPOSE)
     {
-        Is.getImage() = Is.getImage().t();
-        Is.getMask() = Is.getMask().t();
+        cv::transpose(IsIn.getImage(), ws.image);
+        Is.getImage() = ws.image;
+        if (!IsIn.getMask().empty())
+        {
+            cv::transpose(IsIn.getMask(), ws.mask);
+            Is.getMask() = ws.mask;
+        }
     }
 
-    auto& p = result.p;
-    p = pIn;
-
     // Apply each single stage regressor, starting from pose p:
     auto& model = *(regModel.model);
     auto T = *(regModel.T);
-    result.pAll.resize(T); // store result at end of each stage
 
-    // repeat the whole thing 2x
-    std::vector<int> stage;
-
-    // Create a recipe for executing the stages:
-    for (int i = 0; i < std::min(stagesHint, int(T)); i++)
+    const int N = static_cast<int>(pIn.size());
+    results.resize(N);
+    for (int i = 0; i < N; i++)
     {
-        for (int j = 0; j < std::max(1, stagesRepetitionFactor); j++)
-        {
-            stage.push_back(i);
-        }
+        results[i].p = pIn[i];
+        results[i].pAll.resize(T); // store result at end of each stage
     }
 
-    //for(int t = 0; t < T; t++)
-    for (const auto& t : stage)
+    // Stages are executed in order, each one repeated stagesRepetitionFactor times:
+    const int stages = std::min(stagesHint, int(T));
+    const int repetitions = std::max(1, stagesRepetitionFactor);
+    for (int t = std::max(firstStage, 0); t < stages; t++)
     {
-        auto& reg = *(*(regModel.regs))[t];
+        for (int repetition = 0; repetition < repetitions; repetition++)
+        {
+            auto& reg = *(*(regModel.regs))[t];
 
-        DRISHTI_STREAM_LOG_FUNC(9, 3, m_streamLogger);
-        FeaturesResult ftrResult;
-        featuresComp(model, p, Is, *(reg.ftrData), ftrResult);
-        DRISHTI_STREAM_LOG_FUNC(9, 4, m_streamLogger);
+            const int n = PointVecSize(*(reg.ftrData->xs)) / 2;
+            ws.features.resize(N * n);
 
-        auto pDel = identity(model);
+            // Pose batches are usually small, so threads (and the type erased loop body, which
+            // allocates) are only used for large ones:
+            DRISHTI_STREAM_LOG_FUNC(9, 3, m_streamLogger);
+            if (N >= kParallelBatch)
+            {
+                core::ParallelHomogeneousLambda harness = [&](int i) {
+                    featuresComp(model, results[i].p, Is, *(reg.ftrData), ws.features.data() + (i * n));
+                };
+                cv::parallel_for_({ 0, N }, harness);
+            }
+            else
+            {
+                for (int i = 0; i < N; i++)
+                {
+                    featuresComp(model, results[i].p, Is, *(reg.ftrData), ws.features.data() + (i * n));
+                }
+            }
+            DRISHTI_STREAM_LOG_FUNC(9, 4, m_streamLogger);
 
-        cv::Mat features;
-        cv::Mat(ftrResult.ftrs).reshape(1, 1).copyTo(features);
-        features.convertTo(features, CV_32F);
+            const int dim = static_cast<int>(reg.xgbdt.size());
+            ws.outputs.resize(N * dim);
 
-        {
-            // XGBOOST
-            std::vector<std::vector<float>> data(features.rows);
-            for (int i = 0; i < features.rows; i++)
+            DRISHTI_STREAM_LOG_FUNC(9, 5, m_streamLogger);
+            if (reg.ensemble)
             {
-                data[i] = features.row(i);
+                reg.ensemble->predict(ws.features.data(), N, n, n, ws.outputs.data());
             }
+            else
+            {
+                // One batch per booster over the feature rows (read in place):
+                const cv::Mat1f samples(N, n, ws.features.data());
+                for (int k = 0; k < dim; k++)
+                {
+                    (*reg.xgbdt[k].second)(samples, ws.response);
+                    for (int i = 0; i < N; i++)
+                    {
+                        ws.outputs[(i * dim) + k] = ws.response(i);
+                    }
+                }
+            }
+            DRISHTI_STREAM_LOG_FUNC(9, 6, m_streamLogger);
 
-            for (auto& t : reg.xgbdt)
+            for (int i = 0; i < N; i++)
             {
-                DRISHTI_STREAM_LOG_FUNC(9, 5, m_streamLogger);
-                pDel[t.first] = (*t.second)(data[0]);
-                DRISHTI_STREAM_LOG_FUNC(9, 6, m_streamLogger);
+                ws.delta.assign(results[i].p.size(), RealType(0.0)); // identity
+                for (int k = 0; k < dim; k++)
+                {
+                    ws.delta[reg.xgbdt[k].first] = ws.outputs[(i * dim) + k];
+                }
+
+                //std::cout << "delta : " << phiToEllipse(ws.delta) << " "; print(ws.delta);
+                //std::cout << "pIn : " << phiToEllipse(results[i].p) << " "; print(results[i].p);
+
+                auto& p = results[i].p;
+                compose(model, p, ws.delta, p);
+                results[i].pAll[t] = p; // store result for this stage
             }
         }
+    }
+    return 0;
+}
+
+// Per-parameter median of the restart results, returns the normalized spread of the centers.
+// Composed angles are wrapped to (-pi, pi], so the angle median is taken over the wrapped
+// differences to the first (unperturbed) restart:
+static RealType medianOfRestarts(const std::vector<CPR::CPRResult>& results, Vector1d& values, Vector1d& p)
+{
+    const int n = static_cast<int>(results.size());
+    const RealType theta = results.front().p[2];
+    values.resize(n);
+    for (int j = 0; j < p.size(); j++)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            values[i] = (j == 2) ? std::remainder(results[i].p[j] - theta, RealType(2.0 * M_PI)) : results[i].p[j];
+        }
+        std::nth_element(values.begin(), values.begin() + (n / 2), values.end());
+        p[j] = (j == 2) ? (theta + values[n / 2]) : values[n / 2];
+    }
 
-        //std::cout << "****" << phiToEllipse(pIn) << "*****" << std::endl;
-        //std::cout << "======== " << t << "=========== " << std::endl;
-        //std::cout << "delta : " << phiToEllipse(pDel) << " "; print(pDel);
-        //std::cout << "pIn : " << phiToEllipse(p) << " "; print(p);
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = std::sqrt(std::pow(results[i].p[0] - p[0], 2) + std::pow(results[i].p[1] - p[1], 2));
+    }
+    std::nth_element(values.begin(), values.begin() + (n / 2), values.end());
+    return values[n / 2] / std::pow(RealType(2.0), p[3]);
+}
 
-        p = compose(model, p, pDel);
-        result.pAll[t] = p; // store result for this stage
+int CPR::cprApplyTreeRestarts(Workspace& ws, const ImageMaskPair& Is, const RegModel& regModel, Vector1d& p) const
+{
+    DRISHTI_STREAM_LOG_FUNC(9, 7, m_streamLogger);
 
-#if DRISHTI_CPR_DO_DEBUG && !HAS_XGBOOST
-        // TODO: Legacy non xgboost
-        if (doPreview)
+    const auto& model = *(regModel.model);
+    const int rounds = (m_restartSpreadThreshold > 0.f) ? 2 : 1;
+    for (int round = 0; round < rounds; round++)
+    {
+        // All restarts share a single batched pass through each stage:
+        ws.poses.resize(m_perturbations.size());
+        for (int i = 0; i < m_perturbations.size(); i++)
         {
-            cv::Mat canvas;
-            cv::cvtColor(I, canvas, cv::COLOR_GRAY2BGR);
-
-            const auto e = phiToEllipse(p), eIn = phiToEllipse(pIn);
-            cv::ellipse(canvas, eIn, { 255, 0, 0 }, 1, 8);
-            cv::ellipse(canvas, e, { 0, 255, 0 }, 1, 8);
+            compose(model, p, m_perturbations[i], ws.poses[i]);
+        }
+        cprApplyTree(ws, Is, regModel, ws.poses, ws.results);
 
-            drishti::geometry::Ellipse e2(e);
-            cv::line(canvas, e.center, e2.getMajorAxisPos(), { 0, 255, 0 }, 1, 8);
-            cv::imshow("I", canvas); // opt
-            cv::waitKey(0);
+        // Only run a second round (from the median) when the restarts disagree:
+        if (medianOfRestarts(ws.results, ws.values, p) <= m_restartSpreadThreshold)
+        {
+            break;
         }
-#endif
     }
+
     return 0;
 }
 
@@ -13,9 +13,11 @@
 #define DRISHTI_CPR_DO_FEATURE_DEBUG 1
 #define DRISHTI_CPR_DO_PREVIEW_GT 0
 #define DRISHTI_CPR_DO_PREVIEW_JITTER 0
+#define DRISHTI_CPR_DO_NATIVE_GBDT 1
 
 #include "drishti/rcpr/CPR.h"
 #include "drishti/ml/PCA.h"
+#include "drishti/ml/HistogramBooster.h"
 #include "drishti/geometry/Ellipse.h"
 #include "drishti/core/Parallel.h"
 #include "drishti/core/timing.h"
@@ -37,8 +39,8 @@ typedef std::vector<T_VECTOR> T_MATRIX;
 // clang-format on
 
 #include <algorithm>
+#include <cmath>
 #include <numeric>
-#include <mutex>
 
 DRISHTI_RCPR_NAMESPACE_BEGIN
 
@@ -286,6 +288,8 @@ int CPR::cprTrain(const ImageMaskPairVec& Is, const EllipseVec& pGtIn, const HVe
 
     CV_Assert(T == cprPrm.cascadeRecipes.size());
 
+    std::size_t peakStageBytes = 0; // largest per stage training buffer
+
     // Loop and gradually improve pCur
     for (int t = 0; t < T; t++)
     {
@@ -294,40 +298,89 @@ int CPR::cprTrain(const ImageMaskPairVec& Is, const EllipseVec& pGtIn, const HVe
         ftrPrm.radius = double(recipe.featureRadius);
         ftrPrm.F = double(recipe.featurePoolSize); // TODO revisit
 
-        MatrixType<uint8_t> mask(pCur.size());
-        cv::Mat features(int(pCur.size()), ftrPrm.F, CV_64F);
-        cv::Mat values(int(pCur.size()), R, CV_64F);
-
         // Generate shared features 1x per stage
         CPR::RegModel::Regs::FtrData ftrData;
         ftrsGen({}, ftrPrm, ftrData, cprPrm.cascadeRecipes[t].lambda);
 
-        // For each model:
+        core::ScopeTimeLogger stageTimer = [&](double elapsed) {
+            m_streamLogger->info("stage {}: total {}s", t, elapsed);
+        };
+
+        // Samples that share an image and a current pose (i.e., replicas that have
+        // not diverged) share a single feature computation:
+        std::vector<int> source(pCur.size());
         for (int i = 0; i < pCur.size(); i++)
         {
-            //% get target value for pose
-            Vector1d tar;
-            tar = inverse({}, pCur[i]); // pCur starts as pStar (mean model)
-            tar = compose({}, tar, pGt[i]);
-
-            //% generate and compute pose indexed features
-            CPR::FeaturesResult ftrResult;
-            featuresComp({}, pCur[i], Is[imgIds[i]], ftrData, ftrResult, recipe.useNPD);
-
-            // TODO: make decision about format, might be better to stick w/ std::vector<std::vector<T>>
-            mask[i] = ftrResult.ftrMask;
-            cv::Mat(ftrResult.ftrs).reshape(1, 1).copyTo(features.row(i));
-            cv::Mat(tar).reshape(1, 1).copyTo(values.row(i));
+            source[i] = i;
+            for (int j = imgIds[i]; j < i; j += int(Is.size()))
+            {
+                if (pCur[j] == pCur[i])
+                {
+                    source[i] = j;
+                    break;
+                }
+            }
+        }
+
+        // Feature matrix and targets are preallocated and filled in place, one row per sample:
+        const int F = PointVecSize(*ftrData.xs) / 2;
+        MatrixType<uint8_t> mask(pCur.size());
+        cv::Mat1f features(int(pCur.size()), F);
+        cv::Mat1f values(int(pCur.size()), R);
+
+        {
+            core::ScopeTimeLogger extractTimer = [&](double elapsed) {
+                m_streamLogger->info("stage {}: feature extraction {}s", t, elapsed);
+            };
+
+            std::function<void(int)> extractFeatures = [&](int i) {
+                //% get target value for pose
+                Vector1d tar;
+                tar = inverse({}, pCur[i]); // pCur starts as pStar (mean model)
+                tar = compose({}, tar, pGt[i]);
+                std::copy(tar.begin(), tar.end(), values[i]);
+
+                //% generate and compute pose indexed features (masked features are NaN)
+                if (source[i] == i)
+                {
+                    // Stages without doMask are applied without a mask (see CPR::usesMask()), so
+                    // they are trained on unmasked features in both the native and xgboost paths:
+                    const ImageMaskPair& I = Is[imgIds[i]];
+                    featuresComp({}, pCur[i], recipe.doMask ? I : ImageMaskPair(I.getImage()), ftrData, features[i], recipe.useNPD);
+                }
+            };
+            core::ParallelHomogeneousLambda harness(extractFeatures);
+            cv::parallel_for_({ 0, int(pCur.size()) }, harness);
+
+            std::function<void(int)> fillShared = [&](int i) {
+                if (source[i] != i)
+                {
+                    std::copy(features[source[i]], features[source[i]] + F, features[i]);
+                }
+#if !DRISHTI_CPR_DO_NATIVE_GBDT
+                // The native trainer treats masked (NaN) features as missing values directly:
+                if (recipe.doMask && !Is[imgIds[i]].getMask().empty())
+                {
+                    mask[i].resize(F);
+                    std::transform(features[i], features[i] + F, mask[i].begin(), [](float f) {
+                        return uint8_t(!std::isnan(f));
+                    });
+                }
+#endif
+            };
+            core::ParallelHomogeneousLambda fillHarness(fillShared);
+            cv::parallel_for_({ 0, int(pCur.size()) }, fillHarness);
         }
 
-        features.convertTo(features, CV_32F);
-        values.convertTo(values, CV_32F);
-        T_MATRIX features_(features.rows);
-        for (int i = 0; i < features.rows; i++)
         {
-            // Fill in the feature matrix
-            T_VECTOR row = features.row(i);
-            features_[i] = row;
+            std::size_t unique = 0, bytes = pCur.size() * (F + R) * sizeof(float);
+            for (int i = 0; i < pCur.size(); i++)
+            {
+                unique += (source[i] == i);
+                bytes += mask[i].size() * sizeof(uint8_t);
+            }
+            peakStageBytes = std::max(peakStageBytes, bytes);
+            m_streamLogger->info("stage {}: {} samples ({} unique) x {} features, {} MB", t, pCur.size(), unique, F, double(bytes) / (1 << 20));
         }
 
         const size_t N = pCur.size();
@@ -359,23 +412,67 @@ int CPR::cprTrain(const ImageMaskPairVec& Is, const EllipseVec& pGtIn, const HVe
 
         MatrixType<float> predictions(regressorToPhiIndex.size());
 
+        ml::XGBooster::Recipe params;
+        params.learningRate = recipe.learningRate;
+        params.dataSubsample = recipe.dataSampleRatio;
+        params.maxDepth = recipe.maxDepth;
+        params.featureSubsample = float(recipe.featureSampleSize) / recipe.featurePoolSize;
+
         {
-            // Estimate regressors
-            std::mutex mutex;
+            core::ScopeTimeLogger trainTimer = [&](double elapsed) {
+                m_streamLogger->info("stage {}: regressor training {}s", t, elapsed);
+            };
+
+#if DRISHTI_CPR_DO_NATIVE_GBDT
+            // All regressors are fit jointly: each round grows one tree from gradient
+            // histograms shared by all outputs, and each output keeps its own leaves.
+            cv::Mat1f targets(int(N), int(regressorToPhiIndex.size()));
+            for (int i = 0; i < regressorToPhiIndex.size(); i++)
+            {
+                values.col(regressorToPhiIndex[i]).copyTo(targets.col(i));
+            }
+
+            ml::HistogramBooster::Recipe native;
+            native.numberOfTrees = params.numberOfTrees;
+            native.maxDepth = params.maxDepth;
+            native.dataSubsample = params.dataSubsample;
+            native.learningRate = params.learningRate;
+            native.featureSubsample = params.featureSubsample;
+            native.seed = t;
+
+            std::vector<ml::TreeEnsemble> ensembles;
+            cv::Mat1f fitted;
+            ml::HistogramBooster(native).train(features, targets, ensembles, fitted);
+
+            for (int i = 0; i < regressorToPhiIndex.size(); i++)
+            {
+                xgbdt[i] = std::make_shared<ml::XGBooster>(params);
+                xgbdt[i]->setEnsemble(ensembles[i]);
+
+                predictions[i].resize(N);
+                for (int j = 0; j < N; j++)
+                {
+                    predictions[i][j] = fitted(j, i);
+                }
+            }
+            m_streamLogger->info("done training stage {} ({} params)", t, regressorToPhiIndex.size());
+#else
+            T_MATRIX features_(N);
+            for (int j = 0; j < N; j++)
+            {
+                features_[j].assign(features[j], features[j] + F);
+            }
+
+            // Estimate regressors (the feature matrix is shared read only by all regressors)
             std::function<void(int)> trainRegressor = [&](int i) {
                 cv::Mat tmp = values.col(regressorToPhiIndex[i]);
                 tmp = tmp.t();
 
-                std::vector<std::vector<float>> data = features_;
+                const T_MATRIX& data = features_;
                 std::vector<float> target = tmp;
 
-                ml::XGBooster::Recipe params;
-                params.learningRate = recipe.learningRate;
-                params.dataSubsample = recipe.dataSampleRatio;
-                params.maxDepth = recipe.maxDepth;
-                params.featureSubsample = float(recipe.featureSampleSize) / recipe.featurePoolSize;
-
                 xgbdt[i] = std::make_shared<ml::XGBooster>(params);
+                xgbdt[i]->setThreads(std::max(cv::getNumThreads() / int(regressorToPhiIndex.size()), 1)); // regressors train concurrently
                 xgbdt[i]->train(data, target, recipe.doMask ? mask : MatrixType<uint8_t>());
 
                 predictions[i].resize(data.size());
@@ -390,6 +487,7 @@ int CPR::cprTrain(const ImageMaskPairVec& Is, const EllipseVec& pGtIn, const HVe
 
             core::ParallelHomogeneousLambda harness(trainRegressor);
             cv::parallel_for_({ 0, int(regressorToPhiIndex.size()) }, harness);
+#endif
         }
 
 #if DRISHTI_CPR_DO_FEATURE_DEBUG
@@ -399,33 +497,43 @@ int CPR::cprTrain(const ImageMaskPairVec& Is, const EllipseVec& pGtIn, const HVe
             m_viewer("features", canvas);
         }
 #endif
+        // Apply the predictions for candidate parameter set i to sample j:
+        auto update = [&](int i, int j) {
+            const auto& dims = phiSets[i];
+            Vector1d del = identity(model);
+            for (int k = 0; k < dims.size(); k++)
+            {
+                del[dims[k]] = predictions[phiIndexToRegressor[dims[k]]][j];
+            }
+            return compose(model, pCur[j], del);
+        };
+
         std::vector<double> losses(phiSets.size(), 0.0);
-        std::vector<EllipseVec> pTmps(phiSets.size(), pCur);
 
         {
-            // Now search over combinations for best loss:
+            core::ScopeTimeLogger scoreTimer = [&](double elapsed) {
+                m_streamLogger->info("stage {}: candidate scoring {}s", t, elapsed);
+            };
 
+            // Now search over combinations for best loss.  All candidates are scored
+            // for each sample in parallel (there are far more samples than candidates):
+            //
             // i : index to vector of pose dimension indices
             // j : index to # of training samples
-            // k : index over pose dimensions indices of phiSets[i]
-            std::function<void(int)> computeLoss = [&](int i) {
-                const auto& dims = phiSets[i];
-                double loss = 0.0;
-                Vector1d del = identity(model);
-                for (int j = 0; j < N; j++)
+            cv::Mat1d errors(int(N), int(phiSets.size()));
+            std::function<void(int)> computeErrors = [&](int j) {
+                for (int i = 0; i < phiSets.size(); i++)
                 {
-                    for (int k = 0; k < dims.size(); k++)
-                    {
-                        del[dims[k]] = predictions[phiIndexToRegressor[dims[k]]][j];
-                    }
-
-                    pTmps[i][j] = compose(model, pCur[j], del);
-                    loss += dist(model, pTmps[i][j], pGt[j]);
+                    errors(j, i) = dist(model, update(i, j), pGt[j]);
                 }
-                losses[i] = (loss / double(N));
             };
-            core::ParallelHomogeneousLambda harness(computeLoss);
-            cv::parallel_for_({ 0, int(phiSets.size()) }, harness);
+            core::ParallelHomogeneousLambda harness(computeErrors);
+            cv::parallel_for_({ 0, int(N) }, harness);
+
+            for (int i = 0; i < phiSets.size(); i++)
+            {
+                losses[i] = cv::sum(errors.col(i))[0] / double(N);
+            }
         }
 
         for (int j = 0; j < losses.size(); j++)
@@ -449,7 +557,13 @@ int CPR::cprTrain(const ImageMaskPairVec& Is, const EllipseVec& pGtIn, const HVe
         }
 
         m_streamLogger->info("Best loss {} losses = {}", ss.str(), losses[best]);
-        pCur = pTmps[best]; // update current estimate based on best parmeter
+
+        // Update current estimate based on best parameter:
+        std::function<void(int)> updatePose = [&](int j) {
+            pCur[j] = update(best, j);
+        };
+        core::ParallelHomogeneousLambda harness(updatePose);
+        cv::parallel_for_({ 0, int(N) }, harness);
 
         trainingLog.resize(trainingLog.size() + 1);
         trainingLog.back().loss = losses[best];
@@ -463,10 +577,13 @@ int CPR::cprTrain(const ImageMaskPairVec& Is, const EllipseVec& pGtIn, const HVe
         {
             reg.xgbdt.emplace_back(phiSets[best][i], xgbdt[i]);
         }
+        reg.compile();
 
         regs.emplace_back("reg", reg, true);
     }
 
+    m_streamLogger->info("peak stage buffer {} MB", double(peakStageBytes) / (1 << 20));
+
     this->regModel->model = { "model", model };
     this->regModel->pStar = { "pStar", pStar };
     this->regModel->T = { "T", T };
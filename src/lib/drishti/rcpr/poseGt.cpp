@@ -15,6 +15,20 @@
 
 #include <opencv2/imgproc.hpp>
 
+// clang-format off
+#if defined(__arm__) || defined(__arm64__)
+#  include <arm_neon.h>
+#  define DO_ARM_NEON 1
+#endif
+// clang-format on
+
+// clang-format off
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define DO_SSE 1
+#endif
+// clang-format on
+
 #define DRISHTI_CPR_DO_FTR_DEBUG 0
 #define DRISHTI_CPR_DO_FEATURE_MASK 1
 #define DRISHTI_CPR_USE_FEATURE_SEPARATION_PRIOR 1
@@ -23,6 +37,8 @@ DRISHTI_RCPR_NAMESPACE_BEGIN
 
 static Matx33Real getPose(const Vector1d& phi);
 static std::vector<uint32_t> xsToInds(const Matx33Real& HS, const PointVec& xs, int w, int h, int nChn, bool doTranspose, int stride);
+template <typename T>
+static int index(T x, T y, int w, int h, int stride);
 
 // function part = createPart( parent, wts )
 // % Create single part for model (parent==0 implies root).
@@ -200,6 +216,228 @@ int featuresComp(const CPR::Model& model, const Vector1d& phi, const ImageMaskPa
     return 0;
 }
 
+// Inference variant: single precision, features written to a caller provided
+// buffer (F elements), with masked features set to NaN.
+struct FeatureSampler
+{
+    FeatureSampler(const Vector1d& phi, const ImageMaskPair& Im, const FtrData& ftrData)
+        : H(getPose(phi))
+        , I(Im.getImage())
+        , M(Im.getMask())
+        , xs(*(ftrData.xs))
+    {
+        CV_Assert(I.channels() == 1);
+        CV_Assert(!(PointVecSize(xs) % 2));
+        w = I.cols;
+        h = I.rows;
+        stride = int(I.step1());
+        size = (w * h);
+    }
+
+    // Pixel index of feature location i (same rounding as index()):
+    int operator()(int i) const
+    {
+#if DRISHTI_CPR_DO_LEAN
+        const cv::Point2f p = xs[i];
+#else
+        const cv::Vec<RealType, 2> v = xs.at<cv::Vec<RealType, 2>>(i, 0);
+        const cv::Point2f p(float(v[0]), float(v[1]));
+#endif
+        const float qx = H(0, 0) * p.x + H(0, 1) * p.y + H(0, 2);
+        const float qy = H(1, 0) * p.x + H(1, 1) * p.y + H(1, 2);
+        return std::max(std::min(index(qx, qy, w, h, stride), size - 1), 0);
+    }
+
+    // Apply the mask to count features given the pixel indices of their point pairs:
+    void mask(const int* inds, float* ftrs, int count) const
+    {
+#if DRISHTI_CPR_DO_FEATURE_MASK
+        if (!M.empty())
+        {
+            const uint8_t* pM = M.ptr();
+            for (int j = 0; j < count; j++)
+            {
+                if (!(pM[inds[2 * j + 0]] & pM[inds[2 * j + 1]]))
+                {
+                    ftrs[j] = NAN;
+                }
+            }
+        }
+#endif
+    }
+
+    cv::Matx33f H;
+    const cv::Mat& I;
+    const cv::Mat& M;
+    const PointVec& xs;
+    int w, h, stride, size;
+};
+
+int featuresComp_c(const CPR::Model& model, const Vector1d& phi, const ImageMaskPair& Im, const FtrData& ftrData, float* ftrs, bool useNPD)
+{
+    const FeatureSampler sampler(phi, Im, ftrData);
+    const uint8_t* pI = sampler.I.ptr();
+    const int n = PointVecSize(sampler.xs);
+    for (int j = 0, i = 0; i < n; j++, i += 2)
+    {
+        const int inds[2] = { sampler(i + 0), sampler(i + 1) };
+        const float f1 = float(pI[inds[0]]) * (1.f / 255.f);
+        const float f2 = float(pI[inds[1]]) * (1.f / 255.f);
+        if (useNPD)
+        {
+            const float denom = (f1 + f2);
+            ftrs[j] = (denom > 0.f) ? ((f1 - f2) / denom) : 0.f; // NPD
+        }
+        else
+        {
+            ftrs[j] = (f1 - f2);
+        }
+        sampler.mask(inds, ftrs + j, 1);
+    }
+    return 0;
+}
+
+#if DRISHTI_CPR_DO_LEAN && !DRISHTI_CPR_TRANSPOSE && (DO_SSE || DO_ARM_NEON)
+#define DRISHTI_CPR_DO_SIMD_FEATURES 1
+
+// Features are processed in fixed size blocks with stack buffers (no allocations):
+static const int kFeatureBlock = 64;
+
+// Map 4 feature locations to clamped pixel indices per iteration:
+static void xsToIndsSIMD(const FeatureSampler& sampler, const cv::Point2f* xs, int n, int* inds)
+{
+    const auto& H = sampler.H;
+    int i = 0;
+
+#if DO_SSE
+    const __m128 h00 = _mm_set1_ps(H(0, 0)), h01 = _mm_set1_ps(H(0, 1)), h02 = _mm_set1_ps(H(0, 2));
+    const __m128 h10 = _mm_set1_ps(H(1, 0)), h11 = _mm_set1_ps(H(1, 1)), h12 = _mm_set1_ps(H(1, 2));
+    const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps();
+    const __m128 wMax = _mm_set1_ps(float(sampler.w - 1)), hMax = _mm_set1_ps(float(sampler.h - 1));
+    const __m128 stride = _mm_set1_ps(float(sampler.stride)), iMax = _mm_set1_ps(float(sampler.size - 1));
+    for (; i <= (n - 4); i += 4)
+    {
+        const __m128 v0 = _mm_loadu_ps(&xs[i + 0].x); // x0 y0 x1 y1
+        const __m128 v1 = _mm_loadu_ps(&xs[i + 2].x); // x2 y2 x3 y3
+        const __m128 x = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 y = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m128 qx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h00, x), _mm_mul_ps(h01, y)), h02);
+        const __m128 qy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(h10, x), _mm_mul_ps(h11, y)), h12);
+
+        // int(min(v, max)) == min(int(v), max) for integral max, offsets stay exact in float:
+        const __m128 c = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_min_ps(_mm_add_ps(qx, half), wMax)));
+        const __m128 r = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_min_ps(_mm_add_ps(qy, half), hMax)));
+        const __m128 k = _mm_max_ps(_mm_min_ps(_mm_add_ps(_mm_mul_ps(r, stride), c), iMax), zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(inds + i), _mm_cvttps_epi32(k));
+    }
+#elif DO_ARM_NEON
+    const float32x4_t half = vdupq_n_f32(0.5f), zero = vdupq_n_f32(0.f);
+    const float32x4_t wMax = vdupq_n_f32(float(sampler.w - 1)), hMax = vdupq_n_f32(float(sampler.h - 1));
+    const float32x4_t stride = vdupq_n_f32(float(sampler.stride)), iMax = vdupq_n_f32(float(sampler.size - 1));
+    for (; i <= (n - 4); i += 4)
+    {
+        const float32x4x2_t v = vld2q_f32(&xs[i].x); // deinterleave x and y
+        const float32x4_t qx = vaddq_f32(vaddq_f32(vmulq_n_f32(v.val[0], H(0, 0)), vmulq_n_f32(v.val[1], H(0, 1))), vdupq_n_f32(H(0, 2)));
+        const float32x4_t qy = vaddq_f32(vaddq_f32(vmulq_n_f32(v.val[0], H(1, 0)), vmulq_n_f32(v.val[1], H(1, 1))), vdupq_n_f32(H(1, 2)));
+        const float32x4_t c = vcvtq_f32_s32(vcvtq_s32_f32(vminq_f32(vaddq_f32(qx, half), wMax)));
+        const float32x4_t r = vcvtq_f32_s32(vcvtq_s32_f32(vminq_f32(vaddq_f32(qy, half), hMax)));
+        const float32x4_t k = vmaxq_f32(vminq_f32(vaddq_f32(vmulq_f32(r, stride), c), iMax), zero);
+        vst1q_s32(inds + i, vcvtq_s32_f32(k));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        inds[i] = sampler(int(&xs[i] - sampler.xs.data()));
+    }
+}
+
+// Pixel differences (or NPD) for 4 features per iteration:
+static void pixelDifferenceSIMD(const float* a, const float* b, float* ftrs, int n, bool useNPD)
+{
+    int j = 0;
+#if DO_SSE
+    const __m128 scale = _mm_set1_ps(1.f / 255.f), zero = _mm_setzero_ps(), two = _mm_set1_ps(2.f);
+    for (; j <= (n - 4); j += 4)
+    {
+        const __m128 f1 = _mm_mul_ps(_mm_loadu_ps(a + j), scale);
+        const __m128 f2 = _mm_mul_ps(_mm_loadu_ps(b + j), scale);
+        __m128 d = _mm_sub_ps(f1, f2);
+        if (useNPD)
+        {
+            // Reciprocal estimate + one Newton-Raphson step (~23 bits):
+            const __m128 denom = _mm_add_ps(f1, f2);
+            __m128 inv = _mm_rcp_ps(denom);
+            inv = _mm_mul_ps(inv, _mm_sub_ps(two, _mm_mul_ps(denom, inv)));
+            d = _mm_and_ps(_mm_mul_ps(d, inv), _mm_cmpgt_ps(denom, zero));
+        }
+        _mm_storeu_ps(ftrs + j, d);
+    }
+#elif DO_ARM_NEON
+    const float32x4_t scale = vdupq_n_f32(1.f / 255.f), zero = vdupq_n_f32(0.f);
+    for (; j <= (n - 4); j += 4)
+    {
+        const float32x4_t f1 = vmulq_f32(vld1q_f32(a + j), scale);
+        const float32x4_t f2 = vmulq_f32(vld1q_f32(b + j), scale);
+        float32x4_t d = vsubq_f32(f1, f2);
+        if (useNPD)
+        {
+            const float32x4_t denom = vaddq_f32(f1, f2);
+            float32x4_t inv = vrecpeq_f32(denom);
+            inv = vmulq_f32(inv, vrecpsq_f32(denom, inv));
+            inv = vmulq_f32(inv, vrecpsq_f32(denom, inv));
+            const uint32x4_t valid = vcgtq_f32(denom, zero);
+            d = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(vmulq_f32(d, inv)), valid));
+        }
+        vst1q_f32(ftrs + j, d);
+    }
+#endif
+
+    for (; j < n; j++)
+    {
+        const float f1 = a[j] * (1.f / 255.f);
+        const float f2 = b[j] * (1.f / 255.f);
+        const float denom = (f1 + f2);
+        ftrs[j] = !useNPD ? (f1 - f2) : ((denom > 0.f) ? ((f1 - f2) / denom) : 0.f);
+    }
+}
+
+int featuresComp_simd(const CPR::Model& model, const Vector1d& phi, const ImageMaskPair& Im, const FtrData& ftrData, float* ftrs, bool useNPD)
+{
+    const FeatureSampler sampler(phi, Im, ftrData);
+    const uint8_t* pI = sampler.I.ptr();
+    const int F = PointVecSize(sampler.xs) / 2;
+
+    int inds[kFeatureBlock * 2];
+    float a[kFeatureBlock], b[kFeatureBlock];
+    for (int j0 = 0; j0 < F; j0 += kFeatureBlock)
+    {
+        const int count = std::min(kFeatureBlock, F - j0);
+        xsToIndsSIMD(sampler, &sampler.xs[j0 * 2], count * 2, inds);
+
+        // Gather intensities (no byte gather in SSE/NEON):
+        for (int j = 0; j < count; j++)
+        {
+            a[j] = float(pI[inds[2 * j + 0]]);
+            b[j] = float(pI[inds[2 * j + 1]]);
+        }
+
+        pixelDifferenceSIMD(a, b, ftrs + j0, count, useNPD);
+        sampler.mask(inds, ftrs + j0, count);
+    }
+    return 0;
+}
+#endif // DRISHTI_CPR_DO_SIMD_FEATURES
+
+int featuresComp(const CPR::Model& model, const Vector1d& phi, const ImageMaskPair& Im, const FtrData& ftrData, float* ftrs, bool useNPD)
+{
+#if DRISHTI_CPR_DO_SIMD_FEATURES
+    return featuresComp_simd(model, phi, Im, ftrData, ftrs, useNPD);
+#else
+    return featuresComp_c(model, phi, Im, ftrData, ftrs, useNPD);
+#endif
+}
+
 //function ftrData = ftrsGen( model, varargin )
 //% Generate random pose indexed features.
 //%
@@ -364,14 +602,15 @@ static Matx33Real getPose(const Vector1d& phi)
 }
 
 // Note: Base 0 with transposed image (column major)
-static int index(RealType x, RealType y, int w, int h, int stride)
+template <typename T>
+static int index(T x, T y, int w, int h, int stride)
 {
 #if DRISHTI_CPR_TRANSPOSE
-    RealType cs = std::max(RealType(1.0), std::min(RealType(h), RealType(x))); // note: tranpose
-    RealType rs = std::max(RealType(1.0), std::min(RealType(w), RealType(y)));
-    return (int(cs - 1.0 + 0.5) * w + int(rs + 0.5)) - 1; // base zero
+    T cs = std::max(T(1.0), std::min(T(h), T(x))); // note: tranpose
+    T rs = std::max(T(1.0), std::min(T(w), T(y)));
+    return (int(cs - T(1.0) + T(0.5)) * w + int(rs + T(0.5))) - 1; // base zero
 #else
-    return std::min(int(y + 0.5f), h - 1) * stride + std::min(int(x + 0.5f), w - 1);
+    return std::min(int(y + T(0.5)), h - 1) * stride + std::min(int(x + T(0.5)), w - 1);
 #endif
 }
 
@@ -404,31 +643,49 @@ Vector1d identity(const CPR::Model& model)
     return Vector1d(5, 0.0);
 }
 
-Vector1d compose(const CPR::Model& mnodel, const Vector1d& phis0, const Vector1d& phis1)
+static void phisFrHs(const Matx33Real& Hs, RealType* phis);
+
+Vector1d compose(const CPR::Model& model, const Vector1d& phis0, const Vector1d& phis1)
+{
+    Vector1d phis;
+    compose(model, phis0, phis1, phis);
+    return phis;
+}
+
+// In place friendly (phis may alias phis0 or phis1) and allocation free for sized output:
+void compose(const CPR::Model& mnodel, const Vector1d& phis0, const Vector1d& phis1, Vector1d& phis)
 {
     bool isNew = true;
-    Vector1d phis(phis0.size(), 0);
     for (int i = 0; i < phis0.size(); i++)
     {
-        phis[i] = phis0[i] + phis1[i];
         if (phis0[i] != RealType(0.0))
         {
             isNew = false;
+            break;
         }
     }
 
     if (!isNew)
     {
-        Matx33Real H0 = phisToHs(phis0);
-        Matx33Real H1 = phisToHs(phis1);
-        Matx33Real H = H0 * H1;
-        Vector1d phis4 = phisFrHs(H);
-        phis4.push_back(phis.back());
-        std::swap(phis4, phis);
+        const Matx33Real H = phisToHs(phis0) * phisToHs(phis1);
+        const RealType last = phis0.back() + phis1.back();
+
+        RealType phis4[4];
+        phisFrHs(H, phis4);
+
+        phis.resize(phis0.size());
+        std::copy(phis4, phis4 + 4, phis.begin());
+        phis.back() = last;
+    }
+    else
+    {
+        phis.resize(phis0.size());
+        for (int i = 0; i < phis0.size(); i++)
+        {
+            phis[i] = phis0[i] + phis1[i];
+        }
     }
     phis[2] = normAng(phis[2], DRISHTI_CPR_ANGLE_RANGE);
-
-    return phis;
 }
 
 // function phis = inverse( model, phis0 ) %#ok<INUSL>
@@ -476,7 +733,7 @@ Vector1d inverse(const CPR::Model& mnodel, const Vector1d& phis0)
     return phis;
 }
 
-Vector1d phisFrHs(const Matx33Real& Hs)
+static void phisFrHs(const Matx33Real& Hs, RealType* phis)
 {
     double a, ss, sc, s, x, y;
     a = std::atan2(Hs(1, 0), Hs(0, 0));
@@ -485,12 +742,16 @@ Vector1d phisFrHs(const Matx33Real& Hs)
     s = core::logN(std::sqrt(sc * sc + ss * ss), 2.0);
     x = Hs(0, 2);
     y = Hs(1, 2);
-    Vector1d phis{
-        static_cast<RealType>(x),
-        static_cast<RealType>(y),
-        static_cast<RealType>(a),
-        static_cast<RealType>(s),
-    };
+    phis[0] = static_cast<RealType>(x);
+    phis[1] = static_cast<RealType>(y);
+    phis[2] = static_cast<RealType>(a);
+    phis[3] = static_cast<RealType>(s);
+}
+
+Vector1d phisFrHs(const Matx33Real& Hs)
+{
+    Vector1d phis(4);
+    phisFrHs(Hs, phis.data());
     return phis;
 }
 
@@ -502,7 +763,6 @@ Matx33Real phisToHs(const Vector1d& phis)
     double x = phis[0];
     double y = phis[1];
     Matx33Real Hs(c, -s, x, s, c, y, 0, 0, 1);
-    auto phis_ = phisFrHs(Hs);
 
     return Hs;
 }
@@ -614,13 +874,25 @@ double dist(const CPR::Model& model, const Vector1d& phis0, const Vector1d& phis
 }
 
 Vector1d ellipseToPhi(const cv::RotatedRect& e)
+{
+    Vector1d phi;
+    ellipseToPhi(e, phi);
+    return phi;
+}
+
+void ellipseToPhi(const cv::RotatedRect& e, Vector1d& phi)
 {
     float cx = e.center.x;
     float cy = e.center.y;
     float angle = (e.angle) * M_PI / 180.0; // NOTE: -e.angle
     float scale = core::logN(e.size.width, 2.0f);
     float aspectRatio = core::logN(e.size.height / e.size.width, 2.0f);
-    return Vector1d{ cx, cy, angle, scale, aspectRatio };
+    phi.resize(5);
+    phi[0] = cx;
+    phi[1] = cy;
+    phi[2] = angle;
+    phi[3] = scale;
+    phi[4] = aspectRatio;
 }
 
 // Note: This is for ellipse drawn in transposed image
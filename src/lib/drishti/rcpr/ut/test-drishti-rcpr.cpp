@@ -0,0 +1,382 @@
+/*!
+  @file   test-drishti-rcpr.cpp
+  @author David Hirvonen
+  @brief  Google test for the cascaded pose regression (CPR) internals.
+
+  \copyright Copyright 2014-2016 Elucideye, Inc. All rights reserved.
+  \license{This project is released under the 3 Clause BSD License.}
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "drishti/rcpr/CPR.h"
+#include "drishti/core/Logger.h"
+
+// clang-format off
+#if DRISHTI_SERIALIZE_WITH_BOOST
+#  include "drishti/core/boost_serialize_common.h"
+#endif
+// clang-format on
+
+#include <opencv2/imgproc.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+int gauze_main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+// Count heap allocations for the steady state tests (replaces the global operator new):
+static std::atomic<std::size_t> gAllocations(0);
+
+void* operator new(std::size_t size)
+{
+    gAllocations++;
+    if (void* ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+// clang-format off
+#define BEGIN_EMPTY_NAMESPACE  namespace {
+#define END_EMPTY_NAMESPACE }
+// clang-format on
+
+BEGIN_EMPTY_NAMESPACE
+
+using drishti::rcpr::CPR;
+using drishti::rcpr::FtrData;
+using drishti::rcpr::ImageMaskPair;
+using drishti::rcpr::RealType;
+using drishti::rcpr::Vector1d;
+
+class FeaturesCompTest : public ::testing::Test
+{
+protected:
+    FeaturesCompTest()
+    {
+        drishti::rcpr::createModel(0, model);
+
+        // Odd feature count exercises the vector tails:
+        CPR::CprPrm::FtrPrm ftrPrm;
+        ftrPrm.F = { "F", 101 };
+        drishti::rcpr::ftrsGen(model, ftrPrm, ftrData);
+
+        // Image with padded rows and a sparse mask:
+        cv::RNG rng(1);
+        cv::Mat1b padded(96, 136);
+        rng.fill(padded, cv::RNG::UNIFORM, 0, 256);
+        image = padded.colRange(0, 128);
+        image(0, 0) = image(0, 1) = 0; // NPD 0/0
+
+        mask.create(image.size());
+        rng.fill(mask, cv::RNG::UNIFORM, 0, 8);
+        mask = (mask > 0) / 255;
+
+        // Pose sequence from well inside to partially outside the image:
+        for (int i = 0; i < 16; i++)
+        {
+            const RealType t = RealType(i) / 15;
+            poses.push_back({ 64 + 80 * t, 48 - 60 * t, RealType(0.4) * i, RealType(3.5) + t, RealType(0.2) });
+        }
+    }
+
+    void compare(const ImageMaskPair& Im, bool useNPD, float tolerance) const
+    {
+        const int F = drishti::rcpr::PointVecSize(*ftrData.xs) / 2;
+        std::vector<float> expected(F), actual(F);
+        for (const auto& phi : poses)
+        {
+            drishti::rcpr::featuresComp_c(model, phi, Im, ftrData, expected.data(), useNPD);
+            drishti::rcpr::featuresComp(model, phi, Im, ftrData, actual.data(), useNPD);
+            for (int j = 0; j < F; j++)
+            {
+                ASSERT_EQ(std::isnan(expected[j]), std::isnan(actual[j]));
+                if (!std::isnan(expected[j]))
+                {
+                    if (tolerance > 0.f)
+                    {
+                        ASSERT_NEAR(expected[j], actual[j], tolerance);
+                    }
+                    else
+                    {
+                        ASSERT_EQ(expected[j], actual[j]);
+                    }
+                }
+            }
+        }
+    }
+
+    CPR::Model model;
+    FtrData ftrData;
+    cv::Mat1b image, mask;
+    std::vector<Vector1d> poses;
+};
+
+// Pixel differences are exact in the vectorized path:
+TEST_F(FeaturesCompTest, PixelDifference)
+{
+    compare(ImageMaskPair(image), false, 0.f);
+    compare(ImageMaskPair(image, mask), false, 0.f);
+}
+
+// NPD uses a refined reciprocal estimate:
+TEST_F(FeaturesCompTest, NormalizedPixelDifference)
+{
+    compare(ImageMaskPair(image), true, 1e-5f);
+    compare(ImageMaskPair(image, mask), true, 1e-5f);
+}
+
+#if !DRISHTI_BUILD_MIN_SIZE
+// Small cascade trained on synthetic images of dark ellipses:
+class CPRCascadeTest : public ::testing::Test
+{
+protected:
+    CPRCascadeTest()
+    {
+        // Held out samples (the training set uses a different seed):
+        cv::RNG rng(100);
+        for (int i = 0; i < 16; i++)
+        {
+            poses.push_back(createPose(rng));
+            images.push_back(createImage(poses.back(), rng));
+        }
+    }
+
+    static Vector1d createPose(cv::RNG& rng)
+    {
+        const float width = rng.uniform(20.f, 28.f);
+        const cv::Point2f center(rng.uniform(28.f, 36.f), rng.uniform(28.f, 36.f));
+        return drishti::rcpr::ellipseToPhi(cv::RotatedRect(center, { width, width }, 0.f));
+    }
+
+    static ImageMaskPair createImage(const Vector1d& phi, cv::RNG& rng)
+    {
+        cv::Mat1b image(64, 64);
+        rng.fill(image, cv::RNG::UNIFORM, 160, 224);
+        cv::ellipse(image, drishti::rcpr::phiToEllipse(phi), 32, -1, 8);
+        return ImageMaskPair(image, cv::Mat1b(image.size(), 255));
+    }
+
+    static std::shared_ptr<CPR> train(bool sparse = false)
+    {
+        cv::RNG rng(1), maskRng(2);
+        drishti::rcpr::ImageMaskPairVec Is;
+        drishti::rcpr::EllipseVec phis;
+        for (int i = 0; i < 32; i++)
+        {
+            phis.push_back(createPose(rng));
+            Is.push_back(createImage(phis.back(), rng));
+            if (sparse)
+            {
+                cv::Mat1b mask(Is.back().getImage().size());
+                maskRng.fill(mask, cv::RNG::UNIFORM, 0, 4);
+                Is.back().getMask() = (mask > 0) / 255;
+            }
+        }
+
+        CPR::CprPrm cprPrm;
+        for (const auto& dims : std::vector<std::vector<int>>{ { 0, 1 }, { 3 }, { 0, 1 }, { 3 } })
+        {
+            CPR::CprPrm::Recipe recipe;
+            recipe.maxDepth = 3;
+            recipe.featurePoolSize = 64;
+            recipe.featureSampleSize = 16;
+            recipe.paramIndex = dims;
+            cprPrm.cascadeRecipes.push_back(recipe);
+        }
+
+        CPR::Model model;
+        drishti::rcpr::createModel(0, model);
+        cprPrm.model = { "model", model };
+        cprPrm.T = { "T", RealType(cprPrm.cascadeRecipes.size()) };
+        cprPrm.L = { "L", 4 };
+        cprPrm.ftrPrm->type = { "type", 2 };
+        cprPrm.ftrPrm->F = { "F", 64 };
+        cprPrm.ftrPrm->radius = { "radius", 1.66 };
+
+        auto logger = drishti::core::Logger::create("test-drishti-rcpr");
+        logger->set_level(spdlog::level::off);
+
+        std::srand(1); // feature sampling
+        auto cpr = std::make_shared<CPR>();
+        cpr->setStreamLogger(logger);
+        cpr->cprTrain(Is, phis, {}, cprPrm);
+        return cpr;
+    }
+
+    // Trained once for all tests:
+    static const CPR& cascade()
+    {
+        static std::shared_ptr<CPR> cpr = train();
+        return *cpr;
+    }
+
+    // ShapeEstimator layout of an ellipse: { cx, cy, width, height, angle (degrees) } in x:
+    static CPR::Point2fVec toPoints(const cv::RotatedRect& e)
+    {
+        return { { e.center.x, 0.f }, { e.center.y, 0.f }, { e.size.width, 0.f }, { e.size.height, 0.f }, { e.angle, 0.f } };
+    }
+
+    Vector1d apply(const CPR& cpr, const ImageMaskPair& image) const
+    {
+        CPR::CPRResult result;
+        cpr.cprApplyTree(image, *cpr.regModel, *cpr.regModel->pStar, result);
+        return result.p;
+    }
+
+    std::vector<Vector1d> poses;
+    drishti::rcpr::ImageMaskPairVec images;
+};
+
+// Stages without doMask are trained on unmasked features (i.e., as they are applied):
+TEST_F(CPRCascadeTest, IgnoresMask)
+{
+    const auto cpr = train(true);
+    for (const auto& image : images)
+    {
+        EXPECT_EQ(apply(*cpr, image), apply(cascade(), image));
+    }
+}
+
+// Restarts (with a second round) agree with a single initialization, including initial
+// angles where the composed restart angles wrap around +/-pi:
+TEST_F(CPRCascadeTest, Restarts)
+{
+    const auto cpr = train();
+    cpr->setRestartSpreadThreshold(0.05f);
+    for (const float angle : { 0.f, 179.f })
+    {
+        cv::RotatedRect init = drishti::rcpr::phiToEllipse(*cpr->regModel->pStar);
+        init.angle = angle;
+
+        for (const auto& image : images)
+        {
+            std::vector<bool> mask;
+            CPR::Point2fVec single = toPoints(init), restarts = single;
+
+            cpr->setInits(1);
+            (*cpr)(image.getImage(), image.getMask(), single, mask);
+            cpr->setInits(8);
+            (*cpr)(image.getImage(), image.getMask(), restarts, mask);
+
+            const cv::Point2f offset(restarts[0].x - single[0].x, restarts[1].x - single[1].x);
+            EXPECT_LT(cv::norm(offset), 0.15f * single[2].x);
+            EXPECT_LT(std::abs(std::remainder(restarts[4].x - single[4].x, 360.f)), 10.f);
+        }
+    }
+}
+
+// N poses in one cascade pass match N single pose passes:
+TEST_F(CPRCascadeTest, MultiplePoses)
+{
+    const CPR& cpr = cascade();
+
+    cv::RNG rng(3);
+    for (const auto& image : images)
+    {
+        std::vector<Vector1d> inits(8, *cpr.regModel->pStar);
+        for (auto& p : inits)
+        {
+            p[0] += rng.uniform(-3.0, 3.0);
+            p[1] += rng.uniform(-3.0, 3.0);
+            p[3] += rng.uniform(-0.1, 0.1);
+        }
+
+        std::vector<CPR::CPRResult> results;
+        cpr.cprApplyTree(image, *cpr.regModel, inits, results);
+        ASSERT_EQ(results.size(), inits.size());
+
+        for (int i = 0; i < inits.size(); i++)
+        {
+            CPR::CPRResult result;
+            cpr.cprApplyTree(image, *cpr.regModel, inits[i], result);
+            EXPECT_EQ(results[i].p, result.p);
+        }
+    }
+}
+
+// The batch call matches a single call for each shape, including duplicate
+// initial poses and shapes without a pose (mean shape):
+TEST_F(CPRCascadeTest, ShapeBatch)
+{
+    const CPR* cpr = &cascade();
+
+    cv::RNG rng(4);
+    for (const auto& image : images)
+    {
+        std::vector<CPR::Point2fVec> shapes(1); // mean shape
+        for (int i = 0; i < 4; i++)
+        {
+            cv::RotatedRect init = drishti::rcpr::phiToEllipse(*cpr->regModel->pStar);
+            init.center += cv::Point2f(rng.uniform(-3.f, 3.f), rng.uniform(-3.f, 3.f));
+            shapes.push_back(toPoints(init));
+            shapes.push_back(shapes.back()); // duplicate
+        }
+
+        std::vector<CPR::Point2fVec> batch = shapes;
+        (*cpr)(image.getImage(), batch);
+        ASSERT_EQ(batch.size(), shapes.size());
+
+        for (int i = 0; i < shapes.size(); i++)
+        {
+            std::vector<bool> mask;
+            CPR::Point2fVec single = shapes[i];
+            (*cpr)(image.getImage(), single, mask);
+            EXPECT_EQ(batch[i], single);
+        }
+    }
+}
+
+// Once the workspace and the results are sized, a cascade pass makes no heap allocations:
+TEST_F(CPRCascadeTest, SteadyStateAllocations)
+{
+    const CPR& cpr = cascade();
+    const std::vector<Vector1d> inits(8, *cpr.regModel->pStar);
+
+    CPR::Workspace ws;
+    std::vector<CPR::CPRResult> results;
+    cpr.cprApplyTree(ws, images.front(), *cpr.regModel, inits, results); // warm up
+
+    for (const auto& image : images)
+    {
+        const std::size_t count = gAllocations;
+        cpr.cprApplyTree(ws, image, *cpr.regModel, inits, results);
+        const std::size_t allocations = gAllocations - count;
+        EXPECT_EQ(allocations, std::size_t(0));
+    }
+}
+
+#if DRISHTI_SERIALIZE_WITH_BOOST
+// Native (HistogramBooster) stages are stored as packed ensembles without a learner:
+TEST_F(CPRCascadeTest, NativeSerialization)
+{
+    std::stringstream ss;
+    save_pba_z(ss, cascade());
+
+    CPR loaded;
+    load_pba_z(ss, loaded);
+    ASSERT_EQ(loaded.regModel->regs->size(), cascade().regModel->regs->size());
+    for (const auto& image : images)
+    {
+        EXPECT_EQ(apply(loaded, image), apply(cascade(), image));
+    }
+}
+#endif // DRISHTI_SERIALIZE_WITH_BOOST
+#endif // !DRISHTI_BUILD_MIN_SIZE
+
+END_EMPTY_NAMESPACE